@@ -32,13 +32,19 @@
 #include "core/log.h"
 #include "core/measure.h"
 #include "core/resources.h"
+#include "os/c.h"
+#include "pack/atlas-format.h"
+#include "pack/lz4.h"
+#include "pack/texture-format.h"
 #include "util/assert.h"
 #include "util/hash.h"
+#include "util/hashtable.h"
 #include "util/hashvector.h"
 #include "util/int.h"
 #include "util/noexcept.h"
 #include "util/string-view.h"
 #include "util/string.h"
+#include "util/vector.h"
 
 #define ATLAS_WIDTH 2048
 #define ATLAS_HEIGHT 512
@@ -49,6 +55,12 @@ static uint32_t atlasUsed = 0;
 
 static HashVector<TiledImage> images;
 
+// Images that pack-tool baked into atlas pages, by path.
+static Hashmap<String, AtlasEntry> bakedImages;
+static Vector<SDL_Texture*> bakedPages;  // Loaded when first used.
+
+static void readAtlasManifest() noexcept;
+
 void
 imageInit() noexcept {
     TimeMeasure m("Created SDL2 renderer");
@@ -78,6 +90,8 @@ imageInit() noexcept {
 
     SDL_SetRenderDrawColor(renderer, 0x00, 0x00, 0x00, 0xFF);
 
+    readAtlasManifest();
+
     // Blank until the start of a frame.
     //SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0xFF);
     //SDL_RenderClear(renderer);
@@ -133,10 +147,149 @@ initAtlas() noexcept {
     }
 }
 
-static TiledImage*
-load(StringView path) noexcept {
-    TiledImage& tiles = images.allocate(hash_(path));
-    tiles = {};
+// Upload the pixels of a texture blob made by pack-tool. Returns null if it
+// is not one this version of the engine understands.
+static SDL_Texture*
+loadDecoded(StringView path, StringView data) noexcept {
+    TextureHeader header;
+    if (data.size < sizeof(header)) {
+        return 0;
+    }
+    memcpy(&header, data.data, sizeof(header));
+
+    if (memcmp(header.magic, TEXTURE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != TEXTURE_VERSION || header.format != TEXTURE_RGBA8 ||
+        header.size != data.size - sizeof(header) || header.width == 0 ||
+        header.height == 0 || header.width > 0x4000 ||
+        header.height > 0x4000) {
+        logErr("SDL2", String() << "Invalid decoded image: " << path);
+        return 0;
+    }
+
+    size_t size = static_cast<size_t>(header.width) * header.height * 4;
+    const char* pixels = data.data + sizeof(header);
+
+    Vector<uint8_t> decompressed;
+    if (header.compression == TEXTURE_COMPRESSION_LZ4) {
+        decompressed.resize(size);
+        if (!lz4Decompress(pixels, header.size, decompressed.data, size)) {
+            logErr("SDL2", String() << "Invalid decoded image: " << path);
+            return 0;
+        }
+        pixels = reinterpret_cast<const char*>(decompressed.data);
+    }
+    else if (header.compression != TEXTURE_COMPRESSION_NONE ||
+             header.size != size) {
+        logErr("SDL2", String() << "Invalid decoded image: " << path);
+        return 0;
+    }
+
+    int width = static_cast<int>(header.width);
+    int height = static_cast<int>(header.height);
+
+    SDL_Texture* texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32,
+                                             SDL_TEXTUREACCESS_STATIC, width,
+                                             height);
+    if (!texture) {
+        return 0;
+    }
+
+    if (SDL_UpdateTexture(texture, 0, pixels, width * 4) < 0) {
+        SDL_DestroyTexture(texture);
+        return 0;
+    }
+
+    return texture;
+}
+
+// Decode a PNG or other image SDL_image understands and upload it.
+static SDL_Texture*
+loadEncoded(StringView path, StringView data) noexcept {
+    SDL_RWops* ops =
+            SDL_RWFromMem(static_cast<void*>(const_cast<char*>(data.data)),
+                          static_cast<int>(data.size));
+
+    SDL_Surface* surface = IMG_Load_RW(ops, 1);
+    //SDL_Surface* surface = SDL_LoadBMP_RW(ops, 1);
+    if (!surface) {
+        logFatal("SDL2", String() << "Invalid image: " << path);
+        return 0;
+    }
+
+    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
+    SDL_FreeSurface(surface);
+
+    return texture;
+}
+
+static void
+readAtlasManifest() noexcept {
+    StringView path = ATLAS_MANIFEST_PATH;
+    if (!resourceExists(path)) {
+        return;
+    }
+
+    StringView data;
+    if (!resourceLoad(path, data)) {
+        return;
+    }
+
+    AtlasHeader header;
+    memset(&header, 0, sizeof(header));
+    if (data.size >= sizeof(header)) {
+        memcpy(&header, data.data, sizeof(header));
+    }
+
+    bool ok = memcmp(header.magic, ATLAS_MAGIC, sizeof(header.magic)) == 0 &&
+              header.version == ATLAS_VERSION &&
+              data.size == sizeof(header) +
+                                   static_cast<size_t>(header.entryCount) *
+                                           sizeof(AtlasEntry) +
+                                   header.stringsSize;
+
+    const char* entries = data.data + sizeof(header);
+
+    // Check every entry before using any of them.
+    for (uint32_t i = 0; ok && i < header.entryCount; i++) {
+        AtlasEntry entry;
+        memcpy(&entry, entries + i * sizeof(entry), sizeof(entry));
+
+        ok = entry.page < header.pageCount &&
+             entry.pathOffset <= header.stringsSize &&
+             entry.pathSize <= header.stringsSize - entry.pathOffset &&
+             entry.x + entry.width <= ATLAS_PAGE_SIZE &&
+             entry.y + entry.height <= ATLAS_PAGE_SIZE;
+    }
+
+    if (!ok) {
+        logErr("SDL2", String() << "Invalid atlas manifest: " << path);
+        resourceRelease(path);
+        return;
+    }
+
+    const char* strings = entries + header.entryCount * sizeof(AtlasEntry);
+
+    for (uint32_t i = 0; i < header.entryCount; i++) {
+        AtlasEntry entry;
+        memcpy(&entry, entries + i * sizeof(entry), sizeof(entry));
+
+        String imagePath(
+                StringView(strings + entry.pathOffset, entry.pathSize));
+        bakedImages[static_cast<String&&>(imagePath)] = entry;
+    }
+
+    bakedPages.resize(header.pageCount);
+
+    resourceRelease(path);
+}
+
+static SDL_Texture*
+loadBakedPage(uint32_t page) noexcept {
+    if (bakedPages[page]) {
+        return bakedPages[page];
+    }
+
+    String path = String() << ATLAS_PAGE_PREFIX << page << TEXTURE_EXTENSION;
 
     StringView r;
     if (!resourceLoad(path, r)) {
@@ -144,9 +297,43 @@ load(StringView path) noexcept {
         return 0;
     }
 
-    SDL_RWops* ops =
-            SDL_RWFromMem(static_cast<void*>(const_cast<char*>(r.data)),
-                          static_cast<int>(r.size));
+    SDL_Texture* texture;
+    {
+        TimeMeasure m(String() << "Constructed " << path << " as atlas page");
+        texture = loadDecoded(path, r);
+    }
+    resourceRelease(path);
+
+    if (!texture) {
+        return 0;
+    }
+
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+
+    bakedPages[page] = texture;
+    return texture;
+}
+
+static TiledImage*
+load(StringView path) noexcept {
+    TiledImage& tiles = images.allocate(hash_(path));
+    tiles = {};
+
+    // Images baked into the atlas are drawn straight from their page.
+    AtlasEntry* entry = bakedImages.tryAt(path);
+    if (entry) {
+        SDL_Texture* page = loadBakedPage(entry->page);
+        if (page) {
+            tiles.image = {
+                page,
+                entry->x,
+                entry->y,
+                entry->width,
+                entry->height,
+            };
+            return &tiles;
+        }
+    }
 
     int x = atlasUsed;
     int y = 0;
@@ -156,24 +343,26 @@ load(StringView path) noexcept {
     {
         TimeMeasure m(String() << "Constructed " << path << " as image");
 
-        SDL_Surface* surface = IMG_Load_RW(ops, 1);
-        //SDL_Surface* surface = SDL_LoadBMP_RW(ops, 1);
-        if (!surface) {
-            logFatal("SDL2", String() << "Invalid image: " << path);
-            return 0;
-        }
+        initAtlas();
 
-        width = surface->w;
-        height = surface->h;
+        SDL_Texture* texture = 0;
 
-        initAtlas();
+        // Prefer the pixels pack-tool decoded ahead of time, if any.
+        String decodedPath = String() << path << TEXTURE_EXTENSION;
+        StringView r;
+        if (resourceExists(decodedPath) && resourceLoad(decodedPath, r)) {
+            texture = loadDecoded(decodedPath, r);
+            resourceRelease(decodedPath);
+        }
 
-        // Rectangle packing algorithm:
-        //
-        // Copy surface into the atlas to the right of the previous image,
-        // or at the left edge, if there was no previous image.
-        SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
-        SDL_FreeSurface(surface);
+        if (!texture) {
+            if (!resourceLoad(path, r)) {
+                // Error logged.
+                return 0;
+            }
+            texture = loadEncoded(path, r);
+            resourceRelease(path);
+        }
 
         if (!texture) {
             logFatal("SDL2",
@@ -181,7 +370,14 @@ load(StringView path) noexcept {
             return 0;
         }
 
-        // Copy this texture's data into the atlas texture.
+        uint32_t format;
+        int access;
+        SDL_QueryTexture(texture, &format, &access, &width, &height);
+
+        // Rectangle packing algorithm:
+        //
+        // Copy texture into the atlas to the right of the previous image,
+        // or at the left edge, if there was no previous image.
         SDL_Rect src = { 0, 0, width, height  };
         SDL_Rect dst = { x, y, width, height  };
 
@@ -38,9 +38,6 @@
 #include "util/string.h"
 
 struct Song {
-    // The Mix_Music needs the music data to be kept around for its lifetime.
-    StringView fileContent;
-
     Mix_Music* mix;
 };
 
@@ -50,22 +47,122 @@ static HashVector<Song> songs;
 static uint32_t songHash = 0;
 static Song* song = 0;
 
+// Music is streamed from the archive as it plays rather than loaded whole,
+// since tracks can be large. SDL_mixer reads through these callbacks. data1
+// holds the ResourceStream and data2 the current position.
+
+static ResourceStream*
+getStream(SDL_RWops* ops) noexcept {
+    return static_cast<ResourceStream*>(ops->hidden.unknown.data1);
+}
+
+static uint64_t
+getPosition(SDL_RWops* ops) noexcept {
+    return reinterpret_cast<uintptr_t>(ops->hidden.unknown.data2);
+}
+
+static void
+setPosition(SDL_RWops* ops, uint64_t position) noexcept {
+    ops->hidden.unknown.data2 =
+            reinterpret_cast<void*>(static_cast<uintptr_t>(position));
+}
+
+static int64_t
+streamSize(SDL_RWops* ops) noexcept {
+    return static_cast<int64_t>(resourceStreamSize(getStream(ops)));
+}
+
+static int64_t
+streamSeek(SDL_RWops* ops, int64_t offset, int whence) noexcept {
+    int64_t position = static_cast<int64_t>(getPosition(ops));
+    int64_t size = streamSize(ops);
+
+    switch (whence) {
+    case RW_SEEK_SET:
+        position = offset;
+        break;
+    case RW_SEEK_CUR:
+        position += offset;
+        break;
+    case RW_SEEK_END:
+        position = size + offset;
+        break;
+    default:
+        return -1;
+    }
+
+    if (position < 0 || position > size) {
+        return -1;
+    }
+
+    setPosition(ops, static_cast<uint64_t>(position));
+    return position;
+}
+
+static size_t
+streamRead(SDL_RWops* ops, void* buf, size_t size, size_t count) noexcept {
+    ResourceStream* stream = getStream(ops);
+    uint64_t position = getPosition(ops);
+    uint64_t remaining = resourceStreamSize(stream) - position;
+
+    if (size == 0) {
+        return 0;
+    }
+    if (count > remaining / size) {
+        count = static_cast<size_t>(remaining / size);
+    }
+    if (!resourceStreamRead(stream, position, size * count, buf)) {
+        return 0;
+    }
+
+    setPosition(ops, position + size * count);
+    return count;
+}
+
+static size_t
+streamWrite(SDL_RWops*, const void*, size_t, size_t) noexcept {
+    return 0;
+}
+
+static int
+streamClose(SDL_RWops* ops) noexcept {
+    resourceStreamClose(getStream(ops));
+    SDL_FreeRW(ops);
+    return 0;
+}
+
 static Song*
 load(StringView path) noexcept {
     Song& newSong = songs.allocate(hash_(path));
     newSong.mix = 0;
 
-    StringView r;
-    if (!resourceLoad(path, r)) {
+    ResourceStream* stream = resourceStreamOpen(path);
+    if (!stream) {
         // Error logged.
         return 0;
     }
 
-    SDL_RWops* ops =
-            SDL_RWFromMem(static_cast<void*>(const_cast<char*>(r.data)),
-                          static_cast<int>(r.size));
+    SDL_RWops* ops = SDL_AllocRW();
+    if (!ops) {
+        resourceStreamClose(stream);
+        sdlDie("SDL2", "SDL_AllocRW");
+        return 0;
+    }
+
+    ops->size = streamSize;
+    ops->seek = streamSeek;
+    ops->read = streamRead;
+    ops->write = streamWrite;
+    ops->close = streamClose;
+    ops->type = 0;  // SDL_RWOPS_UNKNOWN
+    ops->hidden.unknown.data1 = stream;
+    ops->hidden.unknown.data2 = 0;
 
     TimeMeasure m(String() << "Constructed " << path << " as music");
+
+    // SDL_mixer owns ops from here on and closes it, and with it the stream,
+    // if loading fails. Songs are never unloaded, so otherwise the stream
+    // stays open.
     Mix_Music* mix = Mix_LoadMUS_RW(ops, 1);
 
     if (!mix) {
@@ -73,8 +170,6 @@ load(StringView path) noexcept {
         return 0;
     }
 
-    // We need to keep the memory around, so put it in a struct.
-    newSong.fileContent = r;
     newSong.mix = mix;
 
     return &newSong;
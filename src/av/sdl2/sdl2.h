@@ -108,9 +108,30 @@ typedef struct {
 } SDL_Rect;
 
 // SDL_rwops.h
-typedef struct SDL_RWops SDL_RWops;
+#define RW_SEEK_SET 0
+#define RW_SEEK_CUR 1
+#define RW_SEEK_END 2
+typedef struct SDL_RWops {
+    int64_t (*size)(struct SDL_RWops*);
+    int64_t (*seek)(struct SDL_RWops*, int64_t, int);
+    size_t (*read)(struct SDL_RWops*, void*, size_t, size_t);
+    size_t (*write)(struct SDL_RWops*, const void*, size_t, size_t);
+    int (*close)(struct SDL_RWops*);
+    uint32_t type;
+    union {
+        struct {
+            void* data1;
+            void* data2;
+        } unknown;
+        uint8_t padding[48];  // Other members are platform-specific.
+    } hidden;
+} SDL_RWops;
 SDL_RWops*
 SDL_RWFromMem(void*, int) noexcept;
+SDL_RWops*
+SDL_AllocRW() noexcept;
+void
+SDL_FreeRW(SDL_RWops*) noexcept;
 
 // SDL_surface.h
 struct SDL_Surface {
@@ -180,6 +201,8 @@ SDL_SetRenderTarget(SDL_Renderer*, SDL_Texture*) noexcept;
 int
 SDL_SetTextureBlendMode(SDL_Texture*, SDL_BlendMode) noexcept;
 int
+SDL_UpdateTexture(SDL_Texture*, const SDL_Rect*, const void*, int) noexcept;
+int
 SDL_RenderClear(SDL_Renderer*) noexcept;
 int
 SDL_RenderCopy(SDL_Renderer*,
@@ -201,6 +224,7 @@ SDL_SetRenderDrawColor(SDL_Renderer*,
 #define SDL_RENDERER_ACCELERATED 2
 #define SDL_RENDERER_PRESENTVSYNC 4
 #define SDL_RENDERER_TARGETTEXTURE 8
+#define SDL_TEXTUREACCESS_STATIC 0
 #define SDL_TEXTUREACCESS_TARGET 2
 
 // SDL_image library
@@ -241,6 +265,10 @@ Mix_PlayingMusic() noexcept;
 int
 Mix_PlayChannelTimed(int, Mix_Chunk*, int, int) noexcept;
 int
+Mix_QuerySpec(int*, uint16_t*, int*) noexcept;
+Mix_Chunk*
+Mix_QuickLoad_RAW(uint8_t*, uint32_t) noexcept;
+int
 Mix_PlayMusic(Mix_Music*, int) noexcept;
 void
 Mix_Resume(int) noexcept;
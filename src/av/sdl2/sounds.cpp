@@ -28,10 +28,13 @@
 
 #include "av/sdl2/error.h"
 #include "av/sdl2/sdl2.h"
+#include "core/log.h"
 #include "core/measure.h"
 #include "core/resources.h"
 #include "core/world.h"
+#include "os/c.h"
 #include "os/mutex.h"
+#include "pack/sound-format.h"
 #include "util/hashtable.h"
 #include "util/int.h"
 #include "util/markable.h"
@@ -43,7 +46,7 @@ struct SDL2Sound {
     int numUsers;
     time_t lastUse;
 
-    StringView frames;  // Audio frames.
+    StringView frames;  // Decoded frames held in a resource, or empty.
     Mix_Chunk* chunk;   // Decoding configuration.
 };
 
@@ -69,6 +72,9 @@ static Vector<int> playingChannels;
 
 static Mutex channelMutex;
 
+// Whether the audio device plays sounds decoded by pack-tool as they are.
+static bool deviceTakesDecoded = false;
+
 static void
 channelFinished(int channel) noexcept {
     LockGuard guard(channelMutex);
@@ -108,11 +114,71 @@ init() noexcept {
 
     Mix_ChannelFinished(channelFinished);
 
+    int frequency;
+    uint16_t format;
+    int channels;
+    deviceTakesDecoded = Mix_QuerySpec(&frequency, &format, &channels) != 0 &&
+                         frequency == SOUND_RATE && format == MIX_DEFAULT_FORMAT &&
+                         channels == SOUND_CHANNELS;
+
     playingChannels.resize(Mix_AllocateChannels(-1));
 }
 
+// Play the samples pack-tool decoded ahead of time, if any, straight from
+// where they were loaded.
+static SDL2Sound
+makeDecodedSound(StringView path) noexcept {
+    String decodedPath = String() << path << SOUND_EXTENSION;
+    if (!deviceTakesDecoded || !resourceExists(decodedPath)) {
+        return SDL2Sound();
+    }
+
+    StringView r;
+    if (!resourceLoad(decodedPath, r)) {
+        // Error logged.
+        return SDL2Sound();
+    }
+
+    SoundHeader header;
+    memset(&header, 0, sizeof(header));
+    if (r.size >= sizeof(header)) {
+        memcpy(&header, r.data, sizeof(header));
+    }
+
+    if (memcmp(header.magic, SOUND_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != SOUND_VERSION || header.rate != SOUND_RATE ||
+        header.channels != SOUND_CHANNELS || header.format != SOUND_S16LE ||
+        header.size != r.size - sizeof(header)) {
+        logErr("Sounds", String() << "Invalid decoded sound: " << decodedPath);
+        resourceRelease(decodedPath);
+        return SDL2Sound();
+    }
+
+    StringView frames = r.substr(sizeof(header));
+
+    // The chunk refers to the loaded resource rather than a copy, so the
+    // resource is not released.
+    Mix_Chunk* chunk = Mix_QuickLoad_RAW(
+            reinterpret_cast<uint8_t*>(const_cast<char*>(frames.data)),
+            static_cast<uint32_t>(frames.size));
+
+    if (chunk == 0) {
+        sdlError("Sounds",
+                 String() << "Mix_QuickLoad_RAW(" << decodedPath << ")");
+        resourceRelease(decodedPath);
+        return SDL2Sound();
+    }
+
+    return SDL2Sound{1, 0, frames, chunk};
+}
+
 static SDL2Sound
 makeSound(StringView path) noexcept {
+    SDL2Sound decoded = makeDecodedSound(path);
+    if (!(decoded == SDL2Sound())) {
+        return decoded;
+    }
+
     StringView r;
     if (!resourceLoad(path, r)) {
         // Error logged.
@@ -130,12 +196,16 @@ makeSound(StringView path) noexcept {
         chunk = Mix_LoadWAV_RW(ops, true);
     }
 
+    resourceRelease(path);
+
     if (chunk == 0) {
         sdlError("Sounds", String() << "Mix_LoadWAV(" << path << ")");
         return SDL2Sound();
     }
 
-    return SDL2Sound{1, 0, r, chunk};
+    // Mix_LoadWAV_RW decoded the samples into the chunk, which keeps nothing
+    // from the released resource.
+    return SDL2Sound{1, 0, StringView(), chunk};
 }
 
 SoundID
@@ -211,3 +211,16 @@ Animation::getFrame() noexcept {
 
     return pool[id].currentImage;
 }
+
+size_t
+Animation::memoryUsage() noexcept {
+    if (id == NO_ANIMATION) {
+        return 0;
+    }
+
+    size_t usage = sizeof(AnimationData);
+    if (!isSingleFrame(id)) {
+        usage += pool[id].frames.capacity * sizeof(Image);
+    }
+    return usage;
+}
@@ -113,6 +113,14 @@ class Animation {
     Image
     getFrame() noexcept;
 
+    /**
+     * Returns the approximate bytes of memory held for this Animation's
+     * frames, not counting the images themselves. Animations that were copied
+     * from each other share it.
+     */
+    size_t
+    memoryUsage() noexcept;
+
  public:
     AnimationID id;
 };
@@ -0,0 +1,484 @@
+/********************************
+** Tsunagari Tile Engine       **
+** area-binary.cpp             **
+** Copyright 2020 Paul Merrill **
+********************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#include "core/area-binary.h"
+
+#include "core/area-regions.h"
+#include "core/area.h"
+#include "core/images.h"
+#include "core/log.h"
+#include "core/measure.h"
+#include "core/resources.h"
+#include "core/tile.h"
+#include "core/world.h"
+#include "os/c.h"
+#include "pack/area-format.h"
+#include "util/int.h"
+#include "util/move.h"
+#include "util/string.h"
+#include "util/vector.h"
+
+#define CHECK(x)      \
+    if (!(x)) {       \
+        return false; \
+    }
+
+// Records are copied out of the file because it can be stored at any
+// alignment.
+template<typename T>
+static T
+recordAt(StringView data, AreaBinSection section, size_t i) noexcept {
+    T record;
+    memcpy(&record, data.data + section.offset + i * sizeof(T), sizeof(T));
+    return record;
+}
+
+class AreaBinary : public Area {
+ public:
+    // Reads all but the tilesets. data is the loaded resource at path, which
+    // is held until finish.
+    AreaBinary(Player* player,
+               StringView descriptor,
+               StringView path,
+               StringView data) noexcept;
+    ~AreaBinary() noexcept;
+
+    // Load the tilesets and scripts, which needs the main thread.
+    void
+    finish() noexcept;
+
+ private:
+    bool
+    prepare() noexcept;
+    bool
+    loadTileSet(AreaBinTileSet tileSet) noexcept;
+    bool
+    loadLayers() noexcept;
+    bool
+    loadObject(AreaBinObject object) noexcept;
+
+    bool
+    validSection(AreaBinSection section, size_t recordSize) noexcept;
+    bool
+    stringAt(AreaBinString ref, StringView& s) noexcept;
+
+ private:
+    String path;
+    StringView data;  // Empty once finished.
+    AreaBinHeader header;
+
+    // TileType #0 and those of every tileset.
+    uint32_t tileTypeCount = 0;
+};
+
+
+Area*
+makeAreaFromBinary(Player* player, StringView filename) noexcept {
+    Area* area = prepareAreaFromBinary(player, filename);
+    if (!area || !finishAreaFromBinary(area)) {
+        return 0;
+    }
+    return area;
+}
+
+Area*
+prepareAreaFromBinary(Player* player, StringView filename) noexcept {
+    String path = String() << filename << AREA_BIN_EXTENSION;
+    if (!resourceExists(path)) {
+        return 0;
+    }
+
+    StringView data;
+    if (!resourceLoad(path, data)) {
+        return 0;
+    }
+
+    AreaBinHeader header;
+    if (data.size < sizeof(header) ||
+        memcmp(data.data, AREA_BIN_MAGIC, sizeof(AREA_BIN_MAGIC)) != 0) {
+        logErr(filename, "Compiled area is corrupt, loading the map instead");
+        resourceRelease(path);
+        return 0;
+    }
+
+    memcpy(&header, data.data, sizeof(header));
+    if (header.version != AREA_BIN_VERSION) {
+        logErr(filename,
+               "Compiled area is from a different version of pack-tool, "
+               "loading the map instead");
+        resourceRelease(path);
+        return 0;
+    }
+
+    Area* area = new AreaBinary(player, filename, path, data);
+    if (!area->ok) {
+        delete area;
+        return 0;
+    }
+    return area;
+}
+
+bool
+finishAreaFromBinary(Area* area) noexcept {
+    static_cast<AreaBinary*>(area)->finish();
+    if (!area->ok) {
+        delete area;
+        return false;
+    }
+    return true;
+}
+
+
+AreaBinary::AreaBinary(Player* player,
+                       StringView descriptor,
+                       StringView path,
+                       StringView data) noexcept
+        : path(path), data(data) {
+    TimeMeasure m(String() << "Constructed " << descriptor
+                           << " as area-binary");
+
+    memcpy(&header, data.data, sizeof(header));
+
+    this->player = player;
+    this->descriptor = descriptor;
+
+    // Add TileType #0. Not used, but Tiled's gids start from 1.
+    tileGraphics.resize(1);
+
+    ok = prepare();
+    if (!ok) {
+        logErr(descriptor, "Compiled area is corrupt, loading the map instead");
+    }
+}
+
+AreaBinary::~AreaBinary() noexcept {
+    if (data.data) {
+        resourceRelease(path);
+    }
+}
+
+void
+AreaBinary::finish() noexcept {
+    if (ok) {
+        TimeMeasure m(String() << "Loaded tilesets of " << descriptor);
+
+        for (size_t i = 0; i < header.tileSets.count; i++) {
+            if (!loadTileSet(
+                        recordAt<AreaBinTileSet>(data, header.tileSets, i))) {
+                logErr(descriptor,
+                       "Compiled area could not be loaded, loading the map "
+                       "instead");
+                ok = false;
+                break;
+            }
+        }
+    }
+
+    if (ok && !resolveScripts()) {
+        logErr(descriptor,
+               "Compiled area could not be loaded, loading the map instead");
+        ok = false;
+    }
+
+    resourceRelease(path);
+    data = StringView();
+}
+
+bool
+AreaBinary::validSection(AreaBinSection section, size_t recordSize) noexcept {
+    return section.offset <= data.size &&
+           section.count <= (data.size - section.offset) / recordSize;
+}
+
+bool
+AreaBinary::stringAt(AreaBinString ref, StringView& s) noexcept {
+    CHECK(ref.offset <= header.strings.count &&
+          ref.size <= header.strings.count - ref.offset);
+    s = StringView(data.data + header.strings.offset + ref.offset, ref.size);
+    return true;
+}
+
+bool
+AreaBinary::prepare() noexcept {
+    CHECK(validSection(header.strings, 1));
+    CHECK(validSection(header.layers, sizeof(AreaBinLayer)));
+    CHECK(validSection(header.tileSets, sizeof(AreaBinTileSet)));
+    CHECK(validSection(header.animations, sizeof(AreaBinAnimation)));
+    CHECK(validSection(header.frames, sizeof(uint32_t)));
+    CHECK(validSection(header.graphics, sizeof(int32_t)));
+    CHECK(validSection(header.objects, sizeof(AreaBinObject)));
+    CHECK(validSection(header.exits, sizeof(AreaBinExit)));
+
+    CHECK(0 < header.width && 0 < header.height && 0 <= header.depth);
+    CHECK(header.layers.count == static_cast<uint32_t>(header.depth));
+
+    StringView nameStr, musicStr;
+    CHECK(stringAt(header.name, nameStr));
+    CHECK(stringAt(header.music, musicStr));
+
+    name = nameStr;
+    musicPath = musicStr;
+
+    grid.dim.x = header.width;
+    grid.dim.y = header.height;
+    grid.dim.z = 0;
+    grid.tileDim =
+            ivec2{static_cast<int>(header.tileWidth),
+                  static_cast<int>(header.tileHeight)};
+    grid.loopX = (header.loop & AREA_BIN_LOOP_X) != 0;
+    grid.loopY = (header.loop & AREA_BIN_LOOP_Y) != 0;
+
+    colorOverlayARGB = header.colorOverlayARGB;
+
+    // Start paging in the tileset images and music before we need them. The
+    // tilesets' tile types follow each other, so the layers can be checked
+    // before the images are loaded.
+    Vector<String> prefetches;
+    tileTypeCount = 1;
+    for (size_t i = 0; i < header.tileSets.count; i++) {
+        AreaBinTileSet tileSet =
+                recordAt<AreaBinTileSet>(data, header.tileSets, i);
+        StringView image;
+        CHECK(stringAt(tileSet.image, image));
+        CHECK(tileSet.firstGid == static_cast<int32_t>(tileTypeCount));
+        CHECK(tileSet.tileCount <=
+              static_cast<uint32_t>(INT32_MAX) - tileTypeCount);
+        tileTypeCount += tileSet.tileCount;
+        prefetches.push_back(image);
+    }
+    if (musicPath.size) {
+        prefetches.push_back(musicPath);
+    }
+    resourcePrefetch(prefetches);
+
+    CHECK(loadLayers());
+
+    for (size_t i = 0; i < header.objects.count; i++) {
+        CHECK(loadObject(recordAt<AreaBinObject>(data, header.objects, i)));
+    }
+
+    return true;
+}
+
+bool
+AreaBinary::loadTileSet(AreaBinTileSet tileSet) noexcept {
+    StringView image;
+    CHECK(stringAt(tileSet.image, image));
+    CHECK(tileSet.firstGid == static_cast<int32_t>(tileGraphics.size));
+
+    tileSets[image] = TileSet{tileSet.firstGid,
+                              static_cast<size_t>(tileSet.width),
+                              static_cast<size_t>(tileSet.height)};
+
+    TiledImage images = tilesLoad(image,
+                                  static_cast<uint32_t>(header.tileWidth),
+                                  static_cast<uint32_t>(header.tileHeight));
+    if (!TILES_VALID(images)) {
+        logErr(descriptor, "Tileset image not found");
+        return false;
+    }
+
+    uint32_t nTiles = images.numTiles;
+    if (nTiles != tileSet.tileCount) {
+        logErr(descriptor,
+               String() << image << ": image size differs from when the "
+                        << "area was compiled");
+        return false;
+    }
+
+    tileGraphics.reserve(tileGraphics.size + nTiles);
+
+    // Initialize "vanilla" tile type array.
+    for (uint32_t i = 0; i < nTiles; i++) {
+        tileGraphics.push_back(Animation(tileAt(images, i)));
+    }
+
+    CHECK(tileSet.firstAnimation <= header.animations.count &&
+          tileSet.animationCount <=
+                  header.animations.count - tileSet.firstAnimation);
+
+    time_t now = worldTime();
+
+    for (uint32_t i = 0; i < tileSet.animationCount; i++) {
+        AreaBinAnimation animation = recordAt<AreaBinAnimation>(
+                data, header.animations, tileSet.firstAnimation + i);
+
+        CHECK(animation.id < nTiles && 0 < animation.frameLen);
+        CHECK(0 < animation.frameCount &&
+              animation.firstFrame <= header.frames.count &&
+              animation.frameCount <=
+                      header.frames.count - animation.firstFrame);
+
+        Vector<Image> frames;
+        frames.reserve(animation.frameCount);
+
+        for (uint32_t j = 0; j < animation.frameCount; j++) {
+            uint32_t idx = recordAt<uint32_t>(
+                    data, header.frames, animation.firstFrame + j);
+            CHECK(idx < nTiles);
+            frames.push_back(tileAt(images, idx));
+        }
+
+        Animation& graphic = tileGraphics[tileSet.firstGid + animation.id];
+        graphic = Animation(move_(frames), animation.frameLen);
+        graphic.restart(now);
+    }
+
+    return true;
+}
+
+bool
+AreaBinary::loadLayers() noexcept {
+    size_t layerSize = static_cast<size_t>(header.width) * header.height;
+    bool streamed = header.regionSize != 0;
+
+    if (streamed) {
+        // The tiles are read a region at a time once the area is shown.
+        CHECK(header.graphics.count == 0);
+        CHECK(header.regionSize <= 0x10000 &&
+              (header.regionSize & TILE_CHUNK_MASK) == 0);
+    }
+    else {
+        CHECK(header.graphics.count == layerSize * header.depth);
+    }
+
+    Vector<int> graphics;
+    if (!streamed) {
+        graphics.resize(layerSize);
+    }
+
+    for (int z = 0; z < header.depth; z++) {
+        AreaBinLayer layer = recordAt<AreaBinLayer>(data, header.layers, z);
+
+        CHECK(!grid.depth2idx.contains(layer.depth));
+
+        grid.addLayer(layer.type == AREA_BIN_OBJECT_LAYER
+                              ? TileGrid::OBJECT_LAYER
+                              : TileGrid::TILE_LAYER);
+        grid.depth2idx[layer.depth] = z;
+        grid.idx2depth.push_back(layer.depth);
+
+        if (streamed) {
+            continue;
+        }
+
+        memcpy(graphics.data,
+               data.data + header.graphics.offset +
+                       z * layerSize * sizeof(int32_t),
+               layerSize * sizeof(int32_t));
+        for (size_t i = 0; i < layerSize; i++) {
+            CHECK(static_cast<uint32_t>(graphics[i]) < tileTypeCount);
+        }
+
+        grid.setLayer(z, graphics.data);
+    }
+
+    if (streamed) {
+        regions = new AreaRegions(grid,
+                                  descriptor,
+                                  static_cast<int>(header.regionSize),
+                                  tileTypeCount);
+    }
+
+    return true;
+}
+
+bool
+AreaBinary::loadObject(AreaBinObject object) noexcept {
+    CHECK(0 <= object.z && object.z < grid.dim.z);
+    CHECK((object.flags >> TILE_FLAG_BITS) == 0);
+    CHECK(0 <= object.x && 0 <= object.width &&
+          object.width <= grid.dim.x - object.x);
+    CHECK(0 <= object.y && 0 <= object.height &&
+          object.height <= grid.dim.y - object.y);
+
+    // AreaBinScriptType is in TileGrid::ScriptType order. The scripts are
+    // looked up by finish.
+    for (size_t i = 0; i < AREA_BIN_SCRIPT_LAST; i++) {
+        if (object.scripts[i].size) {
+            StringView scriptName;
+            CHECK(stringAt(object.scripts[i], scriptName));
+            pendingScripts.push_back(PendingScript{
+                    {object.x, object.y, object.z,
+                     object.x + object.width, object.y + object.height,
+                     object.z + 1},
+                    static_cast<TileGrid::ScriptType>(i),
+                    scriptName});
+        }
+    }
+
+    Exit exits[EXITS_LENGTH];
+    uint32_t wide[EXITS_LENGTH] = {};
+    uint32_t nextExit = object.firstExit;
+
+    for (size_t i = 0; i < EXITS_LENGTH; i++) {
+        if (!(object.exits & (1 << i))) {
+            continue;
+        }
+
+        CHECK(nextExit < header.exits.count);
+        AreaBinExit exit = recordAt<AreaBinExit>(data, header.exits, nextExit);
+        nextExit++;
+
+        StringView area;
+        CHECK(stringAt(exit.area, area));
+
+        exits[i] = {area, {exit.x, exit.y, exit.z}};
+        wide[i] = exit.wide;
+    }
+
+    for (int y = object.y; y < object.y + object.height; y++) {
+        for (int x = object.x; x < object.x + object.width; x++) {
+            icoord tile = {x, y, object.z};
+
+            if (object.flags) {
+                grid.addFlags(tile, object.flags);
+            }
+            for (size_t i = 0; i < EXITS_LENGTH; i++) {
+                if (object.exits & (1 << i)) {
+                    Exit exit = exits[i];
+                    if (wide[i] & AREA_BIN_EXIT_WIDE_X) {
+                        exit.coords.x += x - object.x;
+                    }
+                    if (wide[i] & AREA_BIN_EXIT_WIDE_Y) {
+                        exit.coords.y += y - object.y;
+                    }
+                    CHECK(grid.setExit(tile, static_cast<ExitDirection>(i),
+                                       exit));
+                }
+            }
+            for (size_t i = 0; i < EXITS_LENGTH; i++) {
+                if (object.layermods & (1 << i)) {
+                    CHECK(grid.setLayermod(tile,
+                                           static_cast<ExitDirection>(i),
+                                           object.layermodDepths[i]));
+                }
+            }
+        }
+    }
+
+    return true;
+}
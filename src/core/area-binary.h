@@ -0,0 +1,55 @@
+/********************************
+** Tsunagari Tile Engine       **
+** area-binary.h               **
+** Copyright 2020 Paul Merrill **
+********************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#ifndef SRC_CORE_AREA_BINARY_H_
+#define SRC_CORE_AREA_BINARY_H_
+
+#include "util/string-view.h"
+
+class Area;
+class Player;
+
+// Load the area compiled from the Tiled map at filename by `pack-tool create
+// --compile-areas`. Returns null if the world has no usable compiled copy of
+// it, including when the copy is corrupt or its tilesets have changed since it
+// was compiled, in which case the map itself should be loaded with
+// makeAreaFromJSON.
+Area*
+makeAreaFromBinary(Player* player, StringView filename) noexcept;
+
+// makeAreaFromBinary in two steps. prepareAreaFromBinary reads the compiled
+// area and builds its layers and objects, and can run on any thread. It
+// returns null in the same cases as makeAreaFromBinary. finishAreaFromBinary
+// must then be called on the main thread to load the tilesets and look up the
+// area's scripts before the area is used. If that fails it deletes the area
+// and returns false, and the map should be loaded with makeAreaFromJSON
+// instead.
+Area*
+prepareAreaFromBinary(Player* player, StringView filename) noexcept;
+bool
+finishAreaFromBinary(Area* area) noexcept;
+
+#endif  // SRC_CORE_AREA_BINARY_H_
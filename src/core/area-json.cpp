@@ -39,10 +39,12 @@
 #include "core/tile.h"
 #include "core/window.h"
 #include "core/world.h"
-#include "data/data-world.h"
 #include "os/c.h"
 #include "util/assert.h"
+#include "util/base64.h"
+#include "util/inflate.h"
 #include "util/int.h"
+#include "util/json-reader.h"
 #include "util/math2.h"
 #include "util/string2.h"
 #include "util/vector.h"
@@ -60,9 +62,30 @@
 
 class AreaJSON : public Area {
  public:
+    // Parses all but the tileset images.
     AreaJSON(Player* player, StringView filename) noexcept;
 
+    // Load the tileset images and scripts, which needs the main thread.
+    void
+    finish() noexcept;
+
  private:
+    //! An animated tile, by the indexes of its frames in its tileset.
+    struct PendingAnimation {
+        int id;
+        Vector<int> frames;
+        int frameLen;
+    };
+
+    //! A tileset whose image is loaded by finish.
+    struct PendingTileSet {
+        String image;
+        unsigned tileWidth, tileHeight;
+        int firstGid;
+        int tileCount;
+        Vector<PendingAnimation> animations;
+    };
+
     //! Allocate Tile objects for one layer of map.
     void
     allocateMapLayer(TileGrid::LayerType type) noexcept;
@@ -71,6 +94,8 @@ class AreaJSON : public Area {
     bool
     processDescriptor() noexcept;
     bool
+    processMap(JsonReader& reader) noexcept;
+    bool
     processMapProperties(JsonValue obj) noexcept;
     bool
     processTileSet(JsonValue obj) noexcept;
@@ -78,15 +103,23 @@ class AreaJSON : public Area {
     processTileSetFile(JsonValue obj, StringView source, int firstGid) noexcept;
     bool
     processTileType(JsonValue obj,
-                    Animation& graphic,
-                    TiledImage img,
+                    PendingAnimation& animation,
+                    int nTiles,
                     int id) noexcept;
     bool
-    processLayer(JsonValue obj) noexcept;
+    loadTileSet(PendingTileSet& tileSet) noexcept;
+    bool
+    processLayer(JsonValue obj, JsonReader* data) noexcept;
     bool
     processLayerProperties(JsonValue obj) noexcept;
     bool
-    processLayerData(JsonValue arr) noexcept;
+    processLayerData(JsonReader& data,
+                     JsonValue encoding,
+                     JsonValue compression) noexcept;
+    bool
+    processLayerArray(JsonReader& data) noexcept;
+    bool
+    processLayerGids(const uint32_t* gids, size_t count) noexcept;
     bool
     processObjectGroup(JsonValue obj) noexcept;
     bool
@@ -106,28 +139,116 @@ class AreaJSON : public Area {
               unsigned char& r,
               unsigned char& g,
               unsigned char& b) noexcept;
+
+ private:
+    //! Holds every JSON document parsed while loading, and is freed at the
+    //! end.
+    JsonAllocator scratch;
+
+    Vector<PendingTileSet> pendingTileSets;
+
+    //! TileType #0 and those of every tileset.
+    int tileTypeCount = 1;
 };
 
 
 Area*
 makeAreaFromJSON(Player* player, StringView filename) noexcept {
+    Area* area = prepareAreaFromJSON(player, filename);
+    finishAreaFromJSON(area);
+    return area;
+}
+
+Area*
+prepareAreaFromJSON(Player* player, StringView filename) noexcept {
     return new AreaJSON(player, filename);
 }
 
+void
+finishAreaFromJSON(Area* area) noexcept {
+    static_cast<AreaJSON*>(area)->finish();
+}
+
 
 AreaJSON::AreaJSON(Player* player, StringView descriptor) noexcept {
     TimeMeasure m(String() << "Constructed " << descriptor << " as area-json");
 
-    dataArea = dataWorldArea(descriptor);
     this->player = player;
     this->descriptor = descriptor;
 
-    // Add TileType #0. Not used, but Tiled's gids start from 1.
-    tileGraphics.resize(1);
-
     ok = processDescriptor();
 }
 
+void
+AreaJSON::finish() noexcept {
+    if (ok) {
+        TimeMeasure m(String() << "Loaded tilesets of " << descriptor);
+
+        // Add TileType #0. Not used, but Tiled's gids start from 1.
+        tileGraphics.resize(1);
+
+        for (PendingTileSet& tileSet : pendingTileSets) {
+            if (!loadTileSet(tileSet)) {
+                ok = false;
+                break;
+            }
+        }
+    }
+
+    pendingTileSets = Vector<PendingTileSet>();
+
+    if (ok) {
+        ok = resolveScripts();
+    }
+}
+
+bool
+AreaJSON::loadTileSet(PendingTileSet& tileSet) noexcept {
+    assert_(tileSet.firstGid == tileGraphics.size);
+
+    TiledImage images =
+            tilesLoad(tileSet.image, tileSet.tileWidth, tileSet.tileHeight);
+    if (!TILES_VALID(images)) {
+        logErr(descriptor, "Tileset image not found");
+        return false;
+    }
+
+    // The layers were checked against the size of the image given in the
+    // tileset file, so any tiles past it are not used.
+    int nTiles = tileSet.tileCount;
+    if (static_cast<int>(images.numTiles) < nTiles) {
+        logErr(descriptor,
+               String() << tileSet.image << ": image is smaller than the "
+                        << "tileset says");
+        return false;
+    }
+
+    tileGraphics.reserve(tileGraphics.size + nTiles);
+
+    // Initialize "vanilla" tile type array.
+    for (int i = 0; i < nTiles; i++) {
+        Image image = tileAt(images, i);
+        tileGraphics.push_back(Animation(image));
+    }
+
+    time_t now = worldTime();
+
+    for (PendingAnimation& animation : tileSet.animations) {
+        Vector<Image> frames;
+        frames.reserve(animation.frames.size);
+        for (int idx : animation.frames) {
+            frames.push_back(tileAt(images, idx));
+        }
+
+        Animation& graphic = tileGraphics[tileSet.firstGid + animation.id];
+        graphic = Animation(static_cast<Vector<Image>&&>(frames),
+                            animation.frameLen);
+        graphic.restart(now);
+    }
+
+    return true;
+}
+
 void
 AreaJSON::allocateMapLayer(TileGrid::LayerType type) noexcept {
     ivec3 dim = grid.dim;
@@ -137,15 +258,100 @@ AreaJSON::allocateMapLayer(TileGrid::LayerType type) noexcept {
     assert_(0 <= dim.x);
     assert_(0 <= dim.z);
 
-    grid.layerTypes.push_back(type);
+    grid.addLayer(type);
+}
 
-    grid.graphics.resize(grid.graphics.size + dim.x * dim.y);
-    grid.dim.z++;
+/**
+ * dirname
+ *
+ * Returns the directory component of a path, including trailing slash.  If
+ * there is no directory component, return an empty string.
+ */
+static StringView
+dirname(StringView path) noexcept {
+    StringPosition slash = path.rfind('/');
+    return slash == SV_NOT_FOUND
+        ? ""
+        : path.substr(0, slash + 1);
+}
+
+// Copy the object whose '{' reader just read to text, leaving out the member
+// named skippedKey, which can be large. If it is there, skipped is left just
+// before it so it can be read later.
+static bool
+readObjectExcept(JsonReader& reader,
+                 StringView skippedKey,
+                 String& text,
+                 JsonReader& skipped,
+                 bool& found) noexcept {
+    text << '{';
+
+    found = false;
+
+    while (true) {
+        JsonReader member = reader;
+
+        JsonToken token = reader.next();
+        if (token == JSON_TOKEN_OBJECT_END) {
+            break;
+        }
+        CHECK(token != JSON_TOKEN_ERROR);
+
+        if (reader.key == skippedKey) {
+            skipped = static_cast<JsonReader&&>(member);
+            found = true;
+            CHECK(reader.skip());
+            continue;
+        }
+
+        StringView memberText;
+        CHECK(reader.captureMember(memberText));
+        if (text.size > 1) {
+            text << ',';
+        }
+        text << memberText;
+    }
+
+    text << '}';
+    return true;
 }
 
 bool
 AreaJSON::processDescriptor() noexcept {
-    JsonDocument doc = loadJson(descriptor);
+    // Read the map straight out of the resource. Everything but the tile
+    // layers' data is small and is parsed into documents as before, but the
+    // layers are streamed into the grid.
+    StringView text;
+    if (!resourceLoad(descriptor, text)) {
+        return false;
+    }
+
+    JsonReader reader(text);
+    bool ok = processMap(reader);
+
+    resourceRelease(descriptor);
+
+    logInfo("AreaJSON",
+            String() << descriptor << ": JSON used " << scratch.stats.peak
+                     << " bytes in " << scratch.stats.mallocs << " blocks");
+    scratch.deallocate();
+
+    return ok;
+}
+
+bool
+AreaJSON::processMap(JsonReader& reader) noexcept {
+    CHECK(reader.next() == JSON_TOKEN_OBJECT_BEGIN);
+
+    // The layers need the map's size and tilesets, which Tiled writes after
+    // them, so come back to them at the end.
+    String rootText;
+    JsonReader layers = reader;
+    bool hasLayers;
+    CHECK(readObjectExcept(reader, "layers", rootText, layers, hasLayers));
+    CHECK(reader.next() == JSON_TOKEN_END);
+
+    JsonDocument doc(static_cast<String&&>(rootText), scratch);
     CHECK(doc.ok);
 
     JsonValue root = doc.root;
@@ -154,13 +360,12 @@ AreaJSON::processDescriptor() noexcept {
     JsonValue heightValue = root["height"];
     JsonValue propertiesValue = root["properties"];
     JsonValue tilesetsValue = root["tilesets"];
-    JsonValue layersValue = root["layers"];
 
     CHECK(widthValue.isNumber());
     CHECK(heightValue.isNumber());
     CHECK(propertiesValue.isObject());
     CHECK(tilesetsValue.isArray());
-    CHECK(layersValue.isArray());
+    CHECK(hasLayers);
 
     grid.dim.x = widthValue.toInt();
     grid.dim.y = heightValue.toInt();
@@ -170,6 +375,20 @@ AreaJSON::processDescriptor() noexcept {
 
     CHECK(tilesetsValue.toNode());
 
+    // Start paging in the tilesets and music before we need them.
+    Vector<String> prefetches;
+    for (JsonNode& tilesetNode : tilesetsValue) {
+        JsonValue sourceValue = tilesetNode.value["source"];
+        if (sourceValue.isString()) {
+            prefetches.push_back(String() << dirname(descriptor)
+                                          << sourceValue.toString());
+        }
+    }
+    if (musicPath.size) {
+        prefetches.push_back(musicPath);
+    }
+    resourcePrefetch(prefetches);
+
     for (JsonNode& tilesetNode : tilesetsValue) {
         JsonValue tilesetValue = tilesetNode.value;
         CHECK(tilesetValue.isObject());
@@ -177,11 +396,24 @@ AreaJSON::processDescriptor() noexcept {
         CHECK(processTileSet(tilesetValue));
     }
 
-    CHECK(layersValue.toNode());
+    CHECK(layers.next() == JSON_TOKEN_ARRAY_BEGIN);
+
+    while (true) {
+        JsonToken token = layers.next();
+        if (token == JSON_TOKEN_ARRAY_END) {
+            break;
+        }
+        CHECK(token == JSON_TOKEN_OBJECT_BEGIN);
 
-    for (JsonNode& layerNode : layersValue) {
-        JsonValue layerValue = layerNode.value;
-        CHECK(layerValue.isObject());
+        String layerText;
+        JsonReader data = layers;
+        bool hasData;
+        CHECK(readObjectExcept(layers, "data", layerText, data, hasData));
+
+        JsonDocument layerDoc(static_cast<String&&>(layerText), scratch);
+        CHECK(layerDoc.ok);
+
+        JsonValue layerValue = layerDoc.root;
 
         JsonValue typeValue = layerValue["type"];
         CHECK(typeValue.isString());
@@ -189,7 +421,7 @@ AreaJSON::processDescriptor() noexcept {
         StringView type = typeValue.toString();
 
         if (type == "tilelayer") {
-            CHECK(processLayer(layerValue));
+            CHECK(processLayer(layerValue, hasData ? &data : 0));
         }
         else if (type == "objectgroup") {
             CHECK(processObjectGroup(layerValue));
@@ -247,20 +479,6 @@ AreaJSON::processMapProperties(JsonValue obj) noexcept {
     return true;
 }
 
-/**
- * dirname
- *
- * Returns the directory component of a path, including trailing slash.  If
- * there is no directory component, return an empty string.
- */
-static StringView
-dirname(StringView path) noexcept {
-    StringPosition slash = path.rfind('/');
-    return slash == SV_NOT_FOUND
-        ? ""
-        : path.substr(0, slash + 1);
-}
-
 bool
 AreaJSON::processTileSet(JsonValue obj) noexcept {
     /*
@@ -282,7 +500,7 @@ AreaJSON::processTileSet(JsonValue obj) noexcept {
 
     // We don't handle embeded tilesets, only references to an external JSON
     // files.
-    JsonDocument doc = loadJson(source);
+    JsonDocument doc = loadJson(source, scratch);
     if (!doc.ok) {
         logErr(descriptor, String() << source << ": failed to load JSON file");
         return false;
@@ -319,7 +537,7 @@ AreaJSON::processTileSetFile(JsonValue obj,
      }
     */
 
-    assert_(firstGid == tileGraphics.size);
+    assert_(firstGid == tileTypeCount);
 
     unsigned tilex, tiley;
     unsigned pixelw, pixelh;
@@ -357,26 +575,26 @@ AreaJSON::processTileSetFile(JsonValue obj,
     width = pixelw / grid.tileDim.x;
     height = pixelh / grid.tileDim.y;
 
+    // Tiles are numbered across the image, as tilesLoad does. The image is
+    // loaded by finish.
+    uint64_t tileCount = static_cast<uint64_t>(width) * height;
+    CHECK(tileCount <= static_cast<uint64_t>(INT32_MAX - tileTypeCount));
+    int nTiles = static_cast<int>(tileCount);
+
     String imgSource = String() << dirname(source) << imageNode.toString();
     tileSets[imgSource] = TileSet{firstGid, (size_t)width, (size_t)height};
 
-    // Load tileset image.
-    TiledImage images = tilesLoad(imgSource, tilex, tiley);
-    if (!TILES_VALID(images)) {
-        logErr(descriptor, "Tileset image not found");
-        return false;
-    }
+    PendingTileSet tileSet;
+    tileSet.image = imgSource;
+    tileSet.tileWidth = tilex;
+    tileSet.tileHeight = tiley;
+    tileSet.firstGid = firstGid;
+    tileSet.tileCount = nTiles;
 
-    int nTiles = images.numTiles;
-    tileGraphics.reserve(tileGraphics.size + nTiles);
-
-    // Initialize "vanilla" tile type array.
-    for (int i = 0; i < nTiles; i++) {
-        Image image = tileAt(images, i);
-        tileGraphics.push_back(Animation(image));
-    }
+    tileTypeCount += nTiles;
 
     if (!tilespropertiesNode.isObject()) {
+        pendingTileSets.push_back(static_cast<PendingTileSet&&>(tileSet));
         return true;
     }
 
@@ -402,25 +620,26 @@ AreaJSON::processTileSetFile(JsonValue obj,
             return false;
         }
 
-        // "gid" is the global area-wide id of the tile.
-        int gid = id_ + firstGid;
-
-        Animation& graphic = tileGraphics[gid];
+        PendingAnimation animation;
+        animation.id = id_;
         if (!processTileType(tilepropertiesNode.value,
-                             graphic,
-                             images,
-                             static_cast<int>(id_))) {
+                             animation,
+                             nTiles,
+                             id_)) {
             return false;
         }
+        tileSet.animations.push_back(
+                static_cast<PendingAnimation&&>(animation));
     }
 
+    pendingTileSets.push_back(static_cast<PendingTileSet&&>(tileSet));
     return true;
 }
 
 bool
 AreaJSON::processTileType(JsonValue obj,
-                          Animation& graphic,
-                          TiledImage images,
+                          PendingAnimation& animation,
+                          int nTiles,
                           int id) noexcept {
     /*
       {
@@ -438,11 +657,6 @@ AreaJSON::processTileType(JsonValue obj,
     CHECK(framesNode.isString() && speedNode.isNumber());
 
     // If a Tile is animated, it needs both member frames and a speed.
-    Vector<Image> framesvec;
-    int frameLen;
-
-    int nTiles = images.numTiles;
-
     Vector<StringView> frames = splitStr(framesNode.toString(), ",");
     CHECK(frames.size);
 
@@ -481,23 +695,18 @@ AreaJSON::processTileType(JsonValue obj,
             return false;
         }
 
-        framesvec.push_back(tileAt(images, idx));
+        animation.frames.push_back(idx);
     }
 
     float hertz = static_cast<float>(speedNode.toNumber());
     CHECK(hertz > 0.0f);
-    frameLen = static_cast<int>(1000.0f / hertz);
-
-    // Add 'now' to Animation constructor??
-    time_t now = worldTime();
-    graphic = Animation(static_cast<Vector<Image>&&>(framesvec), frameLen);
-    graphic.restart(now);
+    animation.frameLen = static_cast<int>(1000.0f / hertz);
 
     return true;
 }
 
 bool
-AreaJSON::processLayer(JsonValue obj) noexcept {
+AreaJSON::processLayer(JsonValue obj, JsonReader* data) noexcept {
     /*
      {
        "data": [9, 9, 9, ..., 3, 9, 9],
@@ -512,12 +721,13 @@ AreaJSON::processLayer(JsonValue obj) noexcept {
     JsonValue widthValue = obj["width"];
     JsonValue heightValue = obj["height"];
     JsonValue propertiesValue = obj["properties"];
-    JsonValue dataValue = obj["data"];
+    JsonValue encodingValue = obj["encoding"];
+    JsonValue compressionValue = obj["compression"];
 
     CHECK(widthValue.isNumber());
     CHECK(heightValue.isNumber());
     CHECK(propertiesValue.isObject());
-    CHECK(dataValue.isArray());
+    CHECK(data);
 
     const int x = widthValue.toInt();
     const int y = heightValue.toInt();
@@ -530,7 +740,7 @@ AreaJSON::processLayer(JsonValue obj) noexcept {
     allocateMapLayer(TileGrid::LayerType::TILE_LAYER);
 
     CHECK(processLayerProperties(propertiesValue));
-    CHECK(processLayerData(dataValue));
+    CHECK(processLayerData(*data, encodingValue, compressionValue));
 
     return true;
 }
@@ -565,40 +775,139 @@ AreaJSON::processLayerProperties(JsonValue obj) noexcept {
 }
 
 bool
-AreaJSON::processLayerData(JsonValue arr) noexcept {
+AreaJSON::processLayerData(JsonReader& data,
+                           JsonValue encoding,
+                           JsonValue compression) noexcept {
     /*
      [9, 9, 9, ..., 3, 9, 9]
+
+     Or, if encoding is "base64", the same gids as little-endian 32-bit
+     integers, optionally compressed with "zlib" or "gzip".
     */
 
-    const size_t z = static_cast<size_t>(grid.dim.z) - 1;
+    JsonToken token = data.next();
 
-    // If we ever allow finding layers out of order.
-    // assert_(0 <= z && z < dim.z);
+    if (token == JSON_TOKEN_ARRAY_BEGIN) {
+        return processLayerArray(data);
+    }
 
-    size_t x = 0, y = 0;
+    if (token != JSON_TOKEN_STRING) {
+        logErr(descriptor, "Layer data must be an array or base64");
+        return false;
+    }
 
-    for (JsonNode& node : arr) {
-        CHECK(node.value.isNumber());
+    if (!encoding.isString() || encoding.toString() != "base64") {
+        logErr(descriptor, "Layer data must be an array or base64");
+        return false;
+    }
 
-        unsigned gid = node.value.toInt();
+    StringView text = data.string;
+    StringView method = compression.isString() ? compression.toString() : "";
 
-        if (gid >= tileGraphics.size) {
-            logErr(descriptor, "Invalid tile gid");
+    // Decode straight into the gids. Every platform we support is
+    // little-endian.
+    Vector<uint32_t> gids;
+    gids.resize(static_cast<size_t>(grid.dim.x) * grid.dim.y);
+    uint8_t* bytes = reinterpret_cast<uint8_t*>(gids.data);
+    size_t byteCount = gids.size * sizeof(uint32_t);
+
+    bool ok;
+    if (method.size == 0) {
+        ok = base64DecodedSize(text) == byteCount &&
+             base64Decode(text, bytes);
+    }
+    else if (method == "zlib" || method == "gzip") {
+        size_t compressedSize = base64DecodedSize(text);
+        uint8_t* compressed = static_cast<uint8_t*>(malloc(compressedSize));
+
+        ok = compressedSize > 0 && base64Decode(text, compressed);
+        if (ok && method == "zlib") {
+            ok = zlibDecompress(compressed, compressedSize, bytes, byteCount);
+        }
+        else if (ok) {
+            ok = gzipDecompress(compressed, compressedSize, bytes, byteCount);
+        }
+
+        free(compressed);
+    }
+    else {
+        logErr(descriptor,
+               String() << "Unsupported layer compression \"" << method
+                        << "\"");
+        return false;
+    }
+
+    if (!ok) {
+        logErr(descriptor, "Corrupt layer data");
+        return false;
+    }
+
+    return processLayerGids(gids.data, gids.size);
+}
+
+bool
+AreaJSON::processLayerArray(JsonReader& data) noexcept {
+    size_t layerSize = static_cast<size_t>(grid.dim.x) * grid.dim.y;
+
+    Vector<int> graphics;
+    graphics.resize(layerSize);
+    double gidEnd = static_cast<double>(tileTypeCount);
+
+    size_t count = 0;
+    JsonToken token;
+    while ((token = data.next()) == JSON_TOKEN_NUMBER) {
+        if (count == layerSize) {
+            logErr(descriptor, "layer data size != map x,y size");
             return false;
         }
 
-        size_t idx = (z * grid.dim.y + y) * grid.dim.x + x;
+        double gid = data.number;
+
+        if (!(0 <= gid && gid < gidEnd)) {
+            logErr(descriptor, "Invalid tile gid");
+            return false;
+        }
 
         // A gid of zero means there is no tile at this
         // position on this layer.
-        grid.graphics[idx] = gid;
+        graphics[count++] = static_cast<int>(gid);
+    }
+
+    CHECK(token == JSON_TOKEN_ARRAY_END);
+
+    if (count != layerSize) {
+        logErr(descriptor, "layer data size != map x,y size");
+        return false;
+    }
+
+    grid.setLayer(grid.dim.z - 1, graphics.data);
+    return true;
+}
 
-        if (++x == static_cast<size_t>(grid.dim.x)) {
-            x = 0;
-            y++;
+bool
+AreaJSON::processLayerGids(const uint32_t* gids, size_t count) noexcept {
+    size_t layerSize = static_cast<size_t>(grid.dim.x) * grid.dim.y;
+    if (count != layerSize) {
+        logErr(descriptor, "layer data size != map x,y size");
+        return false;
+    }
+
+    Vector<int> graphics;
+    graphics.resize(layerSize);
+    for (size_t i = 0; i < count; i++) {
+        uint32_t gid = gids[i];
+
+        if (gid >= static_cast<uint32_t>(tileTypeCount)) {
+            logErr(descriptor, "Invalid tile gid");
+            return false;
         }
+
+        // A gid of zero means there is no tile at this
+        // position on this layer.
+        graphics[i] = static_cast<int>(gid);
     }
 
+    grid.setLayer(grid.dim.z - 1, graphics.data);
     return true;
 }
 
@@ -721,16 +1030,16 @@ AreaJSON::processObject(JsonValue obj) noexcept {
     CHECK(layermodValue.isNull() ||
           (layermodValue.isString() &&
            parseFloat(f, layermodValue.toString())));
-    CHECK(layermodValue.isNull() ||
+    CHECK(layermodupValue.isNull() ||
             (layermodupValue.isString() &&
              parseFloat(f, layermodupValue.toString())));
-    CHECK(layermodValue.isNull() ||
+    CHECK(layermoddownValue.isNull() ||
             (layermoddownValue.isString() &&
              parseFloat(f, layermoddownValue.toString())));
-    CHECK(layermodValue.isNull() ||
+    CHECK(layermodleftValue.isNull() ||
             (layermodleftValue.isString() &&
              parseFloat(f, layermodleftValue.toString())));
-    CHECK(layermodValue.isNull() ||
+    CHECK(layermodrightValue.isNull() ||
           (layermodrightValue.isString() &&
            parseFloat(f, layermodrightValue.toString())));
 
@@ -742,7 +1051,6 @@ AreaJSON::processObject(JsonValue obj) noexcept {
     // Gather object properties now. Assign them to tiles later.
     bool wwide[5] = {}, hwide[5] = {};  // Wide exit in width or height.
 
-    DataArea::TileScript enterScript = 0, leaveScript = 0, useScript = 0;
     bool haveExit[5] = {};
     Exit exit[5];
     bool haveLayermod[5] = {};
@@ -753,19 +1061,6 @@ AreaJSON::processObject(JsonValue obj) noexcept {
         CHECK(splitTileFlags(flagsValue.toString(), &flags));
     }
 
-    if (onenterValue.isString()) {
-        StringView scriptName = onenterValue.toString();
-        enterScript = dataArea->scripts[scriptName];
-    }
-    if (onleaveValue.isString()) {
-        StringView scriptName = onleaveValue.toString();
-        leaveScript = dataArea->scripts[scriptName];
-    }
-    if (onuseValue.isString()) {
-        StringView scriptName = onuseValue.toString();
-        useScript = dataArea->scripts[scriptName];
-    }
-
     if (exitValue.isString()) {
         haveExit[EXIT_NORMAL] = true;
         StringView value = exitValue.toString();
@@ -836,40 +1131,50 @@ AreaJSON::processObject(JsonValue obj) noexcept {
     CHECK(x + w <= grid.dim.x);
     CHECK(y + h <= grid.dim.y);
 
+    // The scripts are looked up by finish.
+    icube tiles = {x, y, static_cast<int>(z), x + w, y + h,
+                   static_cast<int>(z) + 1};
+    if (onenterValue.isString()) {
+        pendingScripts.push_back(PendingScript{
+                tiles, TileGrid::SCRIPT_TYPE_ENTER, onenterValue.toString()});
+    }
+    if (onleaveValue.isString()) {
+        pendingScripts.push_back(PendingScript{
+                tiles, TileGrid::SCRIPT_TYPE_LEAVE, onleaveValue.toString()});
+    }
+    if (onuseValue.isString()) {
+        pendingScripts.push_back(PendingScript{
+                tiles, TileGrid::SCRIPT_TYPE_USE, onuseValue.toString()});
+    }
+
     // We know which Tiles are being talked about now... yay
     for (int Y = y; Y < y + h; Y++) {
         for (int X = x; X < x + w; X++) {
             icoord tile = {X, Y, static_cast<int>(z)};
 
-            grid.flags[tile] |= flags;
+            if (flags) {
+                grid.addFlags(tile, flags);
+            }
             for (size_t i = 0; i < EXITS_LENGTH; i++) {
                 if (haveExit[i]) {
-                    int dx = X - x;
-                    int dy = Y - y;
+                    Exit tileExit = exit[i];
                     if (wwide[i]) {
-                        exit[i].coords.x += dx;
+                        tileExit.coords.x += X - x;
                     }
                     if (hwide[i]) {
-                        exit[i].coords.y += dy;
+                        tileExit.coords.y += Y - y;
                     }
-                    grid.exits[i][tile] = static_cast<Exit&&>(exit[i]);
+                    CHECK(grid.setExit(tile, static_cast<ExitDirection>(i),
+                                       tileExit));
                 }
             }
             for (size_t i = 0; i < EXITS_LENGTH; i++) {
                 if (haveLayermod[i]) {
-                    grid.layermods[i][tile] = layermod[i];
+                    CHECK(grid.setLayermod(tile,
+                                           static_cast<ExitDirection>(i),
+                                           layermod[i]));
                 }
             }
-
-            if (enterScript) {
-                grid.scripts[TileGrid::SCRIPT_TYPE_ENTER][tile] = enterScript;
-            }
-            if (leaveScript) {
-                grid.scripts[TileGrid::SCRIPT_TYPE_LEAVE][tile] = leaveScript;
-            }
-            if (useScript) {
-                grid.scripts[TileGrid::SCRIPT_TYPE_USE][tile] = useScript;
-            }
         }
     }
 
@@ -959,10 +1264,13 @@ AreaJSON::parseExit(StringView dest,
         return false;
     }
 
-    if (x.find('+') != SV_NOT_FOUND) {
+    *wwide = x.find('+') != SV_NOT_FOUND;
+    *hwide = y.find('+') != SV_NOT_FOUND;
+
+    if (*wwide) {
         x = x.substr(0, x.size - 1);
     }
-    if (y.find('+') != SV_NOT_FOUND) {
+    if (*hwide) {
         y = y.substr(0, y.size - 1);
     }
 
@@ -976,9 +1284,6 @@ AreaJSON::parseExit(StringView dest,
 
     exit = { area, x_, y_, z_ };
 
-    *wwide = x.find('+') != SV_NOT_FOUND;
-    *hwide = y.find('+') != SV_NOT_FOUND;
-
     return true;
 }
 
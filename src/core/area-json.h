@@ -36,4 +36,14 @@ class Player;
 Area*
 makeAreaFromJSON(Player* player, StringView filename) noexcept;
 
+// makeAreaFromJSON in two steps, as with makeAreaFromBinary.
+// prepareAreaFromJSON parses the map and its tilesets and can run on any
+// thread. finishAreaFromJSON must then be called on the main thread to load the
+// tileset images and look up the area's scripts before the area is used. If
+// either step fails the area is not ok.
+Area*
+prepareAreaFromJSON(Player* player, StringView filename) noexcept;
+void
+finishAreaFromJSON(Area* area) noexcept;
+
 #endif  // SRC_CORE_AREA_JSON_H_
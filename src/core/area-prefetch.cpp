@@ -0,0 +1,237 @@
+/********************************
+** Tsunagari Tile Engine       **
+** area-prefetch.cpp           **
+** Copyright 2020 Paul Merrill **
+********************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#include "core/area-prefetch.h"
+
+#include "core/area-binary.h"
+#include "core/area-json.h"
+#include "core/area.h"
+#include "core/player.h"
+#include "core/tile-grid.h"
+#include "os/condition-variable.h"
+#include "os/mutex.h"
+#include "util/jobs.h"
+#include "util/move.h"
+#include "util/sort.h"
+#include "util/vector.h"
+
+// Prefetched areas stay in memory once built, so only those with the nearest
+// exits are prepared.
+#define PREFETCH_AREAS 4
+
+// An area an exit leads to.
+struct Destination {
+    String area;
+    int distance;  // From the player to the nearest exit to it, in tiles.
+};
+
+// An area built on the job pool that still needs its tilesets.
+struct PreparedArea {
+    String filename;
+    Area* area;
+    bool compiled;  // Whether area is an AreaBinary rather than an AreaJSON.
+};
+
+// Guards everything below.
+static Mutex mutex;
+
+// Areas waiting to be prepared, the nearest last.
+static Vector<String> queue;
+
+// The player the areas are prepared for.
+static Player* player = 0;
+
+// Whether the job preparing the queued areas one after the other is running,
+// and the area it is on.
+static bool jobRunning = false;
+static String preparing;
+
+static Vector<PreparedArea> prepared;
+
+// Signalled when the job finishes an area.
+static ConditionVariable preparedOne;
+
+static int
+distance(icoord a, icoord b) noexcept {
+    int dx = a.x < b.x ? b.x - a.x : a.x - b.x;
+    int dy = a.y < b.y ? b.y - a.y : a.y - b.y;
+    int dz = a.z < b.z ? b.z - a.z : a.z - b.z;
+    return dx + dy + dz;
+}
+
+static void
+prefetchJob() noexcept {
+    while (true) {
+        String filename;
+        Player* p;
+        {
+            LockGuard lock(mutex);
+            if (queue.size == 0) {
+                jobRunning = false;
+                return;
+            }
+            filename = move_(queue[queue.size - 1]);
+            queue.pop_back();
+            preparing = filename;
+            p = player;
+        }
+
+        Area* area = prepareAreaFromBinary(p, filename);
+        bool compiled = area != 0;
+        if (!area) {
+            area = prepareAreaFromJSON(p, filename);
+        }
+
+        LockGuard lock(mutex);
+        prepared.push_back(PreparedArea{move_(filename), area, compiled});
+        preparing = "";
+        preparedOne.notifyAll();
+    }
+}
+
+void
+areaPrefetchExits(Area* area,
+                  Player* player_,
+                  Hashmap<String, Area*>& loaded) noexcept {
+    icoord from = player_->getTileCoords_i();
+
+    // There are few destinations, but many exits if they are wide.
+    Vector<Destination> destinations;
+    area->grid.forEachExit([&](icoord tile, Exit& exit) noexcept {
+        if (loaded.contains(exit.area)) {
+            return;
+        }
+
+        int d = distance(from, tile);
+        for (Destination& destination : destinations) {
+            if (destination.area == exit.area) {
+                if (d < destination.distance) {
+                    destination.distance = d;
+                }
+                return;
+            }
+        }
+        destinations.push_back(Destination{exit.area, d});
+    });
+
+    // Farthest first.
+    Destination* data = destinations.data;
+#define LESS(i, j) (data[i].distance > data[j].distance)
+#define SWAP(i, j) swap_(data[i], data[j])
+    QSORT(destinations.size, LESS, SWAP);
+#undef LESS
+#undef SWAP
+
+    size_t first = destinations.size > PREFETCH_AREAS
+                           ? destinations.size - PREFETCH_AREAS
+                           : 0;
+
+    LockGuard lock(mutex);
+
+    queue.clear();
+    player = player_;
+
+    for (size_t i = first; i < destinations.size; i++) {
+        String& filename = destinations[i].area;
+
+        bool already = jobRunning && StringView(preparing) == filename;
+        for (PreparedArea& p : prepared) {
+            already = already || StringView(p.filename) == filename;
+        }
+        if (!already) {
+            queue.push_back(move_(filename));
+        }
+    }
+
+    if (queue.size && !jobRunning) {
+        jobRunning = true;
+        JobsEnqueue([]() noexcept { prefetchJob(); });
+    }
+}
+
+// Returns false if area was compiled and has been deleted, as
+// finishAreaFromBinary does.
+static bool
+finishPrepared(Area* area, bool compiled) noexcept {
+    if (compiled) {
+        return finishAreaFromBinary(area);
+    }
+    finishAreaFromJSON(area);
+    return true;
+}
+
+Area*
+areaPrefetchTake(StringView filename) noexcept {
+    Area* area = 0;
+    bool compiled = false;
+    {
+        LockGuard lock(mutex);
+
+        for (size_t i = 0; i < queue.size; i++) {
+            if (StringView(queue[i]) == filename) {
+                queue.erase(i);
+                break;
+            }
+        }
+
+        while (jobRunning && StringView(preparing) == filename) {
+            preparedOne.wait(lock);
+        }
+
+        for (size_t i = 0; i < prepared.size; i++) {
+            if (StringView(prepared[i].filename) == filename) {
+                area = prepared[i].area;
+                compiled = prepared[i].compiled;
+                prepared.erase(i);
+                break;
+            }
+        }
+    }
+
+    if (area && !finishPrepared(area, compiled)) {
+        return 0;
+    }
+    return area;
+}
+
+Area*
+areaPrefetchTakeReady(String& filename) noexcept {
+    PreparedArea next;
+    {
+        LockGuard lock(mutex);
+        if (prepared.size == 0) {
+            return 0;
+        }
+        next = move_(prepared[0]);
+        prepared.erase(0);
+    }
+
+    if (!finishPrepared(next.area, next.compiled)) {
+        return 0;
+    }
+    filename = move_(next.filename);
+    return next.area;
+}
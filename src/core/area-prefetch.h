@@ -0,0 +1,62 @@
+/********************************
+** Tsunagari Tile Engine       **
+** area-prefetch.h             **
+** Copyright 2020 Paul Merrill **
+********************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#ifndef SRC_CORE_AREA_PREFETCH_H_
+#define SRC_CORE_AREA_PREFETCH_H_
+
+#include "util/hashtable.h"
+#include "util/noexcept.h"
+#include "util/string-view.h"
+#include "util/string.h"
+
+class Area;
+class Player;
+
+// Prepares the areas that the focused area's exits lead to on the job pool, so
+// that taking an exit does not stop the game while the next area loads.
+// Areas are read or parsed on the job pool and only have their tileset images
+// loaded and their scripts looked up on the main thread.
+
+// Queue the areas that area's exits lead to and that are not in loaded,
+// ordered by how near the player is to an exit to each. Areas still queued
+// for an area focused earlier are dropped.
+void
+areaPrefetchExits(Area* area,
+                  Player* player,
+                  Hashmap<String, Area*>& loaded) noexcept;
+
+// Take the prefetched area for filename, waiting for it if it is being
+// prepared. Returns null if it was not prefetched or if it was compiled and its
+// tilesets could not be loaded, in which case it must be loaded as usual. A map
+// that could not be loaded is returned, and is not ok.
+Area*
+areaPrefetchTake(StringView filename) noexcept;
+
+// Take any one prefetched area, or null if none are ready.
+Area*
+areaPrefetchTakeReady(String& filename) noexcept;
+
+#endif  // SRC_CORE_AREA_PREFETCH_H_
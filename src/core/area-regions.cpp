@@ -0,0 +1,231 @@
+/********************************
+** Tsunagari Tile Engine       **
+** area-regions.cpp            **
+** Copyright 2020 Paul Merrill **
+********************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#include "core/area-regions.h"
+
+#include "core/client-conf.h"
+#include "core/log.h"
+#include "core/resources.h"
+#include "core/tile-grid.h"
+#include "os/c.h"
+#include "pack/area-format.h"
+#include "util/assert.h"
+#include "util/jobs.h"
+#include "util/math2.h"
+#include "util/move.h"
+
+AreaRegions::AreaRegions(TileGrid& grid,
+                         StringView map,
+                         int regionSize,
+                         size_t tileTypeCount) noexcept
+        : grid(grid),
+          map(map),
+          regionSize(regionSize),
+          regionsX((grid.dim.x + regionSize - 1) / regionSize),
+          regionsY((grid.dim.y + regionSize - 1) / regionSize),
+          depth(grid.dim.z),
+          tileTypeCount(tileTypeCount) {
+    assert_(0 < regionSize && (regionSize & TILE_CHUNK_MASK) == 0);
+
+    states.resize(static_cast<size_t>(regionsX) * regionsY);
+}
+
+AreaRegions::~AreaRegions() noexcept {
+    // The jobs refer to this object.
+    LockGuard lock(mutex);
+    while (jobsInFlight > 0) {
+        jobDone.wait(lock);
+    }
+}
+
+bool
+AreaRegions::update(icube visible) noexcept {
+    bool changed = false;
+
+    // Take in the regions the jobs have read.
+    Vector<ReadRegion> done;
+    {
+        LockGuard lock(mutex);
+        done = move_(read);
+    }
+    for (ReadRegion& region : done) {
+        // It may have been read on the spot meanwhile.
+        if (states[region.index] == REGION_READING) {
+            putRegion(region.index, region.tiles);
+            changed = true;
+        }
+    }
+
+    // Looping areas can show tiles past their edges, which are not drawn.
+    int x1 = bound(visible.x1, 0, grid.dim.x);
+    int y1 = bound(visible.y1, 0, grid.dim.y);
+    int x2 = bound(visible.x2, 0, grid.dim.x);
+    int y2 = bound(visible.y2, 0, grid.dim.y);
+    if (x1 >= x2 || y1 >= y2) {
+        return changed;
+    }
+
+    // Regions on screen, from rx1, ry1 up to but not including rx2, ry2.
+    int rx1 = x1 / regionSize;
+    int ry1 = y1 / regionSize;
+    int rx2 = (x2 - 1) / regionSize + 1;
+    int ry2 = (y2 - 1) / regionSize + 1;
+
+    // The screen cannot wait for the job pool.
+    for (int ry = ry1; ry < ry2; ry++) {
+        for (int rx = rx1; rx < rx2; rx++) {
+            uint32_t index = static_cast<uint32_t>(ry * regionsX + rx);
+            if (states[index] != REGION_LOADED) {
+                Vector<int> tiles;
+                readRegion(index, tiles);
+                putRegion(index, tiles);
+                changed = true;
+            }
+        }
+    }
+
+    // Read the regions around the screen before they come into view.
+    int radius = confRegionRadius;
+    for (int ry = max(ry1 - radius, 0); ry < min(ry2 + radius, regionsY);
+         ry++) {
+        for (int rx = max(rx1 - radius, 0); rx < min(rx2 + radius, regionsX);
+             rx++) {
+            uint32_t index = static_cast<uint32_t>(ry * regionsX + rx);
+            if (states[index] != REGION_UNLOADED) {
+                continue;
+            }
+
+            states[index] = REGION_READING;
+            {
+                LockGuard lock(mutex);
+                jobsInFlight += 1;
+            }
+            JobsEnqueue([this, index]() noexcept { readJob(index); });
+        }
+    }
+
+    // Drop the regions out of reach. One more region is kept in each
+    // direction so that walking back and forth over a region's edge does not
+    // read it again each time.
+    int keep = radius + 1;
+    size_t kept = 0;
+    for (uint32_t index : loaded) {
+        int rx = static_cast<int>(index) % regionsX;
+        int ry = static_cast<int>(index) / regionsX;
+
+        if (rx1 - keep <= rx && rx < rx2 + keep && ry1 - keep <= ry &&
+            ry < ry2 + keep) {
+            loaded[kept++] = index;
+            continue;
+        }
+
+        int x, y, w, h;
+        regionRect(index, x, y, w, h);
+        grid.clearTiles(x, y, w, h);
+        states[index] = REGION_UNLOADED;
+        changed = true;
+    }
+    loaded.size = kept;
+
+    return changed;
+}
+
+void
+AreaRegions::regionRect(uint32_t index, int& x, int& y, int& w, int& h)
+        noexcept {
+    x = static_cast<int>(index) % regionsX * regionSize;
+    y = static_cast<int>(index) / regionsX * regionSize;
+    w = min(regionSize, grid.dim.x - x);
+    h = min(regionSize, grid.dim.y - y);
+}
+
+bool
+AreaRegions::readRegion(uint32_t index, Vector<int>& tiles) noexcept {
+    int x, y, w, h;
+    regionRect(index, x, y, w, h);
+
+    String path = areaBinRegionPath(map,
+                                    static_cast<int>(index) % regionsX,
+                                    static_cast<int>(index) / regionsX);
+
+    StringView data;
+    if (!resourceLoad(path, data)) {
+        return false;
+    }
+
+    size_t count = static_cast<size_t>(w) * h * depth;
+    bool ok = data.size == count * sizeof(int32_t);
+
+    if (ok) {
+        tiles.resize(count);
+        memcpy(tiles.data, data.data, data.size);
+
+        for (int type : tiles) {
+            if (static_cast<size_t>(static_cast<uint32_t>(type)) >=
+                tileTypeCount) {
+                ok = false;
+                break;
+            }
+        }
+    }
+
+    resourceRelease(path);
+
+    if (!ok) {
+        logErr(path, "Region is corrupt");
+        tiles.clear();
+    }
+    return ok;
+}
+
+void
+AreaRegions::readJob(uint32_t index) noexcept {
+    ReadRegion region;
+    region.index = index;
+    readRegion(index, region.tiles);
+
+    LockGuard lock(mutex);
+    read.push_back(move_(region));
+    jobsInFlight -= 1;
+    jobDone.notifyAll();
+}
+
+void
+AreaRegions::putRegion(uint32_t index, Vector<int>& tiles) noexcept {
+    // A region that could not be read is left empty rather than read again.
+    if (tiles.size) {
+        int x, y, w, h;
+        regionRect(index, x, y, w, h);
+
+        size_t layerSize = static_cast<size_t>(w) * h;
+        for (int z = 0; z < depth; z++) {
+            grid.setTiles(z, x, y, w, h, tiles.data + z * layerSize);
+        }
+    }
+
+    states[index] = REGION_LOADED;
+    loaded.push_back(index);
+}
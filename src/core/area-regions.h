@@ -0,0 +1,123 @@
+/********************************
+** Tsunagari Tile Engine       **
+** area-regions.h              **
+** Copyright 2020 Paul Merrill **
+********************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#ifndef SRC_CORE_AREA_REGIONS_H_
+#define SRC_CORE_AREA_REGIONS_H_
+
+#include "core/vec.h"
+#include "os/condition-variable.h"
+#include "os/mutex.h"
+#include "util/int.h"
+#include "util/noexcept.h"
+#include "util/string-view.h"
+#include "util/string.h"
+#include "util/vector.h"
+
+class TileGrid;
+
+// The tiles of a region read by a job, waiting to be put in the grid.
+struct ReadRegion {
+    uint32_t index;
+    Vector<int> tiles;  // Empty if the region could not be read.
+};
+
+// Loads the tiles of an area compiled by `pack-tool create --stream-areas` one
+// region at a time. Regions on screen are read right away, those within
+// confRegionRadius regions of the screen are read on the job pool, and those
+// further away are dropped, so only the tiles near the viewport are kept in
+// memory however large the area is.
+class AreaRegions {
+ public:
+    // The grid's layers must have been added already. map is the path of the
+    // area's Tiled map, which the regions are named after. Regions with gids
+    // of tileTypeCount or more are rejected.
+    AreaRegions(TileGrid& grid,
+                StringView map,
+                int regionSize,
+                size_t tileTypeCount) noexcept;
+
+    // Waits for any regions still being read.
+    ~AreaRegions() noexcept;
+
+    // Load the regions around the visible tiles and drop those far from
+    // them. Returns true if any tiles in the grid changed.
+    bool
+    update(icube visible) noexcept;
+
+ private:
+    // Position and size in tiles of a region, which is smaller at the right
+    // and bottom edges of the area.
+    void
+    regionRect(uint32_t index, int& x, int& y, int& w, int& h) noexcept;
+
+    // Read the tiles of a region. May be called from any thread.
+    bool
+    readRegion(uint32_t index, Vector<int>& tiles) noexcept;
+
+    // Read a region on the job pool.
+    void
+    readJob(uint32_t index) noexcept;
+
+    // Put the tiles of a region in the grid.
+    void
+    putRegion(uint32_t index, Vector<int>& tiles) noexcept;
+
+ private:
+    enum RegionState {
+        REGION_UNLOADED,
+        REGION_READING,
+        REGION_LOADED,
+    };
+
+    TileGrid& grid;
+    String map;
+    int regionSize;
+    int regionsX;
+    int regionsY;
+    int depth;
+    size_t tileTypeCount;
+
+    // A RegionState for each region, row by row.
+    Vector<uint8_t> states;
+
+    // The regions that are REGION_LOADED.
+    Vector<uint32_t> loaded;
+
+    // Guards read and jobsInFlight.
+    Mutex mutex;
+    Vector<ReadRegion> read;
+    int jobsInFlight = 0;
+
+    // Signalled when a job finishes.
+    ConditionVariable jobDone;
+
+ private:
+    AreaRegions(const AreaRegions&);
+    void
+    operator=(const AreaRegions&);
+};
+
+#endif  // SRC_CORE_AREA_REGIONS_H_
@@ -28,6 +28,7 @@
 #include "core/area.h"
 
 #include "core/algorithm.h"
+#include "core/area-regions.h"
 #include "core/client-conf.h"
 #include "core/display-list.h"
 #include "core/entity.h"
@@ -47,6 +48,16 @@
 #include "util/hashtable.h"
 #include "util/math2.h"
 
+Area::~Area() {
+    for (Character* character : characters) {
+        delete character;
+    }
+    for (Overlay* overlay : overlays) {
+        delete overlay;
+    }
+    delete regions;
+}
+
 void
 Area::focus() {
     if (!beenFocused) {
@@ -63,6 +74,34 @@ Area::focus() {
     if (dataArea) {
         dataArea->onFocus();
     }
+
+    if (regions && regions->update(visibleTiles())) {
+        redraw = true;
+    }
+}
+
+size_t
+Area::memoryUsage() {
+    size_t usage = sizeof(*this) + grid.memoryUsage() +
+                   tileSets.memoryUsage() +
+                   tileGraphics.capacity * sizeof(Animation) +
+                   checkedForAnimation.capacity * sizeof(bool) +
+                   tilesAnimated.capacity * sizeof(bool) +
+                   characters.capacity * sizeof(Character*) +
+                   overlays.capacity * sizeof(Overlay*) +
+                   pendingScripts.capacity * sizeof(PendingScript);
+
+    for (Animation& graphic : tileGraphics) {
+        usage += graphic.memoryUsage();
+    }
+    for (Character* character : characters) {
+        usage += sizeof(Character) + character->memoryUsage();
+    }
+    for (Overlay* overlay : overlays) {
+        usage += sizeof(Overlay) + overlay->memoryUsage();
+    }
+
+    return usage;
 }
 
 void
@@ -174,23 +213,20 @@ Area::needsRedraw() {
         if (grid.layerTypes[z] != TileGrid::LayerType::TILE_LAYER) {
             continue;
         }
-        for (int y = tiles.y1; y < tiles.y2; y++) {
-            for (int x = tiles.x1; x < tiles.x2; x++) {
-                int type = grid.getTileType(icoord{x, y, z});
-
-                if (type == 0) {
-                    continue;
-                }
-
-                if (checkedForAnimation[type]) {
-                    continue;
-                }
-                checkedForAnimation[type] = true;
+        bool redraw = false;
+        auto check = [&](int, int, int type) noexcept {
+            if (redraw || checkedForAnimation[type]) {
+                return;
+            }
+            checkedForAnimation[type] = true;
 
-                if (tileGraphics[type].needsRedraw(now)) {
-                    return true;
-                }
+            if (tileGraphics[type].needsRedraw(now)) {
+                redraw = true;
             }
+        };
+        grid.forEachTile(z, tiles.x1, tiles.y1, tiles.x2, tiles.y2, check);
+        if (redraw) {
+            return true;
         }
     }
     return false;
@@ -228,6 +264,10 @@ Area::tick(time_t dt) {
     }
 
     viewportTick(dt);
+
+    if (regions && regions->update(visibleTiles())) {
+        redraw = true;
+    }
 }
 
 void
@@ -341,12 +381,39 @@ void
 Area::runScript(TileGrid::ScriptType type,
                 icoord tile,
                 Entity* triggeredBy) noexcept {
-    DataArea::TileScript* script = grid.scripts[type].tryAt(tile);
+    DataArea::TileScript* script = grid.scriptAt(type, tile);
     if (script) {
         (dataArea->*(*script))(*triggeredBy, tile);
     }
 }
 
+bool
+Area::resolveScripts() noexcept {
+    dataArea = dataWorldArea(descriptor);
+    if (!dataArea) {
+        return true;
+    }
+
+    for (PendingScript& pending : pendingScripts) {
+        DataArea::TileScript script = dataArea->script(pending.name);
+        if (!script) {
+            continue;
+        }
+
+        icube& tiles = pending.tiles;
+        for (int y = tiles.y1; y < tiles.y2; y++) {
+            for (int x = tiles.x1; x < tiles.x2; x++) {
+                if (!grid.setScript({x, y, tiles.z1}, pending.type, script)) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    pendingScripts = Vector<PendingScript>();
+    return true;
+}
+
 
 void
 Area::drawTiles(DisplayList* display, icube& tiles, int z) {
@@ -372,34 +439,28 @@ Area::drawTiles(DisplayList* display, icube& tiles, int z) {
     int width = 16;
     int height = 16;
 
-    for (int y = tiles.y1; y < tiles.y2; y++) {
-        for (int x = tiles.x1; x < tiles.x2; x++) {
-            // We are certain the Tile exists.
-            int type = grid.getTileType(icoord{x, y, z});
-
-            if (type == 0) {
-                continue;
-            }
+    auto draw = [&](int x, int y, int type) noexcept {
+        if (tileGraphics[type].id == NO_ANIMATION) {
+            return;
+        }
 
-            if (tileGraphics[type].id == NO_ANIMATION) {
-                continue;
-            }
+        if (!tilesAnimated[type]) {
+            tilesAnimated[type] = true;
+            tileGraphics[type].setFrame(now);
+        }
 
-            if (!tilesAnimated[type]) {
-                tilesAnimated[type] = true;
-                tileGraphics[type].setFrame(now);
-            }
+        // Image guaranteed to exist because Animation won't hold a null
+        // ImageID.
+        Image img = tileGraphics[type].getFrame();
 
-            // Image guaranteed to exist because Animation won't hold a null
-            // ImageID.
-            Image img = tileGraphics[type].getFrame();
+        rvec2 drawPos{float(x * width), float(y * height)};
+        // drawPos.z = depth + drawPos.y / tileDimY *
+        // ISOMETRIC_ZOFF_PER_TILE;
+        items[itemCount++] = DisplayItem{img, drawPos};
+    };
 
-            rvec2 drawPos{float(x * width), float(y * height)};
-            // drawPos.z = depth + drawPos.y / tileDimY *
-            // ISOMETRIC_ZOFF_PER_TILE;
-            items[itemCount++] = DisplayItem{img, drawPos};
-        }
-    }
+    // Tiles off the edge of the grid are not drawn.
+    grid.forEachTile(z, tiles.x1, tiles.y1, tiles.x2, tiles.y2, draw);
 
     items.size = itemCount;
 }
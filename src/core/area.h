@@ -41,6 +41,7 @@
 #define ISOMETRIC_ZOFF_PER_TILE 0.001
 
 class AreaJSON;
+class AreaRegions;
 class Character;
 class DataArea;
 struct DisplayList;
@@ -61,10 +62,17 @@ class Player;
 */
 class Area {
  public:
+    virtual ~Area();
+
     //! Prepare game state for this Area to be in focus.
     void
     focus();
 
+    //! Approximate bytes of memory held by the Area, not counting the images
+    //! and sounds it shares with others through their caches.
+    size_t
+    memoryUsage();
+
     //! Processes keyboard input, calling the Player object when necessary.
     void
     buttonDown(Key key);
@@ -142,6 +150,12 @@ class Area {
     void
     drawEntities(DisplayList* display, icube& tiles, int z);
 
+    //! Look up the area's DataArea and set the scripts its objects name on
+    //! their tiles. Areas can be parsed on any thread, so this is left until
+    //! they are finished on the main thread.
+    bool
+    resolveScripts() noexcept;
+
  protected:
     Hashmap<String, TileSet> tileSets;
 
@@ -152,11 +166,24 @@ class Area {
     Vector<Character*> characters;
     Vector<Overlay*> overlays;
 
+    //! Loads the tiles around the viewport if the area is streamed, or null
+    //! if all of them were loaded with the area.
+    AreaRegions* regions = 0;
+
     bool beenFocused = false;
     bool redraw = true;
     uint32_t colorOverlayARGB = 0x00000000;
 
-    DataArea* dataArea;
+    DataArea* dataArea = 0;
+
+    //! A script named by an object, for resolveScripts. The tiles' x2 and y2
+    //! are exclusive, and z2 is unused.
+    struct PendingScript {
+        icube tiles;
+        TileGrid::ScriptType type;
+        String name;
+    };
+    Vector<PendingScript> pendingScripts;
 
     Player* player;
 
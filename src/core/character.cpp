@@ -135,7 +135,7 @@ Character::moveByTile(ivec2 delta) noexcept {
         destExit = area->grid.exitAt(from, delta);
     }
     if (!destExit && area->grid.inBounds(dest)) {
-        destExit = area->grid.exits[EXIT_NORMAL].tryAt(dest);
+        destExit = area->grid.exitAt(dest, ivec2{0, 0});
     }
 
     if (!canMove(dest)) {
@@ -210,7 +210,7 @@ Character::canMove(icoord dest) noexcept {
         if (nowalked(dest)) {
             return false;
         }
-        if (area->grid.occupied.contains(dest)) {
+        if (area->grid.occupiedAt(dest)) {
             // Space is occupied by another Entity.
             return false;
         }
@@ -225,8 +225,7 @@ Character::canMove(icoord dest) noexcept {
 bool
 Character::nowalked(icoord phys) noexcept {
     unsigned flags = nowalkFlags & ~nowalkExempt;
-    unsigned* tileFlags = area->grid.flags.tryAt(phys);
-    return tileFlags && (*tileFlags & flags) != 0;
+    return (area->grid.flagsAt(phys) & flags) != 0;
 }
 
 void
@@ -237,7 +236,7 @@ Character::arrived() noexcept {
     bool inBounds = area->grid.inBounds(dest);
 
     if (inBounds) {
-        float* layermod = area->grid.layermods[EXIT_NORMAL].tryAt(dest);
+        float* layermod = area->grid.layermodAt(dest, ivec2{0, 0});
         if (layermod) {
             r.z = *layermod;
         }
@@ -268,7 +267,7 @@ Character::leaveTile() noexcept {
 
 void
 Character::leaveTile(icoord phys) noexcept {
-    area->grid.occupied.erase(phys);
+    area->grid.setOccupied(phys, false);
 }
 
 void
@@ -280,7 +279,7 @@ Character::enterTile() noexcept {
 
 void
 Character::enterTile(icoord phys) noexcept {
-    area->grid.occupied[phys] = true;
+    area->grid.setOccupied(phys, true);
 }
 
 void
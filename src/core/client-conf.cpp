@@ -46,8 +46,12 @@ bool confFullscreen = false;
 int confMusicVolume = 100;
 int confSoundVolume = 100;
 time_t confCacheTTL = 300;
+int confCacheAreas = 64;
 int confPersistInit = 0;
 int confPersistCons = 0;
+String confLoadTrace;
+Vector<String> confPatches;
+int confRegionRadius = 1;
 
 // Parse and process the client config file, and set configuration defaults for
 // missing options.
@@ -81,8 +85,14 @@ confParse(StringView filename) noexcept {
 
     if (engineValue.isObject()) {
         JsonValue verbosityValue = engineValue["verbosity"];
+        JsonValue loadTraceValue = engineValue["loadtrace"];
+        JsonValue patchesValue = engineValue["patches"];
+        JsonValue regionRadiusValue = engineValue["regionradius"];
 
         CHECK(verbosityValue.isString() || verbosityValue.isNull());
+        CHECK(loadTraceValue.isString() || loadTraceValue.isNull());
+        CHECK(patchesValue.isArray() || patchesValue.isNull());
+        CHECK(regionRadiusValue.isNumber() || regionRadiusValue.isNull());
 
         if (verbosityValue.isString()) {
             StringView verbosity = verbosityValue.toString();
@@ -100,6 +110,27 @@ confParse(StringView filename) noexcept {
                        "Unknown value for \"engine.verbosity\", using default");
             }
         }
+
+        if (loadTraceValue.isString()) {
+            confLoadTrace = loadTraceValue.toString();
+        }
+
+        if (patchesValue.isArray()) {
+            for (JsonNode& node : patchesValue) {
+                CHECK(node.value.isString());
+                confPatches.push_back(String(node.value.toString()));
+            }
+        }
+
+        if (regionRadiusValue.isNumber()) {
+            confRegionRadius = regionRadiusValue.toInt();
+            if (confRegionRadius < 0) {
+                logErr(filename,
+                       "\"engine.regionradius\" must not be negative, using "
+                       "0");
+                confRegionRadius = 0;
+            }
+        }
     }
 
     if (windowValue.isObject()) {
@@ -139,12 +170,22 @@ confParse(StringView filename) noexcept {
 
     if (cacheValue.isObject()) {
         JsonValue ttlValue = cacheValue["ttl"];
+        JsonValue areasValue = cacheValue["areas"];
 
         CHECK(ttlValue.isNumber() || ttlValue.isNull());
+        CHECK(areasValue.isNumber() || areasValue.isNull());
 
         if (ttlValue.isNumber()) {
             confCacheTTL = ttlValue.toInt();
         }
+        if (areasValue.isNumber()) {
+            confCacheAreas = areasValue.toInt();
+            if (confCacheAreas < 0) {
+                logErr(filename,
+                       "\"cache.areas\" must not be negative, using 0");
+                confCacheAreas = 0;
+            }
+        }
     }
 
     return true;
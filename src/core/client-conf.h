@@ -32,6 +32,8 @@
 #include "core/vec.h"
 #include "util/int.h"
 #include "util/string-view.h"
+#include "util/string.h"
+#include "util/vector.h"
 
 //! Engine-wide user-confurable values.
 
@@ -45,8 +47,19 @@ extern bool confFullscreen;
 extern int confMusicVolume;
 extern int confSoundVolume;
 extern time_t confCacheTTL;
+//! Megabytes of memory that Areas the player is not in may keep. The least
+//! recently visited are dropped past it and loaded again if returned to.
+extern int confCacheAreas;
 extern int confPersistInit;
 extern int confPersistCons;
+//! If not empty, the path of every resource loaded is recorded to this file.
+extern String confLoadTrace;
+//! Patch archives mounted over the world's archive, in order. A file in a
+//! patch replaces the file at the same path in the world and earlier patches.
+extern Vector<String> confPatches;
+//! How many regions of a streamed area beyond those on screen are kept loaded
+//! in each direction.
+extern int confRegionRadius;
 
 bool
 confParse(StringView filename) noexcept;
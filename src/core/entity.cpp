@@ -78,9 +78,16 @@ parseScript(Entity* e, StringView name, StringView path) noexcept;
 // static static bool
 // setScript(Entity* e, StringView trigger, ScriptRef& script) noexcept;
 
+// Shared by every descriptor, so after the first few entities, parsing one
+// needs no calls to malloc. Entities are only created on the main thread.
+static JsonAllocator descriptorAllocator;
+
 static bool
 parseDescriptor(Entity* e) noexcept {
-    JsonDocument document = loadJson(e->descriptor);
+    // The last descriptor's document is gone, so its memory can be reused.
+    descriptorAllocator.reset();
+
+    JsonDocument document = loadJson(e->descriptor, descriptorAllocator);
     if (!document.ok) {
         return false;
     }
@@ -446,6 +453,23 @@ Entity::isDead() noexcept {
     return dead;
 }
 
+size_t
+Entity::memoryUsage() noexcept {
+    Animation* phases[] = {&phaseStance, &phaseDown, &phaseLeft,
+                           &phaseUp, &phaseRight, &phaseMovingUp,
+                           &phaseMovingRight, &phaseMovingDown,
+                           &phaseMovingLeft};
+
+    size_t usage = descriptor.capacity + phaseName.capacity +
+                   soundPathStep.capacity +
+                   onTickFns.capacity * sizeof(OnTickFn) +
+                   onTurnFns.capacity * sizeof(OnTurnFn);
+    for (Animation* animation : phases) {
+        usage += animation->memoryUsage();
+    }
+    return usage;
+}
+
 
 void
 Entity::tick(time_t dt) noexcept {
@@ -73,6 +73,11 @@ class Entity {
     bool
     isDead() noexcept;
 
+    // Approximate bytes of memory held by the Entity outside of itself, not
+    // counting the images and sounds it shares through their caches.
+    size_t
+    memoryUsage() noexcept;
+
     virtual void
     tick(time_t dt) noexcept;
     virtual void
@@ -31,15 +31,39 @@
 #include "util/string-view.h"
 #include "util/string.h"
 
-JsonDocument
-loadJson(StringView path) noexcept {
+static bool
+loadText(StringView path, String& text) noexcept {
     StringView data;
     if (!resourceLoad(path, data)) {
+        return false;
+    }
+
+    // Make a copy of the string, because it will be overwritten.
+    text = data;
+    resourceRelease(path);
+    return true;
+}
+
+JsonDocument
+loadJson(StringView path) noexcept {
+    String text;
+    if (!loadText(path, text)) {
         return JsonDocument();
     }
 
     TimeMeasure m(String() << "Constructed " << path << " as json");
 
-    // Make a copy of the string, because it will be overwritten.
-    return JsonDocument(data);
+    return JsonDocument(static_cast<String&&>(text));
+}
+
+JsonDocument
+loadJson(StringView path, JsonAllocator& allocator) noexcept {
+    String text;
+    if (!loadText(path, text)) {
+        return JsonDocument();
+    }
+
+    TimeMeasure m(String() << "Constructed " << path << " as json");
+
+    return JsonDocument(static_cast<String&&>(text), allocator);
 }
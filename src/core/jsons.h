@@ -33,4 +33,9 @@
 JsonDocument
 loadJson(StringView path) noexcept;
 
+// Build the document in allocator, which must not be reset while the document
+// is alive.
+JsonDocument
+loadJson(StringView path, JsonAllocator& allocator) noexcept;
+
 #endif  // SRC_CORE_JSONS_H_
@@ -28,14 +28,60 @@
 #ifndef SRC_CORE_RESOURCES_H_
 #define SRC_CORE_RESOURCES_H_
 
+#include "util/int.h"
 #include "util/noexcept.h"
 #include "util/string-view.h"
+#include "util/string.h"
+#include "util/vector.h"
 
 // Provides data and resource extraction for a World.
 // Each World comes bundled with associated data.
 
+// Open the world's archive and any patches mounted over it. Must be called
+// once, before any other resource function and before any thread that loads
+// resources is started. Afterward, every function here may be called from any
+// thread.
+bool
+resourceInit() noexcept;
+
+// Returns true if there is a resource at the given path.
+bool
+resourceExists(StringView path) noexcept;
+
 // Load a resource from the file at the given path.
 bool
 resourceLoad(StringView path, StringView& data) noexcept;
 
+// Tell the resource system that the data returned by a previous resourceLoad
+// is no longer being used. Each successful resourceLoad should be paired
+// with one resourceRelease.
+void
+resourceRelease(StringView path) noexcept;
+
+// A resource read piecewise instead of all at once, for resources too large to
+// hold in memory, like long music tracks.
+typedef struct ResourceStream ResourceStream;
+
+// Returns null if the resource is missing.
+ResourceStream*
+resourceStreamOpen(StringView path) noexcept;
+
+uint64_t
+resourceStreamSize(ResourceStream* stream) noexcept;
+
+// Copy size bytes starting at offset into buf. Returns false if the range
+// extends past the end of the resource.
+bool
+resourceStreamRead(ResourceStream* stream,
+                   uint64_t offset,
+                   size_t size,
+                   void* buf) noexcept;
+
+void
+resourceStreamClose(ResourceStream* stream) noexcept;
+
+// Hint that these resources will be loaded soon. Missing paths are ignored.
+void
+resourcePrefetch(Vector<String>& paths) noexcept;
+
 #endif  // SRC_CORE_RESOURCES_H_
@@ -29,6 +29,8 @@
 
 #include "core/log.h"
 #include "util/assert.h"
+#include "util/fnv.h"
+#include "util/hash.h"
 #include "util/math2.h"
 #include "util/string.h"
 
@@ -57,12 +59,26 @@ ivec2_to_dir(ivec2 v) noexcept {
 }
 
 TileGrid::TileGrid() noexcept
-    : dim({0, 0, 0}), tileDim({0, 0}), loopX(false), loopY(false) {}
+    : dim({0, 0, 0}),
+      tileDim({0, 0}),
+      loopX(false),
+      loopY(false),
+      chunksX(0),
+      chunksY(0) {}
 
 int
 TileGrid::getTileType(icoord phys) noexcept {
-    int idx = (phys.z * dim.y + phys.y) * dim.x + phys.x;
-    return graphics[idx];
+    if (tileIndex(phys) == -1) {
+        return 0;
+    }
+
+    TileChunk& chunk = chunkAt(phys);
+    if (chunk.tiles == TILE_CHUNK_UNIFORM) {
+        return chunk.uniformType;
+    }
+    return chunkTiles[chunk.tiles +
+                      (phys.y & TILE_CHUNK_MASK) * TILE_CHUNK_SIZE +
+                      (phys.x & TILE_CHUNK_MASK)];
 }
 
 int
@@ -73,9 +89,186 @@ TileGrid::getTileType(vicoord virt) noexcept {
 void
 TileGrid::setTileType(vicoord virt, int type) noexcept {
     icoord phys = virt2phys(virt);
+    assert_(tileIndex(phys) != -1);
+
+    TileChunk& chunk = chunkAt(phys);
+    if (chunk.tiles == TILE_CHUNK_UNIFORM) {
+        if (chunk.uniformType == type) {
+            return;
+        }
+
+        // Give the chunk its own tiles.
+        chunk.tiles = allocateChunkTiles();
+        int* tiles = chunkTiles.data + chunk.tiles;
+        for (int i = 0; i < TILE_CHUNK_AREA; i++) {
+            tiles[i] = chunk.uniformType;
+        }
+    }
+
+    chunkTiles[chunk.tiles + (phys.y & TILE_CHUNK_MASK) * TILE_CHUNK_SIZE +
+               (phys.x & TILE_CHUNK_MASK)] = type;
+}
+
+void
+TileGrid::addLayer(LayerType type) noexcept {
+    assert_(0 <= dim.x && 0 <= dim.y);
+
+    chunksX = (dim.x + TILE_CHUNK_MASK) >> TILE_CHUNK_SHIFT;
+    chunksY = (dim.y + TILE_CHUNK_MASK) >> TILE_CHUNK_SHIFT;
+
+    size_t layerChunks = static_cast<size_t>(chunksX) * chunksY;
+    chunks.reserve(chunks.size + layerChunks);
+    for (size_t i = 0; i < layerChunks; i++) {
+        chunks.push_back(TileChunk{TILE_CHUNK_UNIFORM, 0});
+    }
+
+    layerTypes.push_back(type);
+    dim.z++;
+}
+
+void
+TileGrid::setLayer(int z, const int* types) noexcept {
+    setTiles(z, 0, 0, dim.x, dim.y, types);
+}
+
+void
+TileGrid::setTiles(int z, int x, int y, int w, int h, const int* types)
+        noexcept {
+    assert_(0 <= z && z < dim.z);
+    assert_((x & TILE_CHUNK_MASK) == 0 && (y & TILE_CHUNK_MASK) == 0);
+    assert_(0 <= x && 0 <= w && x + w <= dim.x);
+    assert_(0 <= y && 0 <= h && y + h <= dim.y);
+    assert_((w & TILE_CHUNK_MASK) == 0 || x + w == dim.x);
+    assert_((h & TILE_CHUNK_MASK) == 0 || y + h == dim.y);
+
+    for (int top = 0; top < h; top += TILE_CHUNK_SIZE) {
+        int height = min(TILE_CHUNK_SIZE, h - top);
+
+        for (int left = 0; left < w; left += TILE_CHUNK_SIZE) {
+            int width = min(TILE_CHUNK_SIZE, w - left);
+
+            const int* src = types + static_cast<size_t>(top) * w + left;
+
+            // Is every tile in the chunk the same?
+            int first = src[0];
+            bool uniform = true;
+            for (int ty = 0; ty < height && uniform; ty++) {
+                const int* row = src + static_cast<size_t>(ty) * w;
+                for (int tx = 0; tx < width; tx++) {
+                    if (row[tx] != first) {
+                        uniform = false;
+                        break;
+                    }
+                }
+            }
+
+            TileChunk& chunk = chunkAt(icoord{x + left, y + top, z});
+
+            if (uniform) {
+                freeChunk(chunk);
+                chunk.uniformType = first;
+                continue;
+            }
+
+            if (chunk.tiles == TILE_CHUNK_UNIFORM) {
+                chunk.tiles = allocateChunkTiles();
+            }
+
+            int* dst = chunkTiles.data + chunk.tiles;
+            for (int ty = 0; ty < TILE_CHUNK_SIZE; ty++) {
+                int* row = dst + ty * TILE_CHUNK_SIZE;
+                for (int tx = 0; tx < TILE_CHUNK_SIZE; tx++) {
+                    row[tx] = ty < height && tx < width
+                                      ? src[static_cast<size_t>(ty) * w + tx]
+                                      : 0;
+                }
+            }
+        }
+    }
+}
+
+void
+TileGrid::clearTiles(int x, int y, int w, int h) noexcept {
+    assert_((x & TILE_CHUNK_MASK) == 0 && (y & TILE_CHUNK_MASK) == 0);
+    assert_(0 <= x && 0 <= w && x + w <= dim.x);
+    assert_(0 <= y && 0 <= h && y + h <= dim.y);
 
-    int idx = (phys.z * dim.y + phys.y) * dim.x + phys.x;
-    graphics[idx] = type;
+    for (int z = 0; z < dim.z; z++) {
+        for (int top = 0; top < h; top += TILE_CHUNK_SIZE) {
+            for (int left = 0; left < w; left += TILE_CHUNK_SIZE) {
+                TileChunk& chunk = chunkAt(icoord{x + left, y + top, z});
+                freeChunk(chunk);
+                chunk.uniformType = 0;
+            }
+        }
+    }
+}
+
+uint32_t
+TileGrid::allocateChunkTiles() noexcept {
+    if (freeChunkTiles.size) {
+        uint32_t offset = freeChunkTiles[freeChunkTiles.size - 1];
+        freeChunkTiles.pop_back();
+        return offset;
+    }
+
+    size_t offset = chunkTiles.size;
+
+    // Vector::resize only reserves what it needs, so grow the capacity
+    // geometrically here or filling a large layer takes quadratic time.
+    if (chunkTiles.capacity < offset + TILE_CHUNK_AREA) {
+        chunkTiles.reserve(max(chunkTiles.capacity * 2,
+                               offset + TILE_CHUNK_AREA));
+    }
+    chunkTiles.resize(offset + TILE_CHUNK_AREA);
+
+    return static_cast<uint32_t>(offset);
+}
+
+void
+TileGrid::freeChunk(TileChunk& chunk) noexcept {
+    if (chunk.tiles != TILE_CHUNK_UNIFORM) {
+        freeChunkTiles.push_back(chunk.tiles);
+        chunk.tiles = TILE_CHUNK_UNIFORM;
+    }
+}
+
+TileChunk&
+TileGrid::chunkAt(icoord phys) noexcept {
+    int cx = phys.x >> TILE_CHUNK_SHIFT;
+    int cy = phys.y >> TILE_CHUNK_SHIFT;
+    return chunks[(phys.z * chunksY + cy) * chunksX + cx];
+}
+
+size_t
+TileGrid::memoryUsage() noexcept {
+    size_t bytes = chunks.capacity * sizeof(TileChunk) +
+                   chunkTiles.capacity * sizeof(int) +
+                   freeChunkTiles.capacity * sizeof(uint32_t) +
+                   occupied.memoryUsage();
+
+    for (size_t i = 0; i < TILE_FLAG_BITS; i++) {
+        bytes += flags[i].memoryUsage();
+    }
+    for (size_t i = 0; i < EXITS_LENGTH; i++) {
+        bytes += exitIndexes[i].memoryUsage() +
+                 layermodIndexes[i].memoryUsage();
+    }
+    for (size_t i = 0; i < SCRIPT_TYPE_LAST; i++) {
+        bytes += scriptIndexes[i].memoryUsage();
+    }
+
+    bytes += exits.values.capacity * sizeof(Exit) +
+             exits.slots.capacity * sizeof(uint32_t) +
+             layermods.values.capacity * sizeof(float) +
+             layermods.slots.capacity * sizeof(uint32_t) +
+             scripts.values.capacity * sizeof(DataArea::TileScript) +
+             scripts.slots.capacity * sizeof(uint32_t);
+    for (Exit& exit : exits.values) {
+        bytes += exit.area.capacity;
+    }
+
+    return bytes;
 }
 
 bool
@@ -159,14 +352,237 @@ TileGrid::moveDest(icoord from, ivec2 facing) noexcept {
     return dest;
 }
 
+int
+TileGrid::tileIndex(icoord phys) noexcept {
+    if (phys.x < 0 || dim.x <= phys.x || phys.y < 0 || dim.y <= phys.y ||
+        phys.z < 0 || dim.z <= phys.z) {
+        return -1;
+    }
+    return (phys.z * dim.y + phys.y) * dim.x + phys.x;
+}
+
+size_t
+TileGrid::tileCount() noexcept {
+    return static_cast<size_t>(dim.x) * dim.y * dim.z;
+}
+
+static size_t
+attributeHash(const Exit& exit) noexcept {
+    return hash_(exit.area) * 31 ^
+           hash_(ivec2{exit.coords.x, exit.coords.y}) * 31 ^
+           hash_(exit.coords.z);
+}
+
+static bool
+attributeEqual(const Exit& a, const Exit& b) noexcept {
+    return a.coords.x == b.coords.x && a.coords.y == b.coords.y &&
+           a.coords.z == b.coords.z && StringView(a.area) == b.area;
+}
+
+static size_t
+attributeHash(float depth) noexcept {
+    return hash_(depth);
+}
+
+static bool
+attributeEqual(float a, float b) noexcept {
+    return a == b;
+}
+
+static size_t
+attributeHash(DataArea::TileScript script) noexcept {
+    // Pointers to member functions cannot be converted to integers.
+    return fnvHash(reinterpret_cast<const char*>(&script), sizeof(script));
+}
+
+static bool
+attributeEqual(DataArea::TileScript a, DataArea::TileScript b) noexcept {
+    return a == b;
+}
+
+// The value stored for a tile in indexes, or null if it has none.
+template<typename T>
+static T*
+attributeAt(TileAttributeIndexes& indexes,
+            TileAttributes<T>& attributes,
+            int tile) noexcept {
+    if (tile == -1) {
+        return 0;
+    }
+    uint32_t* index = indexes.tryAt(static_cast<uint32_t>(tile));
+    return index ? &attributes.values[*index - 1] : 0;
+}
+
+// Adds value to attributes unless it is already there, and returns its 1-based
+// index, or 0 if there are too many values to add another.
+template<typename T>
+static uint32_t
+internAttribute(TileAttributes<T>& attributes, const T& value) noexcept {
+    Vector<uint32_t>& slots = attributes.slots;
+    size_t mask = slots.size - 1;
+
+    if (slots.size) {
+        for (size_t i = attributeHash(value) & mask; slots[i];
+             i = (i + 1) & mask) {
+            if (attributeEqual(attributes.values[slots[i] - 1], value)) {
+                return slots[i];
+            }
+        }
+    }
+
+    if (attributes.values.size >= UINT32_MAX / 4) {
+        logErr("TileGrid", "Too many distinct tile attributes");
+        return 0;
+    }
+
+    attributes.values.push_back(value);
+    uint32_t index = static_cast<uint32_t>(attributes.values.size);
+
+    if (attributes.values.size * 2 > slots.size) {
+        // Grow and place every value again.
+        slots.clear();
+        slots.resize(slots.capacity ? slots.capacity * 2 : 16);
+        mask = slots.size - 1;
+        for (uint32_t j = 0; j < attributes.values.size; j++) {
+            size_t i = attributeHash(attributes.values[j]) & mask;
+            while (slots[i]) {
+                i = (i + 1) & mask;
+            }
+            slots[i] = j + 1;
+        }
+    }
+    else {
+        size_t i = attributeHash(value) & mask;
+        while (slots[i]) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = index;
+    }
+
+    return index;
+}
+
+unsigned
+TileGrid::flagsAt(icoord phys) noexcept {
+    int tile = tileIndex(phys);
+    if (tile == -1) {
+        return 0;
+    }
+
+    unsigned result = 0;
+    for (unsigned bit = 0; bit < TILE_FLAG_BITS; bit++) {
+        if (flags[bit].test(static_cast<size_t>(tile))) {
+            result |= 1u << bit;
+        }
+    }
+    return result;
+}
+
+void
+TileGrid::addFlags(icoord phys, unsigned newFlags) noexcept {
+    int tile = tileIndex(phys);
+    assert_(tile != -1);
+    assert_((newFlags >> TILE_FLAG_BITS) == 0);
+
+    for (unsigned bit = 0; bit < TILE_FLAG_BITS; bit++) {
+        if (newFlags & (1u << bit)) {
+            flags[bit].resize(tileCount());
+            flags[bit].set(static_cast<size_t>(tile));
+        }
+    }
+}
+
+bool
+TileGrid::occupiedAt(icoord phys) noexcept {
+    int tile = tileIndex(phys);
+    if (tile == -1) {
+        return occupiedOffGrid.contains(phys);
+    }
+    return occupied.test(static_cast<size_t>(tile));
+}
+
+void
+TileGrid::setOccupied(icoord phys, bool isOccupied) noexcept {
+    int tile = tileIndex(phys);
+    if (tile == -1) {
+        if (isOccupied) {
+            occupiedOffGrid[phys] = true;
+        }
+        else {
+            occupiedOffGrid.erase(phys);
+        }
+        return;
+    }
+
+    occupied.resize(tileCount());
+    if (isOccupied) {
+        occupied.set(static_cast<size_t>(tile));
+    }
+    else {
+        occupied.reset(static_cast<size_t>(tile));
+    }
+}
+
 Exit*
 TileGrid::exitAt(icoord from, ivec2 facing) noexcept {
-    int idx = ivec2_to_dir(facing);
-    return idx == -1 ? 0 : exits[idx].tryAt(from);
+    int dir = ivec2_to_dir(facing);
+    if (dir == -1) {
+        return 0;
+    }
+    return attributeAt(exitIndexes[dir], exits, tileIndex(from));
+}
+
+bool
+TileGrid::setExit(icoord phys, ExitDirection dir, const Exit& exit) noexcept {
+    int tile = tileIndex(phys);
+    assert_(tile != -1);
+
+    uint32_t index = internAttribute(exits, exit);
+    if (!index) {
+        return false;
+    }
+    exitIndexes[dir][static_cast<uint32_t>(tile)] = index;
+    return true;
 }
 
 float*
 TileGrid::layermodAt(icoord from, ivec2 facing) noexcept {
-    int idx = ivec2_to_dir(facing);
-    return idx == -1 ? 0 : layermods[idx].tryAt(from);
+    int dir = ivec2_to_dir(facing);
+    if (dir == -1) {
+        return 0;
+    }
+    return attributeAt(layermodIndexes[dir], layermods, tileIndex(from));
+}
+
+bool
+TileGrid::setLayermod(icoord phys, ExitDirection dir, float depth) noexcept {
+    int tile = tileIndex(phys);
+    assert_(tile != -1);
+
+    uint32_t index = internAttribute(layermods, depth);
+    if (!index) {
+        return false;
+    }
+    layermodIndexes[dir][static_cast<uint32_t>(tile)] = index;
+    return true;
+}
+
+DataArea::TileScript*
+TileGrid::scriptAt(ScriptType type, icoord phys) noexcept {
+    return attributeAt(scriptIndexes[type], scripts, tileIndex(phys));
+}
+
+bool
+TileGrid::setScript(icoord phys,
+                    ScriptType type,
+                    DataArea::TileScript script) noexcept {
+    int tile = tileIndex(phys);
+    assert_(tile != -1);
+
+    uint32_t index = internAttribute(scripts, script);
+    if (!index) {
+        return false;
+    }
+    scriptIndexes[type][static_cast<uint32_t>(tile)] = index;
+    return true;
 }
@@ -30,7 +30,9 @@
 
 #include "core/vec.h"
 #include "data/data-area.h"
+#include "util/bitset.h"
 #include "util/hashtable.h"
+#include "util/int.h"
 #include "util/string.h"
 #include "util/vector.h"
 
@@ -69,6 +71,9 @@ class Entity;
 // Entity's "exempt" flag which will be read elsewhere in the engine.
 #define TILE_NOWALK_AREA_BOUND ((unsigned)(0x016))
 
+// Number of the flags above, from the lowest bit, that tiles can carry.
+#define TILE_FLAG_BITS 3
+
 
 // Types of exits.
 enum ExitDirection {
@@ -95,6 +100,24 @@ struct Exit {
 
 typedef void (*TileScript)(Entity& triggeredBy, icoord tile);
 
+// Tile types are stored in square chunks of TILE_CHUNK_SIZE on a side, so a
+// large map whose layers are mostly empty or mostly one tile costs little.
+#define TILE_CHUNK_SHIFT 5
+#define TILE_CHUNK_SIZE (1 << TILE_CHUNK_SHIFT)
+#define TILE_CHUNK_MASK (TILE_CHUNK_SIZE - 1)
+#define TILE_CHUNK_AREA (TILE_CHUNK_SIZE * TILE_CHUNK_SIZE)
+
+// Marks a chunk whose tiles all have the same type.
+#define TILE_CHUNK_UNIFORM UINT32_MAX
+
+struct TileChunk {
+    // Offset of the chunk's TILE_CHUNK_AREA tile types in chunkTiles, row by
+    // row, or TILE_CHUNK_UNIFORM.
+    uint32_t tiles;
+    // The type of every tile in a uniform chunk. 0 is an empty chunk.
+    int uniformType;
+};
+
 struct EmptyFloat {
     static CONSTEXPR11 float
     value() {
@@ -109,6 +132,28 @@ struct EmptyIcoord {
     }
 };
 
+struct EmptyTileIndex {
+    static CONSTEXPR11 uint32_t
+    value() {
+        return UINT32_MAX;
+    }
+};
+
+// Maps the index of a tile to the 1-based index of one of its attributes in a
+// TileAttributes.
+typedef Hashmap<uint32_t, uint32_t, EmptyTileIndex> TileAttributeIndexes;
+
+// The distinct values of one kind of tile attribute, each stored once.
+template<typename T>
+struct TileAttributes {
+    Vector<T> values;
+
+    // 1-based indexes into values, placed by the hash of the value with
+    // linear probing, or 0 for none. Its size is a power of two, and it is
+    // kept at most half full.
+    Vector<uint32_t> slots;
+};
+
 class TileGrid {
  public:
     TileGrid() noexcept;
@@ -121,6 +166,47 @@ class TileGrid {
     void
     setTileType(vicoord virt, int type) noexcept;
 
+    enum LayerType {
+        TILE_LAYER,
+        OBJECT_LAYER,
+    };
+
+    // Add an empty layer above the others. dim.x and dim.y must be set.
+    void
+    addLayer(LayerType type) noexcept;
+
+    // Set every tile type on layer z from types, dim.x * dim.y of them row by
+    // row.
+    void
+    setLayer(int z, const int* types) noexcept;
+
+    // Set the tile types of a w by h rectangle of layer z, which starts on a
+    // chunk and ends on one or at the edge of the grid.
+    void
+    setTiles(int z, int x, int y, int w, int h, const int* types) noexcept;
+
+    // Give every tile of a rectangle on every layer type 0, freeing its
+    // chunks. The rectangle is aligned as for setTiles.
+    void
+    clearTiles(int x, int y, int w, int h) noexcept;
+
+    // Call f(x, y, type) for each tile on layer z in [x1, x2) by [y1, y2)
+    // that has a type other than 0, one chunk at a time. Empty chunks are
+    // skipped without looking at their tiles.
+    template<typename F>
+    void
+    forEachTile(int z, int x1, int y1, int x2, int y2, F f) noexcept;
+
+    // Call f(tile, exit) for each exit, once for each tile and direction it
+    // is set on.
+    template<typename F>
+    void
+    forEachExit(F f) noexcept;
+
+    // Approximate bytes allocated for the tiles and their attributes.
+    size_t
+    memoryUsage() noexcept;
+
     //! Returns true if a Tile exists at the specified coordinate.
     bool
     inBounds(icoord phys) noexcept;
@@ -164,21 +250,48 @@ class TileGrid {
     icoord
     moveDest(icoord from, ivec2 facing) noexcept;
 
-    // nullptr means not found
+    enum ScriptType {
+        SCRIPT_TYPE_ENTER,
+        SCRIPT_TYPE_LEAVE,
+        SCRIPT_TYPE_USE,
+        SCRIPT_TYPE_LAST,
+    };
+
+    // Attributes of single tiles. Tiles outside the grid have none, except
+    // that they can be occupied.
+
+    unsigned
+    flagsAt(icoord phys) noexcept;
+    void
+    addFlags(icoord phys, unsigned flags) noexcept;
+
+    // Whether an Entity is standing here.
+    bool
+    occupiedAt(icoord phys) noexcept;
+    void
+    setOccupied(icoord phys, bool occupied) noexcept;
+
+    // nullptr means not found. The setters return false if the grid already
+    // holds as many distinct values as it can.
     Exit*
     exitAt(icoord from, ivec2 facing) noexcept;
+    bool
+    setExit(icoord phys, ExitDirection dir, const Exit& exit) noexcept;
+
     // nullptr means not found
     float*
     layermodAt(icoord from, ivec2 facing) noexcept;
+    bool
+    setLayermod(icoord phys, ExitDirection dir, float depth) noexcept;
 
- public:
-    // 3-dimensional array of the tiles that make up the grid.
-    Vector<int> graphics;
+    // nullptr means not found
+    DataArea::TileScript*
+    scriptAt(ScriptType type, icoord phys) noexcept;
+    bool
+    setScript(icoord phys, ScriptType type, DataArea::TileScript script)
+            noexcept;
 
-    enum LayerType {
-        TILE_LAYER,
-        OBJECT_LAYER,
-    };
+ public:
     Vector<LayerType> layerTypes;
 
     // 3-dimensional length of map.
@@ -197,22 +310,61 @@ class TileGrid {
     bool loopX;
     bool loopY;
 
-    Hashmap<icoord, bool, EmptyIcoord> occupied;
+ private:
+    // Chunk holding a tile in the grid.
+    TileChunk&
+    chunkAt(icoord phys) noexcept;
 
-    enum ScriptType {
-        SCRIPT_TYPE_ENTER,
-        SCRIPT_TYPE_LEAVE,
-        SCRIPT_TYPE_USE,
-        SCRIPT_TYPE_LAST,
-    };
+    // Find room for one chunk's tiles in chunkTiles and return its offset.
+    uint32_t
+    allocateChunkTiles() noexcept;
+
+    // Make a chunk uniform, giving back its tiles if it had any.
+    void
+    freeChunk(TileChunk& chunk) noexcept;
 
-    Hashmap<icoord, DataArea::TileScript, EmptyIcoord>
-            scripts[SCRIPT_TYPE_LAST];
+    // Chunks of each layer, row by row, with partial chunks on the right and
+    // bottom edges. Tiles in them past the edge of the grid are never read.
+    Vector<TileChunk> chunks;
+    int chunksX;
+    int chunksY;
 
-    Hashmap<icoord, unsigned, EmptyIcoord> flags;
+    // Tile types of every chunk that is not uniform.
+    Vector<int> chunkTiles;
 
-    Hashmap<icoord, Exit, EmptyIcoord> exits[EXITS_LENGTH];
-    Hashmap<icoord, float, EmptyIcoord> layermods[EXITS_LENGTH];
+    // Offsets in chunkTiles no chunk is using.
+    Vector<uint32_t> freeChunkTiles;
+
+ private:
+    // Index of a tile in the arrays below, or -1 if it is
+    // outside the grid.
+    int
+    tileIndex(icoord phys) noexcept;
+
+    // Number of tiles in the grid, the size of the bitsets below once they
+    // are used. AreaJSON adds layers as it reads them, so the bitsets grow
+    // with dim.z, which keeps the indexes of tiles on earlier layers the same.
+    size_t
+    tileCount() noexcept;
+
+    // Flags are kept in bitsets indexed by tileIndex, each left empty until a
+    // tile needs it.
+    Bitset flags[TILE_FLAG_BITS];  // One bit per tile per flag.
+    Bitset occupied;
+
+    // Tiles outside the grid that are occupied anyway, as on looping maps.
+    Hashmap<icoord, bool, EmptyIcoord> occupiedOffGrid;
+
+    // Exits, layermods, and scripts are on few tiles, so only those tiles are
+    // in their index maps, one map per direction or script type.
+    TileAttributeIndexes exitIndexes[EXITS_LENGTH];
+    TileAttributes<Exit> exits;
+
+    TileAttributeIndexes layermodIndexes[EXITS_LENGTH];
+    TileAttributes<float> layermods;
+
+    TileAttributeIndexes scriptIndexes[SCRIPT_TYPE_LAST];
+    TileAttributes<DataArea::TileScript> scripts;
 
  private:
     TileGrid(const TileGrid&);
@@ -220,4 +372,71 @@ class TileGrid {
     operator=(const TileGrid&);
 };
 
+template<typename F>
+void
+TileGrid::forEachTile(int z, int x1, int y1, int x2, int y2, F f) noexcept {
+    x1 = x1 < 0 ? 0 : x1;
+    y1 = y1 < 0 ? 0 : y1;
+    x2 = x2 > dim.x ? dim.x : x2;
+    y2 = y2 > dim.y ? dim.y : y2;
+    if (x1 >= x2 || y1 >= y2 || z < 0 || dim.z <= z) {
+        return;
+    }
+
+    for (int cy = y1 >> TILE_CHUNK_SHIFT; cy <= (y2 - 1) >> TILE_CHUNK_SHIFT;
+         cy++) {
+        int top = cy << TILE_CHUNK_SHIFT;
+        int cy1 = y1 > top ? y1 : top;
+        int cy2 = y2 < top + TILE_CHUNK_SIZE ? y2 : top + TILE_CHUNK_SIZE;
+
+        for (int cx = x1 >> TILE_CHUNK_SHIFT;
+             cx <= (x2 - 1) >> TILE_CHUNK_SHIFT;
+             cx++) {
+            int left = cx << TILE_CHUNK_SHIFT;
+            int cx1 = x1 > left ? x1 : left;
+            int cx2 = x2 < left + TILE_CHUNK_SIZE ? x2 : left + TILE_CHUNK_SIZE;
+
+            TileChunk& chunk = chunks[(z * chunksY + cy) * chunksX + cx];
+
+            if (chunk.tiles == TILE_CHUNK_UNIFORM) {
+                int type = chunk.uniformType;
+                if (type == 0) {
+                    continue;
+                }
+                for (int y = cy1; y < cy2; y++) {
+                    for (int x = cx1; x < cx2; x++) {
+                        f(x, y, type);
+                    }
+                }
+                continue;
+            }
+
+            int* tiles = chunkTiles.data + chunk.tiles;
+            for (int y = cy1; y < cy2; y++) {
+                int* row = tiles + (y & TILE_CHUNK_MASK) * TILE_CHUNK_SIZE;
+                for (int x = cx1; x < cx2; x++) {
+                    int type = row[x & TILE_CHUNK_MASK];
+                    if (type != 0) {
+                        f(x, y, type);
+                    }
+                }
+            }
+        }
+    }
+}
+
+template<typename F>
+void
+TileGrid::forEachExit(F f) noexcept {
+    for (size_t dir = 0; dir < EXITS_LENGTH; dir++) {
+        for (auto& entry : exitIndexes[dir]) {
+            int tile = static_cast<int>(entry.key);
+            icoord phys = {tile % dim.x,
+                           tile / dim.x % dim.y,
+                           tile / dim.x / dim.y};
+            f(phys, exits.values[entry.value - 1]);
+        }
+    }
+}
+
 #endif  // SRC_CORE_TILE_GRID_H_
@@ -27,7 +27,9 @@
 
 #include "core/world.h"
 
+#include "core/area-binary.h"
 #include "core/area-json.h"
+#include "core/area-prefetch.h"
 #include "core/area.h"
 #include "core/character.h"
 #include "core/client-conf.h"
@@ -43,6 +45,7 @@
 #include "core/viewport.h"
 #include "core/window.h"
 #include "data/data-world.h"
+#include "pack/area-format.h"
 #include "util/hashtable.h"
 #include "util/vector.h"
 
@@ -50,6 +53,13 @@
 
 static Hashmap<String, Area*> areas;
 static Area* worldArea = 0;
+
+// The areas in areas, least recently focused first.
+static Vector<Area*> recentAreas;
+
+// Whether an area has been added or focused since the cache was last checked.
+static bool recentAreasChanged = false;
+
 static Player player;
 
 /**
@@ -70,6 +80,80 @@ static int paused = 0;
 static Keys keyStates[10];
 static size_t numKeyStates = 0;
 
+// Move area to the most recently used end of recentAreas, adding it if it is
+// new.
+static void
+touchArea(Area* area) noexcept {
+    for (size_t i = 0; i < recentAreas.size; i++) {
+        if (recentAreas[i] == area) {
+            recentAreas.erase(i);
+            break;
+        }
+    }
+    recentAreas.push_back(area);
+    recentAreasChanged = true;
+}
+
+// Add an area that has been loaded but not focused at the least recently used
+// end of recentAreas, so that areas prefetched but never entered are dropped
+// before those the player has been in.
+static void
+addUnfocusedArea(Area* area) noexcept {
+    recentAreas.insert(0, area);
+    recentAreasChanged = true;
+}
+
+// Drop the least recently focused areas until those the player is not in fit
+// in confCacheAreas. The area just left may still be on the stack while an
+// exit is taken, so this is only done between ticks.
+static void
+evictAreas() noexcept {
+    if (!recentAreasChanged) {
+        return;
+    }
+    recentAreasChanged = false;
+
+    size_t budget = static_cast<size_t>(confCacheAreas) * 1024 * 1024;
+
+    size_t used = 0;
+    for (Area* area : recentAreas) {
+        if (area != worldArea) {
+            used += area->memoryUsage();
+        }
+    }
+
+    size_t i = 0;
+    while (used > budget && i < recentAreas.size) {
+        Area* area = recentAreas[i];
+        if (area == worldArea) {
+            i++;
+            continue;
+        }
+
+        used -= area->memoryUsage();
+        recentAreas.erase(i);
+
+        for (auto it = areas.begin(); it != areas.end(); ++it) {
+            if (it->value == area) {
+                logInfo("World",
+                        String() << "Unloading " << it->key
+                                 << " to stay within the area cache");
+                areas.erase(it);
+                break;
+            }
+        }
+
+        // Areas can share a DataArea, so only run its hook if it belongs to
+        // this one and not to an area still loaded.
+        DataArea* dataArea = area->getDataArea();
+        if (dataArea->area == area) {
+            dataArea->onUnload();
+            dataArea->area = 0;
+        }
+        delete area;
+    }
+}
+
 bool
 worldInit() noexcept {
     alive = true;
@@ -164,6 +248,23 @@ worldTick(time_t dt) noexcept {
     total += dt;
 
     worldArea->tick(dt);
+
+    // Finish one prefetched area a tick so that several becoming ready at
+    // once do not stall the game.
+    String filename;
+    Area* prefetched = areaPrefetchTakeReady(filename);
+    if (prefetched) {
+        if (prefetched->ok && prefetched->getDataArea()) {
+            areas[filename] = prefetched;
+            addUnfocusedArea(prefetched);
+        }
+        else {
+            // Loaded again when entered, which reports the error.
+            delete prefetched;
+        }
+    }
+
+    evictAreas();
 }
 
 void
@@ -182,23 +283,39 @@ worldFocusArea(StringView filename, vicoord playerPos) noexcept {
         return true;
     }
 
-    Area* newArea = makeAreaFromJSON(&player, filename);
+    Area* newArea = areaPrefetchTake(filename);
+
     if (!newArea) {
-        return false;
+        // Let the OS read the area's descriptor in ahead of the parser.
+        // AreaJSON does the same for the tilesets and music it references.
+        // Only the compiled copy is read if there is one.
+        String compiled = String() << filename << AREA_BIN_EXTENSION;
+        Vector<String> prefetches;
+        if (resourceExists(compiled)) {
+            prefetches.push_back(compiled);
+        }
+        else {
+            prefetches.push_back(filename);
+        }
+        resourcePrefetch(prefetches);
+
+        // Areas compiled by pack-tool load without parsing JSON. Worlds
+        // packed without them, as during development, use the maps
+        // themselves.
+        newArea = makeAreaFromBinary(&player, filename);
+        if (!newArea) {
+            newArea = makeAreaFromJSON(&player, filename);
+        }
     }
-
-    if (!newArea->ok) {
+    if (!newArea) {
         return false;
     }
 
-    DataArea* dataArea = dataWorldArea(filename);
-    if (!dataArea) {
+    if (!newArea->ok || !newArea->getDataArea()) {
+        delete newArea;
         return false;
     }
 
-    dataArea->area = newArea;  // FIXME: Pass Area by parameter, not
-                               // member variable so we can avoid this
-                               // pointer.
     areas[filename] = newArea;
 
     worldFocusArea(newArea, playerPos);
@@ -209,9 +326,22 @@ worldFocusArea(StringView filename, vicoord playerPos) noexcept {
 void
 worldFocusArea(Area* area_, vicoord playerPos) noexcept {
     worldArea = area_;
+
+    // Areas may share a DataArea, so this is set on each focus rather than
+    // when the area is loaded.
+    worldArea->getDataArea()->area = worldArea;  // FIXME: Pass Area by
+                                                 // parameter, not member
+                                                 // variable so we can avoid
+                                                 // this pointer.
+
     player.setArea(worldArea, playerPos);
     viewportSetArea(worldArea);
     worldArea->focus();
+
+    touchArea(worldArea);
+
+    // Get the areas this one leads to ready before the player takes an exit.
+    areaPrefetchExits(worldArea, &player, areas);
 }
 
 void
@@ -43,6 +43,9 @@ DataArea::onTick(time_t) noexcept {}
 void
 DataArea::onTurn() noexcept {}
 
+void
+DataArea::onUnload() noexcept {}
+
 void
 DataArea::tick(time_t dt) noexcept {
     // Only iterate over inProgresses that existed at the time of the
@@ -61,6 +64,12 @@ DataArea::turn() noexcept {
     onTurn();
 }
 
+DataArea::TileScript
+DataArea::script(StringView name) noexcept {
+    TileScript* found = scripts.tryAt(name);
+    return found ? *found : 0;
+}
+
 void
 DataArea::playSoundEffect(StringView sound) noexcept {
     SoundID sid = soundLoad(sound);
@@ -56,6 +56,13 @@ class DataArea {
     onTick(time_t dt) noexcept;
     virtual void
     onTurn() noexcept;
+    //! Called before the Area is dropped from the area cache to save memory.
+    //! Its Characters and Overlays are deleted with it, so pointers to them
+    //! must be forgotten. Script state to keep should be saved here and
+    //! restored in onLoad, which is called again when the Area is rebuilt.
+    //! Only called while this DataArea's area is the Area being dropped.
+    virtual void
+    onUnload() noexcept;
 
     // For scripts
 
@@ -72,6 +79,10 @@ class DataArea {
     void
     turn() noexcept;
 
+    // The script registered under name, or null.
+    TileScript
+    script(StringView name) noexcept;
+
     Hashmap<StringView, TileScript> scripts;
 
  private:
@@ -38,6 +38,7 @@
 #include "os/chrono.h"
 #include "os/thread.h"
 #include "util/int.h"
+#include "util/jobs.h"
 
 #ifdef _WIN32
 #include "os/windows.h"
@@ -85,6 +86,11 @@ main() noexcept {
         return 1;
     }
 
+    if (!resourceInit()) {
+        logFatal("Main", "Resource initialization");
+        return 1;
+    }
+
     {
         TimeMeasure m("Constructed world");
         if (!worldInit()) {
@@ -97,6 +103,9 @@ main() noexcept {
 
     windowMainLoop();
 
+    // Streamed areas leave the job pool's workers waiting for more regions.
+    JobsFlush();
+
     return 0;
 }
 
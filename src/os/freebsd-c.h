@@ -97,6 +97,7 @@ open(const char*, int, ...) noexcept;
 #define O_WRONLY 0x0001
 #define O_CREAT 0x0200
 #define O_TRUNC 0x0400
+#define O_APPEND 0x0008
 }
 
 // sys/mman.h
@@ -105,8 +106,12 @@ void*
 mmap(void*, size_t, int, int, int, off_t) noexcept;
 int
 munmap(void*, size_t) noexcept;
+int
+madvise(void*, size_t, int) noexcept;
 #define MAP_FAILED ((void*)-1)
 #define MAP_SHARED 0x0001
+#define MADV_SEQUENTIAL 2
+#define MADV_WILLNEED 3
 #define PROT_READ 0x01
 }
 
@@ -288,6 +293,10 @@ nanosleep(const struct timespec*, struct timespec*) noexcept;
 extern "C" {
 int
 close(int) noexcept;
+int
+ftruncate(int, off_t) noexcept;
+int
+getpagesize() noexcept;
 void
 _exit(int) noexcept __attribute__((noreturn));
 int
@@ -295,6 +304,12 @@ isatty(int) noexcept;
 long
 sysconf(int) noexcept;
 ssize_t
+pread(int, void*, size_t, off_t) noexcept;
+ssize_t
+pwrite(int, const void*, size_t, off_t) noexcept;
+int
+unlink(const char*) noexcept;
+ssize_t
 write(int, const void*, size_t) noexcept;
 #define _SC_NPROCESSORS_ONLN 58
 }
@@ -113,14 +113,19 @@ open(const char*, int, ...) noexcept;
 #define O_WRONLY 01
 #define O_CREAT 0100
 #define O_TRUNC 01000
+#define O_APPEND 02000
 
 // sys/mman.h
 void*
 mmap(void*, size_t, int, int, int, off_t) noexcept;
 int
 munmap(void*, size_t) noexcept;
+int
+madvise(void*, size_t, int) noexcept;
 #define MAP_FAILED ((void*)-1)
 #define MAP_SHARED 0x01
+#define MADV_SEQUENTIAL 2
+#define MADV_WILLNEED 3
 #define PROT_READ 1
 
 #if defined(__EMSCRIPTEN__)
@@ -325,6 +330,12 @@ nanosleep(const struct timespec*, struct timespec*) noexcept;
 // unistd.h
 int
 close(int) noexcept;
+ssize_t
+copy_file_range(int, off_t*, int, off_t*, size_t, unsigned) noexcept;
+int
+ftruncate(int, off_t) noexcept;
+int
+getpagesize() noexcept;
 void
 _exit(int) noexcept __attribute__((noreturn));
 int
@@ -332,6 +343,12 @@ isatty(int) noexcept;
 long
 sysconf(int) noexcept;
 ssize_t
+pread(int, void*, size_t, off_t) noexcept;
+ssize_t
+pwrite(int, const void*, size_t, off_t) noexcept;
+int
+unlink(const char*) noexcept;
+ssize_t
 write(int, const void*, size_t) noexcept;
 #define _SC_NPROCESSORS_ONLN 84
 
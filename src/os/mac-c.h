@@ -95,14 +95,19 @@ open(const char*, int, ...) noexcept;
 #define O_WRONLY 0x0001
 #define O_CREAT 0x0200
 #define O_TRUNC 0x0400
+#define O_APPEND 0x0008
 
 // sys/mman.h
 void*
 mmap(void*, size_t, int, int, int, off_t) noexcept;
 int
 munmap(void*, size_t) noexcept;
+int
+madvise(void*, size_t, int) noexcept;
 #define MAP_FAILED ((void*)-1)
 #define MAP_SHARED 0x0001
+#define MADV_SEQUENTIAL 2
+#define MADV_WILLNEED 3
 #define PROT_READ 0x01
 
 // sys/stat.h
@@ -277,8 +282,18 @@ _exit(int) noexcept __attribute__((noreturn));
 int
 close(int) noexcept;
 int
+ftruncate(int, off_t) noexcept;
+int
+getpagesize() noexcept;
+int
 isatty(int) noexcept;
 ssize_t
+pread(int, void*, size_t, off_t) noexcept;
+ssize_t
+pwrite(int, const void*, size_t, off_t) noexcept;
+int
+unlink(const char*) noexcept;
+ssize_t
 write(int, const void*, size_t) noexcept;
 
 }
@@ -48,6 +48,11 @@ writeFileVec(StringView path,
              uint32_t count,
              uint32_t* lengths,
              void** datas) noexcept;
+// Creates the file if it does not exist.
+bool
+appendFile(StringView path, uint32_t length, void* data) noexcept;
+bool
+removeFile(StringView path) noexcept;
 bool
 isDir(StringView path) noexcept;
 void
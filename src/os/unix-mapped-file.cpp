@@ -70,3 +70,24 @@ destroyMappedFile(MappedFile file) noexcept {
         close(file.fd);
     }
 }
+
+void
+mappedFileAdvise(MappedFile file,
+                 size_t offset,
+                 size_t size,
+                 MappedFileAdvice advice) noexcept {
+    if (offset >= file.size) {
+        return;
+    }
+    if (size > file.size - offset) {
+        size = file.size - offset;
+    }
+
+    size_t pageSize = static_cast<size_t>(getpagesize());
+
+    size_t begin = offset & ~(pageSize - 1);
+    size_t end = offset + size;
+
+    int madv = advice == MFA_WILLNEED ? MADV_WILLNEED : MADV_SEQUENTIAL;
+    (void)madvise(file.data + begin, end - begin, madv);
+}
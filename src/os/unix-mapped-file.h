@@ -41,4 +41,18 @@ makeMappedFile(StringView& path, MappedFile& file) noexcept;
 void
 destroyMappedFile(MappedFile file) noexcept;
 
+enum MappedFileAdvice {
+    // The range will be read soon. Start reading it in now.
+    MFA_WILLNEED,
+    // The range will be read from start to end.
+    MFA_SEQUENTIAL,
+};
+
+// A hint to the OS. The range is widened to page boundaries.
+void
+mappedFileAdvise(MappedFile file,
+                 size_t offset,
+                 size_t size,
+                 MappedFileAdvice advice) noexcept;
+
 #endif  // SRC_OS_UNIX_MAPPED_FILE_H_
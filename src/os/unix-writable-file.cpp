@@ -0,0 +1,141 @@
+/********************************
+** Tsunagari Tile Engine       **
+** unix-writable-file.cpp      **
+** Copyright 2020 Paul Merrill **
+********************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+#include "os/unix-writable-file.h"
+
+#include "os/c.h"
+#include "util/new.h"
+#include "util/noexcept.h"
+#include "util/string-view.h"
+#include "util/string.h"
+
+// Size of the buffer used when the kernel can't copy for us.
+static constexpr size_t COPY_BUFFER_SIZE = 1 << 20;
+
+bool
+makeWritableFile(StringView path, uint64_t size, WritableFile& file) noexcept {
+    int fd = open(String(path).null(), O_CREAT | O_WRONLY | O_TRUNC, 0666);
+    if (fd == -1) {
+        return false;
+    }
+
+    if (ftruncate(fd, static_cast<off_t>(size))) {
+        close(fd);
+        return false;
+    }
+
+    file.fd = fd;
+    return true;
+}
+
+void
+destroyWritableFile(WritableFile file) noexcept {
+    close(file.fd);
+}
+
+bool
+writableFileWrite(WritableFile file,
+                  uint64_t offset,
+                  const void* data,
+                  size_t size) noexcept {
+    const char* bytes = static_cast<const char*>(data);
+    while (size) {
+        ssize_t written =
+                pwrite(file.fd, bytes, size, static_cast<off_t>(offset));
+        if (written == -1 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        bytes += written;
+        offset += static_cast<uint64_t>(written);
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+bool
+writableFileCopy(WritableFile file,
+                 uint64_t offset,
+                 StringView sourcePath,
+                 uint64_t size) noexcept {
+    int source = open(String(sourcePath).null(), O_RDONLY);
+    if (source == -1) {
+        return false;
+    }
+
+    uint64_t sourceOffset = 0;
+
+#ifdef __linux__
+    off_t in = 0;
+    off_t out = static_cast<off_t>(offset);
+    while (size) {
+        ssize_t copied = copy_file_range(source, &in, file.fd, &out,
+                                         static_cast<size_t>(size), 0);
+        if (copied <= 0) {
+            // Unsupported by this kernel or file system, or the file shrank.
+            // Finish in user space.
+            break;
+        }
+        size -= static_cast<uint64_t>(copied);
+    }
+    sourceOffset = static_cast<uint64_t>(in);
+    offset = static_cast<uint64_t>(out);
+    if (size == 0) {
+        close(source);
+        return true;
+    }
+#endif
+
+    char* buffer = static_cast<char*>(malloc(COPY_BUFFER_SIZE));
+    bool ok = true;
+
+    while (size) {
+        size_t chunk = size < COPY_BUFFER_SIZE ? static_cast<size_t>(size)
+                                               : COPY_BUFFER_SIZE;
+        ssize_t got = pread(source, buffer, chunk,
+                            static_cast<off_t>(sourceOffset));
+        if (got == -1 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            ok = false;
+            break;
+        }
+        if (!writableFileWrite(file, offset, buffer,
+                               static_cast<size_t>(got))) {
+            ok = false;
+            break;
+        }
+        sourceOffset += static_cast<uint64_t>(got);
+        offset += static_cast<uint64_t>(got);
+        size -= static_cast<uint64_t>(got);
+    }
+
+    free(buffer);
+    close(source);
+    return ok;
+}
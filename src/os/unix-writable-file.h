@@ -0,0 +1,60 @@
+/********************************
+** Tsunagari Tile Engine       **
+** unix-writable-file.h        **
+** Copyright 2020 Paul Merrill **
+********************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+#ifndef SRC_OS_UNIX_WRITABLE_FILE_H_
+#define SRC_OS_UNIX_WRITABLE_FILE_H_
+
+#include "util/int.h"
+#include "util/noexcept.h"
+#include "util/string-view.h"
+
+// A file written at arbitrary offsets. Separate ranges may be written from
+// several threads at once.
+struct WritableFile {
+    int fd;
+};
+
+// Creates or truncates the file, then extends it to size bytes.
+bool
+makeWritableFile(StringView path, uint64_t size, WritableFile& file) noexcept;
+void
+destroyWritableFile(WritableFile file) noexcept;
+
+bool
+writableFileWrite(WritableFile file,
+                  uint64_t offset,
+                  const void* data,
+                  size_t size) noexcept;
+
+// Copy the first size bytes of the file at sourcePath to offset. On Linux the
+// copy happens in the kernel and the data never enters this process.
+// Elsewhere it goes through a small fixed-size buffer.
+bool
+writableFileCopy(WritableFile file,
+                 uint64_t offset,
+                 StringView sourcePath,
+                 uint64_t size) noexcept;
+
+#endif  // SRC_OS_UNIX_WRITABLE_FILE_H_
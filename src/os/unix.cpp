@@ -127,6 +127,26 @@ writeFile(StringView path, uint32_t length, void* data) noexcept {
     return writeFile(path_, length, data);
 }
 
+bool
+appendFile(StringView path, uint32_t length, void* data) noexcept {
+    int fd = open(String(path).null(), O_CREAT | O_WRONLY | O_APPEND, 0666);
+    if (fd == -1) {
+        return false;
+    }
+    ssize_t written = write(fd, data, length);
+    if (written != length) {
+        close(fd);
+        return false;
+    }
+    close(fd);
+    return true;
+}
+
+bool
+removeFile(StringView path) noexcept {
+    return unlink(String(path).null()) == 0;
+}
+
 bool
 writeFileVec(String& path,
              uint32_t count,
@@ -137,19 +157,39 @@ writeFileVec(String& path,
         return false;
     }
 
-    ssize_t total = 0;
+    // writev accepts at most IOV_MAX vectors, which is 1024 on every platform
+    // we support, and may write less than asked.
+    static constexpr size_t MAX_VECS = 1024;
+
     Vector<iovec> ios;
 
     ios.reserve(count);
     for (size_t i = 0; i < count; i++) {
-        total += lengths[i];
-        ios.push_back({datas[i], lengths[i]});
+        if (lengths[i]) {
+            ios.push_back({datas[i], lengths[i]});
+        }
     }
 
-    ssize_t written = writev(fd, ios.data, static_cast<int>(ios.size));
-    if (written != total) {
-        close(fd);
-        return false;
+    iovec* io = ios.data;
+    size_t remaining = ios.size;
+    while (remaining) {
+        size_t batch = remaining < MAX_VECS ? remaining : MAX_VECS;
+        ssize_t written = writev(fd, io, static_cast<int>(batch));
+        if (written <= 0) {
+            close(fd);
+            return false;
+        }
+
+        size_t left = static_cast<size_t>(written);
+        while (remaining && left >= io->iov_len) {
+            left -= io->iov_len;
+            io++;
+            remaining--;
+        }
+        if (left) {
+            io->iov_base = static_cast<char*>(io->iov_base) + left;
+            io->iov_len -= left;
+        }
     }
 
     close(fd);
@@ -55,6 +55,8 @@ CreateFileMappingA(HANDLE hFile,
                    DWORD dwMaximumSizeHigh,
                    DWORD dwMaximumSizeLow,
                    LPCSTR lpName) noexcept;
+WINBASEAPI BOOL WINAPI
+GetFileSizeEx(HANDLE hFile, LARGE_INTEGER* lpFileSize) noexcept;
 WINBASEAPI LPVOID WINAPI
 MapViewOfFile(HANDLE hFileMappingObject,
               DWORD dwDesiredAccess,
@@ -64,6 +66,19 @@ MapViewOfFile(HANDLE hFileMappingObject,
 WINBASEAPI BOOL WINAPI
 UnmapViewOfFile(LPCVOID lpBaseAddress) noexcept;
 
+typedef struct {
+    PVOID VirtualAddress;
+    SIZE_T NumberOfBytes;
+} WIN32_MEMORY_RANGE_ENTRY, *PWIN32_MEMORY_RANGE_ENTRY;
+
+WINBASEAPI HANDLE WINAPI
+GetCurrentProcess() noexcept;
+WINBASEAPI BOOL WINAPI
+PrefetchVirtualMemory(HANDLE hProcess,
+                      ULONG_PTR NumberOfEntries,
+                      PWIN32_MEMORY_RANGE_ENTRY VirtualAddresses,
+                      ULONG Flags) noexcept;
+
 #define CreateFile CreateFileA
 #define CreateFileMapping CreateFileMappingA
 
@@ -89,6 +104,12 @@ makeMappedFile(StringView path, MappedFile& map) noexcept {
         return false;
     }
 
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        return false;
+    }
+
     HANDLE mapping =
             CreateFileMapping(file, 0, PAGE_READONLY, 0, 0, 0);
     if (mapping == 0) {
@@ -104,6 +125,7 @@ makeMappedFile(StringView path, MappedFile& map) noexcept {
     }
 
     map.data = static_cast<char*>(data);
+    map.size = static_cast<size_t>(size.QuadPart);
     map.mapping = mapping;
     map.file = file;
     return true;
@@ -121,3 +143,16 @@ destroyMappedFile(MappedFile map) noexcept {
         CloseHandle(map.file);
     }
 }
+
+void
+mappedFileAdvise(MappedFile map,
+                 size_t offset,
+                 size_t size,
+                 MappedFileAdvice advice) noexcept {
+    // Windows has no equivalent to MADV_SEQUENTIAL for mapped views, but
+    // prefetching the range up front has the same effect.
+    (void)advice;
+
+    WIN32_MEMORY_RANGE_ENTRY range = {map.data + offset, size};
+    (void)PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
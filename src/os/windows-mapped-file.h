@@ -28,11 +28,13 @@
 #define SRC_OS_WINDOWS_MAPPED_FILE_H_
 
 #include "os/c.h"
+#include "util/int.h"
 #include "util/noexcept.h"
 #include "util/string-view.h"
 
 struct MappedFile {
     char* data;
+    size_t size;
     HANDLE mapping;
     HANDLE file;
 };
@@ -42,4 +44,18 @@ makeMappedFile(StringView path, MappedFile& file) noexcept;
 void
 destroyMappedFile(MappedFile file) noexcept;
 
+enum MappedFileAdvice {
+    // The range will be read soon. Start reading it in now.
+    MFA_WILLNEED,
+    // The range will be read from start to end.
+    MFA_SEQUENTIAL,
+};
+
+// A hint to the OS.
+void
+mappedFileAdvise(MappedFile file,
+                 size_t offset,
+                 size_t size,
+                 MappedFileAdvice advice) noexcept;
+
 #endif  // SRC_OS_WINDOWS_MAPPED_FILE_H_
@@ -0,0 +1,186 @@
+/********************************
+** Tsunagari Tile Engine       **
+** windows-writable-file.cpp   **
+** Copyright 2020 Paul Merrill **
+********************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+#include "os/windows-writable-file.h"
+
+#include "os/c.h"
+#include "util/new.h"
+#include "util/noexcept.h"
+#include "util/string-view.h"
+#include "util/string.h"
+
+extern "C" {
+typedef struct {
+    ULONG_PTR Internal;
+    ULONG_PTR InternalHigh;
+    DWORD Offset;
+    DWORD OffsetHigh;
+    HANDLE hEvent;
+} OVERLAPPED, *LPOVERLAPPED;
+
+WINBASEAPI BOOL WINAPI
+CloseHandle(HANDLE hObject) noexcept;
+WINBASEAPI HANDLE WINAPI
+CreateFileA(LPCSTR lpFileName,
+            DWORD dwDesiredAccess,
+            DWORD dwShareMode,
+            void* lpSecurityAttributes,
+            DWORD dwCreationDisposition,
+            DWORD dwFlagsAndAttributes,
+            HANDLE hTemplateFile) noexcept;
+WINBASEAPI BOOL WINAPI
+ReadFile(HANDLE hFile,
+         LPVOID lpBuffer,
+         DWORD nNumberOfBytesToRead,
+         LPDWORD lpNumberOfBytesRead,
+         LPOVERLAPPED lpOverlapped) noexcept;
+WINBASEAPI BOOL WINAPI
+SetEndOfFile(HANDLE hFile) noexcept;
+WINBASEAPI BOOL WINAPI
+SetFilePointerEx(HANDLE hFile,
+                 LARGE_INTEGER liDistanceToMove,
+                 LARGE_INTEGER* lpNewFilePointer,
+                 DWORD dwMoveMethod) noexcept;
+WINBASEAPI BOOL WINAPI
+WriteFile(HANDLE hFile,
+          LPCVOID lpBuffer,
+          DWORD nNumberOfBytesToWrite,
+          LPDWORD lpNumberOfBytesWritten,
+          LPOVERLAPPED lpOverlapped) noexcept;
+
+#define CreateFile CreateFileA
+
+#define CREATE_ALWAYS 2
+#define FILE_ATTRIBUTE_NORMAL 0x00000080
+#define FILE_BEGIN 0
+#define FILE_SHARE_READ 0x00000001
+#define GENERIC_READ 0x80000000L
+#define GENERIC_WRITE 0x40000000L
+#define INVALID_HANDLE_VALUE ((HANDLE)(LONG_PTR)-1)
+#define OPEN_EXISTING 3
+}
+
+// Size of the buffer used to copy files, and the most written at once.
+static constexpr size_t COPY_BUFFER_SIZE = 1 << 20;
+
+static OVERLAPPED
+at(uint64_t offset) noexcept {
+    OVERLAPPED overlapped = {};
+    overlapped.Offset = static_cast<DWORD>(offset);
+    overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+    return overlapped;
+}
+
+bool
+makeWritableFile(StringView path, uint64_t size, WritableFile& file) noexcept {
+    HANDLE handle = CreateFile(String(path).null(),
+                               GENERIC_WRITE,
+                               0,
+                               0,
+                               CREATE_ALWAYS,
+                               FILE_ATTRIBUTE_NORMAL,
+                               0);
+    if (handle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER end;
+    end.QuadPart = static_cast<long long>(size);
+    if (!SetFilePointerEx(handle, end, 0, FILE_BEGIN) ||
+        !SetEndOfFile(handle)) {
+        CloseHandle(handle);
+        return false;
+    }
+
+    file.file = handle;
+    return true;
+}
+
+void
+destroyWritableFile(WritableFile file) noexcept {
+    CloseHandle(file.file);
+}
+
+bool
+writableFileWrite(WritableFile file,
+                  uint64_t offset,
+                  const void* data,
+                  size_t size) noexcept {
+    const char* bytes = static_cast<const char*>(data);
+    while (size) {
+        DWORD chunk = static_cast<DWORD>(
+                size < COPY_BUFFER_SIZE ? size : COPY_BUFFER_SIZE);
+        OVERLAPPED overlapped = at(offset);
+        DWORD written;
+        if (!WriteFile(file.file, bytes, chunk, &written, &overlapped) ||
+            written == 0) {
+            return false;
+        }
+        bytes += written;
+        offset += written;
+        size -= written;
+    }
+    return true;
+}
+
+bool
+writableFileCopy(WritableFile file,
+                 uint64_t offset,
+                 StringView sourcePath,
+                 uint64_t size) noexcept {
+    HANDLE source = CreateFile(String(sourcePath).null(),
+                               GENERIC_READ,
+                               FILE_SHARE_READ,
+                               0,
+                               OPEN_EXISTING,
+                               FILE_ATTRIBUTE_NORMAL,
+                               0);
+    if (source == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    char* buffer = static_cast<char*>(malloc(COPY_BUFFER_SIZE));
+    bool ok = true;
+
+    while (size) {
+        DWORD chunk = static_cast<DWORD>(
+                size < COPY_BUFFER_SIZE ? size : COPY_BUFFER_SIZE);
+        DWORD got;
+        if (!ReadFile(source, buffer, chunk, &got, 0) || got == 0) {
+            ok = false;
+            break;
+        }
+        if (!writableFileWrite(file, offset, buffer, got)) {
+            ok = false;
+            break;
+        }
+        offset += got;
+        size -= got;
+    }
+
+    free(buffer);
+    CloseHandle(source);
+    return ok;
+}
@@ -70,6 +70,7 @@ WINBASEAPI BOOL WINAPI
 CreateDirectoryA(LPCSTR, void*) noexcept;
 WINBASEAPI HANDLE WINAPI
 CreateFileA(LPCSTR, DWORD, DWORD, void*, DWORD, DWORD, HANDLE) noexcept;
+WINBASEAPI BOOL WINAPI DeleteFileA(LPCSTR) noexcept;
 WINBASEAPI VOID WINAPI ExitProcess(UINT) noexcept;
 WINBASEAPI HANDLE WINAPI FindFirstFileA(LPCSTR, LPWIN32_FIND_DATAA) noexcept;
 WINBASEAPI BOOL WINAPI FindNextFileA(HANDLE, LPWIN32_FIND_DATAA) noexcept;
@@ -91,6 +92,8 @@ typedef WIN32_FIND_DATAA WIN32_FIND_DATA;
 #define CREATE_ALWAYS 2
 #define CreateDirectory CreateDirectoryA
 #define CreateFile CreateFileA
+#define DeleteFile DeleteFileA
+#define FILE_APPEND_DATA 0x0004
 #define FILE_ATTRIBUTE_DIRECTORY 0x00000010
 #define FILE_READ_ATTRIBUTES 0x0080
 #define FILE_READ_DATA 0x0001
@@ -105,6 +108,7 @@ typedef WIN32_FIND_DATAA WIN32_FIND_DATA;
 #define INVALID_FILE_ATTRIBUTES ((DWORD)-1)
 #define INVALID_HANDLE_VALUE ((HANDLE)(LONG_PTR)-1)
 #define MessageBox MessageBoxA
+#define OPEN_ALWAYS 4
 #define OPEN_EXISTING 3
 #define STD_OUTPUT_HANDLE ((DWORD)-11)
 
@@ -169,6 +173,40 @@ writeFile(StringView path, uint32_t length, void* data) noexcept {
     return true;
 }
 
+bool
+appendFile(StringView path, uint32_t length, void* data) noexcept {
+    HANDLE file = CreateFile(String(path).null(),
+                             FILE_APPEND_DATA,
+                             0,
+                             0,
+                             OPEN_ALWAYS,
+                             0,
+                             0);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    DWORD written;
+    BOOL ok = WriteFile(file, data, length, &written, 0);
+    if (!ok) {
+        CloseHandle(file);
+        return false;
+    }
+    if (length != written) {
+        CloseHandle(file);
+        return false;
+    }
+
+    CloseHandle(file);
+
+    return true;
+}
+
+bool
+removeFile(StringView path) noexcept {
+    return DeleteFile(String(path).null()) != 0;
+}
+
 bool
 writeFileVec(StringView path,
              uint32_t count,
@@ -0,0 +1,839 @@
+/********************************
+** Tsunagari Tile Engine       **
+** area-compiler.cpp           **
+** Copyright 2020 Paul Merrill **
+********************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#include "pack/area-compiler.h"
+
+#include "os/c.h"
+#include "os/os.h"
+#include "pack/area-format.h"
+#include "util/base64.h"
+#include "util/inflate.h"
+#include "util/int.h"
+#include "util/json.h"
+#include "util/noexcept.h"
+#include "util/string-view.h"
+#include "util/string.h"
+#include "util/string2.h"
+#include "util/vector.h"
+
+#define CHECK(x, message)     \
+    if (!(x)) {               \
+        return fail(message); \
+    }
+
+// Property names, indexed by direction and by AreaBinScriptType.
+static const StringView exitKeys[AREA_BIN_DIRECTIONS] = {
+        "exit", "exit:up", "exit:down", "exit:left", "exit:right"};
+static const StringView layermodKeys[AREA_BIN_DIRECTIONS] = {
+        "layermod",
+        "layermod:up",
+        "layermod:down",
+        "layermod:left",
+        "layermod:right"};
+static const StringView scriptKeys[AREA_BIN_SCRIPT_LAST] = {
+        "on_enter", "on_leave", "on_use"};
+
+// Largest number of tiles in all layers of an area.
+static constexpr size_t MAX_TILES = 0x10000000;
+
+static StringView
+dirname(StringView path) noexcept {
+    StringPosition slash = path.rfind('/');
+    return slash == SV_NOT_FOUND ? "" : path.substr(0, slash + 1);
+}
+
+// Matches /^ *\d+\+?$/.
+static bool
+isIntegerOrPlus(StringView s) noexcept {
+    size_t i = 0;
+    while (i < s.size && s.data[i] == ' ') {
+        i++;
+    }
+    while (i < s.size && '0' <= s.data[i] && s.data[i] <= '9') {
+        i++;
+    }
+    if (i < s.size && s.data[i] == '+') {
+        i++;
+    }
+    return i == s.size;
+}
+
+// Reads a map the same way AreaJSON does, and accepts the same maps.
+class AreaCompiler {
+ public:
+    AreaCompiler(StringView path, String& error) noexcept
+            : path(path), error(error) {
+        memset(&header, 0, sizeof(header));
+    }
+
+    bool
+    compileMap(JsonValue root) noexcept;
+
+    void
+    write(String& out) noexcept;
+
+    // Whether the map is larger than one region of regionSize.
+    bool
+    needsRegions(int regionSize) noexcept;
+
+    // Move the tiles out of the graphics section into regions of regionSize.
+    void
+    splitRegions(int regionSize, Vector<AreaRegion>& regions) noexcept;
+
+ private:
+    bool
+    fail(StringView message) noexcept;
+
+    AreaBinString
+    addString(StringView s) noexcept;
+
+    bool
+    compileProperties(JsonValue obj) noexcept;
+    bool
+    compileTileSet(JsonValue obj) noexcept;
+    bool
+    compileTileSetFile(JsonValue obj, StringView source) noexcept;
+    bool
+    compileAnimation(JsonValue obj, uint32_t id, uint32_t tileCount) noexcept;
+    bool
+    addLayer(JsonValue properties, AreaBinLayerType type) noexcept;
+    bool
+    compileTileLayer(JsonValue obj) noexcept;
+    bool
+    compileLayerData(JsonValue data,
+                     JsonValue encoding,
+                     JsonValue compression,
+                     int32_t* gids) noexcept;
+    bool
+    compileObjectGroup(JsonValue obj) noexcept;
+    bool
+    compileObject(JsonValue obj) noexcept;
+    bool
+    parseFlags(StringView str, uint32_t& flags) noexcept;
+    bool
+    parseExit(StringView dest, AreaBinExit& exit) noexcept;
+    bool
+    parseARGB(StringView str, uint32_t& argb) noexcept;
+
+ private:
+    StringView path;
+    String& error;
+
+    AreaBinHeader header;
+    String strings;
+    Vector<AreaBinLayer> layers;
+    Vector<AreaBinTileSet> tileSets;
+    Vector<AreaBinAnimation> animations;
+    Vector<uint32_t> frames;
+    Vector<int32_t> graphics;
+    Vector<AreaBinObject> objects;
+    Vector<AreaBinExit> exits;
+
+    // One more than the largest gid of the tilesets so far. Gid 0 is no tile.
+    uint32_t gidCount = 1;
+};
+
+bool
+AreaCompiler::fail(StringView message) noexcept {
+    error = message;
+    return false;
+}
+
+AreaBinString
+AreaCompiler::addString(StringView s) noexcept {
+    AreaBinString ref = {static_cast<uint32_t>(strings.size),
+                         static_cast<uint32_t>(s.size)};
+    strings << s;
+    return ref;
+}
+
+bool
+AreaCompiler::compileMap(JsonValue root) noexcept {
+    JsonValue widthValue = root["width"];
+    JsonValue heightValue = root["height"];
+    JsonValue propertiesValue = root["properties"];
+    JsonValue tilesetsValue = root["tilesets"];
+    JsonValue layersValue = root["layers"];
+
+    CHECK(widthValue.isNumber() && heightValue.isNumber(),
+          "map must have a width and height");
+    CHECK(propertiesValue.isObject(), "map must have properties");
+    CHECK(tilesetsValue.isArray(), "map's tilesets must be an array");
+    CHECK(layersValue.isArray(), "map's layers must be an array");
+
+    header.width = widthValue.toInt();
+    header.height = heightValue.toInt();
+
+    CHECK(0 < header.width && 0 < header.height &&
+                  static_cast<size_t>(header.width) * header.height <=
+                          MAX_TILES,
+          "map size is out of range");
+
+    if (!compileProperties(propertiesValue)) {
+        return false;
+    }
+
+    for (JsonNode& tilesetNode : tilesetsValue) {
+        CHECK(tilesetNode.value.isObject(), "tileset must be an object");
+        if (!compileTileSet(tilesetNode.value)) {
+            return false;
+        }
+    }
+
+    for (JsonNode& layerNode : layersValue) {
+        JsonValue layerValue = layerNode.value;
+        CHECK(layerValue.isObject(), "layer must be an object");
+
+        JsonValue typeValue = layerValue["type"];
+        CHECK(typeValue.isString(), "layer must have a type");
+
+        StringView type = typeValue.toString();
+        if (type == "tilelayer") {
+            if (!compileTileLayer(layerValue)) {
+                return false;
+            }
+        }
+        else if (type == "objectgroup") {
+            if (!compileObjectGroup(layerValue)) {
+                return false;
+            }
+        }
+        else {
+            return fail("Each layer must be a tilelayer or objectlayer");
+        }
+    }
+
+    header.depth = static_cast<int32_t>(layers.size);
+    return true;
+}
+
+bool
+AreaCompiler::compileProperties(JsonValue obj) noexcept {
+    JsonValue nameValue = obj["name"];
+    JsonValue musicValue = obj["music"];
+    JsonValue loopValue = obj["loop"];
+    JsonValue coloroverlayValue = obj["coloroverlay"];
+
+    CHECK(musicValue.isString() || musicValue.isNull(),
+          "music must be a string");
+    CHECK(loopValue.isString() || loopValue.isNull(), "loop must be a string");
+    CHECK(coloroverlayValue.isString() || coloroverlayValue.isNull(),
+          "coloroverlay must be a string");
+
+    // AreaJSON only complains about a missing name.
+    if (nameValue.isString()) {
+        header.name = addString(nameValue.toString());
+    }
+    if (musicValue.isString()) {
+        header.music = addString(musicValue.toString());
+    }
+    if (loopValue.isString()) {
+        StringView directions = loopValue.toString();
+        if (directions.find('x') != SV_NOT_FOUND) {
+            header.loop |= AREA_BIN_LOOP_X;
+        }
+        if (directions.find('y') != SV_NOT_FOUND) {
+            header.loop |= AREA_BIN_LOOP_Y;
+        }
+    }
+    if (coloroverlayValue.isString()) {
+        if (!parseARGB(coloroverlayValue.toString(),
+                       header.colorOverlayARGB)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool
+AreaCompiler::compileTileSet(JsonValue obj) noexcept {
+    JsonValue firstgidValue = obj["firstgid"];
+    JsonValue sourceValue = obj["source"];
+
+    CHECK(firstgidValue.isNumber(), "tileset must have a firstgid");
+    CHECK(sourceValue.isString(),
+          "tileset must refer to an external JSON file");
+
+    // Tilesets follow each other with no gaps.
+    CHECK(firstgidValue.toNumber() == static_cast<double>(gidCount),
+          "tileset's firstgid does not follow the one before it");
+
+    String source = String() << dirname(path) << sourceValue.toString();
+
+    String text;
+    if (!readFile(source, text)) {
+        return fail(String() << source << ": file not found");
+    }
+
+    JsonDocument doc(static_cast<String&&>(text));
+    if (!doc.ok || !doc.root.isObject()) {
+        return fail(String() << source << ": failed to load JSON file");
+    }
+
+    return compileTileSetFile(doc.root, source);
+}
+
+bool
+AreaCompiler::compileTileSetFile(JsonValue obj, StringView source) noexcept {
+    JsonValue imageNode = obj["image"];
+    JsonValue imagewidthNode = obj["imagewidth"];
+    JsonValue imageheightNode = obj["imageheight"];
+    JsonValue tilewidthNode = obj["tilewidth"];
+    JsonValue tileheightNode = obj["tileheight"];
+    JsonValue tilespropertiesNode = obj["tileproperties"];
+
+    CHECK(imageNode.isString() && imagewidthNode.isNumber() &&
+                  imageheightNode.isNumber() && tilewidthNode.isNumber() &&
+                  tileheightNode.isNumber() &&
+                  (tilespropertiesNode.isObject() ||
+                   tilespropertiesNode.isNull()),
+          String() << source << ": failed to parse JSON tileset file");
+
+    int tilex = tilewidthNode.toInt();
+    int tiley = tileheightNode.toInt();
+    int pixelw = imagewidthNode.toInt();
+    int pixelh = imageheightNode.toInt();
+
+    CHECK(0 < tilex && tilex <= 0x7FFF && 0 < tiley && tiley <= 0x7FFF,
+          String() << source << ": tile size is out of range");
+    CHECK(0 <= pixelw && 0 <= pixelh,
+          String() << source << ": image size is out of range");
+
+    if (header.tileWidth && header.tileWidth != tilex &&
+        header.tileHeight != tiley) {
+        return fail("Tileset's width/height contradict earlier <layer>");
+    }
+    header.tileWidth = tilex;
+    header.tileHeight = tiley;
+
+    // Tiles are numbered across the image, as tilesLoad does.
+    uint32_t width = static_cast<uint32_t>(pixelw / tilex);
+    uint32_t height = static_cast<uint32_t>(pixelh / tiley);
+    uint32_t tileCount = width * height;
+
+    CHECK(tileCount <= MAX_TILES - gidCount,
+          String() << source << ": too many tiles");
+
+    AreaBinTileSet tileSet;
+    tileSet.image = addString(String() << dirname(source)
+                                       << imageNode.toString());
+    tileSet.firstGid = static_cast<int32_t>(gidCount);
+    tileSet.tileCount = tileCount;
+    tileSet.width = width;
+    tileSet.height = height;
+    tileSet.firstAnimation = static_cast<uint32_t>(animations.size);
+    tileSet.animationCount = 0;
+
+    gidCount += tileCount;
+
+    if (tilespropertiesNode.isObject()) {
+        for (JsonNode& tilepropertiesNode : tilespropertiesNode) {
+            CHECK(tilepropertiesNode.value.isObject(),
+                  "Tile type must be an object");
+
+            // The 0-based index of a tile in this tileset.
+            unsigned id;
+            CHECK(parseUInt(id, tilepropertiesNode.key) && id < tileCount,
+                  "Tile type id is invalid");
+
+            if (!compileAnimation(tilepropertiesNode.value, id, tileCount)) {
+                return false;
+            }
+            tileSet.animationCount++;
+        }
+    }
+
+    tileSets.push_back(tileSet);
+    return true;
+}
+
+bool
+AreaCompiler::compileAnimation(JsonValue obj,
+                               uint32_t id,
+                               uint32_t tileCount) noexcept {
+    JsonValue framesNode = obj["frames"];
+    JsonValue speedNode = obj["speed"];
+
+    CHECK(framesNode.isString() && speedNode.isNumber(),
+          "animated tile must have frames and a speed");
+
+    Vector<StringView> frameStrs = splitStr(framesNode.toString(), ",");
+    CHECK(frameStrs.size, "animated tile must have frames");
+
+    AreaBinAnimation animation;
+    animation.id = id;
+    animation.firstFrame = static_cast<uint32_t>(frames.size);
+    animation.frameCount = static_cast<uint32_t>(frameStrs.size);
+
+    for (size_t i = 0; i < frameStrs.size; i++) {
+        unsigned idx;
+        CHECK(parseUInt(idx, frameStrs[i]),
+              "couldn't parse frame index for animated tile");
+        CHECK(idx < tileCount, "frame index out of range for animated tile");
+        CHECK(i > 0 || idx == id,
+              String() << "first member of tile id " << id
+                       << " animation must be itself.");
+        frames.push_back(idx);
+    }
+
+    float hertz = static_cast<float>(speedNode.toNumber());
+    CHECK(hertz > 0.0f, "animated tile's speed must be positive");
+    animation.frameLen = static_cast<int32_t>(1000.0f / hertz);
+
+    animations.push_back(animation);
+    return true;
+}
+
+bool
+AreaCompiler::addLayer(JsonValue properties, AreaBinLayerType type) noexcept {
+    JsonValue depthValue = properties["depth"];
+
+    float depth;
+    CHECK(depthValue.isString() && parseFloat(depth, depthValue.toString()),
+          type == AREA_BIN_TILE_LAYER
+                  ? "A tilelayer must have the \"depth\" property"
+                  : "An objectlayer must have the \"depth\" property");
+
+    for (AreaBinLayer& layer : layers) {
+        CHECK(layer.depth != depth, "Layers cannot share a depth");
+    }
+
+    size_t layerSize = static_cast<size_t>(header.width) * header.height;
+    CHECK(graphics.size + layerSize <= MAX_TILES, "map has too many layers");
+
+    layers.push_back({depth, static_cast<uint32_t>(type)});
+    graphics.resize(graphics.size + layerSize);
+    return true;
+}
+
+bool
+AreaCompiler::compileTileLayer(JsonValue obj) noexcept {
+    JsonValue widthValue = obj["width"];
+    JsonValue heightValue = obj["height"];
+    JsonValue propertiesValue = obj["properties"];
+
+    CHECK(widthValue.isNumber() && heightValue.isNumber(),
+          "layer must have a width and height");
+    CHECK(propertiesValue.isObject(), "layer must have properties");
+    CHECK(widthValue.toInt() == header.width &&
+                  heightValue.toInt() == header.height,
+          "layer x,y size != map x,y size");
+
+    if (!addLayer(propertiesValue, AREA_BIN_TILE_LAYER)) {
+        return false;
+    }
+
+    size_t layerSize = static_cast<size_t>(header.width) * header.height;
+    int32_t* gids = graphics.data + graphics.size - layerSize;
+
+    return compileLayerData(
+            obj["data"], obj["encoding"], obj["compression"], gids);
+}
+
+bool
+AreaCompiler::compileLayerData(JsonValue data,
+                               JsonValue encoding,
+                               JsonValue compression,
+                               int32_t* gids) noexcept {
+    size_t layerSize = static_cast<size_t>(header.width) * header.height;
+
+    if (data.isIntArray()) {
+        JsonIntArray* array = data.toIntArray();
+        CHECK(array->size == layerSize, "layer data size != map x,y size");
+
+        for (size_t i = 0; i < layerSize; i++) {
+            int32_t gid = array->data[i];
+            CHECK(0 <= gid && static_cast<uint32_t>(gid) < gidCount,
+                  "Invalid tile gid");
+            gids[i] = gid;
+        }
+        return true;
+    }
+
+    if (data.isArray()) {
+        size_t count = 0;
+        for (JsonNode& gidNode : data) {
+            CHECK(gidNode.value.isNumber(), "layer data must be numbers");
+            CHECK(count < layerSize, "layer data size != map x,y size");
+
+            double gid = gidNode.value.toNumber();
+            CHECK(0 <= gid && gid < static_cast<double>(gidCount),
+                  "Invalid tile gid");
+            gids[count++] = static_cast<int32_t>(gid);
+        }
+        CHECK(count == layerSize, "layer data size != map x,y size");
+        return true;
+    }
+
+    CHECK(data.isString() && encoding.isString() &&
+                  encoding.toString() == "base64",
+          "Layer data must be an array or base64");
+
+    StringView text = data.toString();
+    StringView method = compression.isString() ? compression.toString() : "";
+
+    // Every platform we support is little-endian.
+    uint8_t* bytes = reinterpret_cast<uint8_t*>(gids);
+    size_t byteCount = layerSize * sizeof(int32_t);
+
+    bool ok;
+    if (method.size == 0) {
+        ok = base64DecodedSize(text) == byteCount &&
+             base64Decode(text, bytes);
+    }
+    else if (method == "zlib" || method == "gzip") {
+        size_t compressedSize = base64DecodedSize(text);
+        uint8_t* compressed = static_cast<uint8_t*>(malloc(compressedSize));
+
+        ok = compressedSize > 0 && base64Decode(text, compressed);
+        if (ok && method == "zlib") {
+            ok = zlibDecompress(compressed, compressedSize, bytes, byteCount);
+        }
+        else if (ok) {
+            ok = gzipDecompress(compressed, compressedSize, bytes, byteCount);
+        }
+
+        free(compressed);
+    }
+    else {
+        return fail(String() << "Unsupported layer compression \"" << method
+                             << "\"");
+    }
+
+    CHECK(ok, "Corrupt layer data");
+
+    for (size_t i = 0; i < layerSize; i++) {
+        CHECK(static_cast<uint32_t>(gids[i]) < gidCount, "Invalid tile gid");
+    }
+
+    return true;
+}
+
+bool
+AreaCompiler::compileObjectGroup(JsonValue obj) noexcept {
+    JsonValue propertiesValue = obj["properties"];
+    JsonValue objectsValue = obj["objects"];
+
+    CHECK(propertiesValue.isObject(), "objectgroup must have properties");
+    CHECK(objectsValue.isArray(), "objectgroup must have objects");
+
+    if (!addLayer(propertiesValue, AREA_BIN_OBJECT_LAYER)) {
+        return false;
+    }
+
+    for (JsonNode& objectNode : objectsValue) {
+        CHECK(objectNode.value.isObject(), "object must be an object");
+        if (!compileObject(objectNode.value)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool
+AreaCompiler::compileObject(JsonValue obj) noexcept {
+    JsonValue propertiesValue = obj["properties"];
+    if (!propertiesValue.isObject()) {
+        // Empty tile object. Odd, but acceptable.
+        return true;
+    }
+
+    JsonValue xValue = obj["x"];
+    JsonValue yValue = obj["y"];
+    JsonValue widthValue = obj["width"];
+    JsonValue heightValue = obj["height"];
+
+    CHECK(xValue.isNumber() && yValue.isNumber() && widthValue.isNumber() &&
+                  heightValue.isNumber(),
+          "object must have a position and size");
+    CHECK(header.tileWidth && header.tileHeight,
+          "object must follow a tileset");
+
+    AreaBinObject object;
+    memset(&object, 0, sizeof(object));
+
+    object.x = xValue.toInt() / header.tileWidth;
+    object.y = yValue.toInt() / header.tileHeight;
+    object.z = static_cast<int32_t>(layers.size) - 1;
+    object.width = widthValue.toInt() / header.tileWidth;
+    object.height = heightValue.toInt() / header.tileHeight;
+
+    CHECK(0 <= object.x && object.x + object.width <= header.width &&
+                  0 <= object.y && object.y + object.height <= header.height,
+          "object is outside of the map");
+
+    JsonValue flagsValue = propertiesValue["flags"];
+    CHECK(flagsValue.isString() || flagsValue.isNull(),
+          "flags must be a string");
+    if (flagsValue.isString() &&
+        !parseFlags(flagsValue.toString(), object.flags)) {
+        return false;
+    }
+
+    for (size_t i = 0; i < AREA_BIN_SCRIPT_LAST; i++) {
+        JsonValue scriptValue = propertiesValue[scriptKeys[i]];
+        CHECK(scriptValue.isString() || scriptValue.isNull(),
+              "script must be a string");
+        if (scriptValue.isString()) {
+            object.scripts[i] = addString(scriptValue.toString());
+        }
+    }
+
+    object.firstExit = static_cast<uint32_t>(exits.size);
+
+    for (uint32_t i = 0; i < AREA_BIN_DIRECTIONS; i++) {
+        JsonValue exitValue = propertiesValue[exitKeys[i]];
+        CHECK(exitValue.isString() || exitValue.isNull(),
+              "exit must be a string");
+        if (!exitValue.isString()) {
+            continue;
+        }
+
+        AreaBinExit exit;
+        if (!parseExit(exitValue.toString(), exit)) {
+            return false;
+        }
+        exits.push_back(exit);
+        object.exits |= 1 << i;
+    }
+
+    for (uint32_t i = 0; i < AREA_BIN_DIRECTIONS; i++) {
+        JsonValue layermodValue = propertiesValue[layermodKeys[i]];
+        if (layermodValue.isNull()) {
+            continue;
+        }
+
+        CHECK(layermodValue.isString() &&
+                      parseFloat(object.layermodDepths[i],
+                                 layermodValue.toString()),
+              "layermod must be a number");
+        object.layermods |= 1 << i;
+    }
+
+    // As in AreaJSON, NPCs keep off of tiles with a plain exit or layermod.
+    if ((object.exits | object.layermods) & (1 << 0)) {
+        object.flags |= AREA_BIN_NOWALK_NPC;
+    }
+
+    objects.push_back(object);
+    return true;
+}
+
+bool
+AreaCompiler::parseFlags(StringView str, uint32_t& flags) noexcept {
+    for (StringView flag : splitStr(str, ",")) {
+        if (flag == "nowalk") {
+            flags |= AREA_BIN_NOWALK;
+        }
+        else if (flag == "nowalk_player") {
+            flags |= AREA_BIN_NOWALK_PLAYER;
+        }
+        else if (flag == "nowalk_npc") {
+            flags |= AREA_BIN_NOWALK_NPC;
+        }
+        else {
+            return fail(String() << "Invalid tile flag: " << flag);
+        }
+    }
+
+    return true;
+}
+
+bool
+AreaCompiler::parseExit(StringView dest, AreaBinExit& exit) noexcept {
+    // Format: destination area, x, y, z
+    // E.g.:   "babysfirst.area,1,3,0"
+
+    Vector<StringView> strs = splitStr(dest, ",");
+    CHECK(strs.size == 4, "exit: Invalid format");
+
+    StringView x = strs[1];
+    StringView y = strs[2];
+    StringView z = strs[3];
+
+    CHECK(isIntegerOrPlus(x) && isIntegerOrPlus(y) && isIntegerOrPlus(z),
+          "exit: Invalid format");
+
+    exit.wide = 0;
+    if (x.find('+') != SV_NOT_FOUND) {
+        exit.wide |= AREA_BIN_EXIT_WIDE_X;
+        x = x.substr(0, x.size - 1);
+    }
+    if (y.find('+') != SV_NOT_FOUND) {
+        exit.wide |= AREA_BIN_EXIT_WIDE_Y;
+        y = y.substr(0, y.size - 1);
+    }
+
+    int x_, y_;
+    CHECK(parseInt(x_, x) && parseInt(y_, y) && parseFloat(exit.z, z),
+          "exit: Invalid format");
+
+    exit.area = addString(strs[0]);
+    exit.x = x_;
+    exit.y = y_;
+    return true;
+}
+
+bool
+AreaCompiler::parseARGB(StringView str, uint32_t& argb) noexcept {
+    Vector<StringView> strs = splitStr(str, ",");
+    CHECK(strs.size == 4, "invalid ARGB format");
+
+    argb = 0;
+    for (size_t i = 0; i < 4; i++) {
+        int v;
+        CHECK(parseInt(v, strs[i]), "invalid ARGB format");
+        CHECK(0 <= v && v < 256, "ARGB values must be between 0 and 255");
+        argb = (argb << 8) | static_cast<uint32_t>(v);
+    }
+
+    return true;
+}
+
+static void
+writeSection(String& out,
+             AreaBinSection& section,
+             const void* data,
+             size_t size,
+             size_t count) noexcept {
+    size_t offset = out.size;
+
+    section.offset = static_cast<uint32_t>(offset);
+    section.count = static_cast<uint32_t>(count);
+
+    // Start the next section on a multiple of four bytes.
+    out.resize(offset + ((size + 3) & ~static_cast<size_t>(3)));
+    memcpy(out.data + offset, data, size);
+    memset(out.data + offset + size, 0, out.size - offset - size);
+}
+
+bool
+AreaCompiler::needsRegions(int regionSize) noexcept {
+    return regionSize > 0 &&
+           (header.width > regionSize || header.height > regionSize);
+}
+
+void
+AreaCompiler::splitRegions(int regionSize,
+                           Vector<AreaRegion>& regions) noexcept {
+    int width = header.width;
+    int height = header.height;
+    size_t layerSize = static_cast<size_t>(width) * height;
+
+    for (int ry = 0; ry * regionSize < height; ry++) {
+        for (int rx = 0; rx * regionSize < width; rx++) {
+            int x1 = rx * regionSize;
+            int y1 = ry * regionSize;
+            int w = width - x1 < regionSize ? width - x1 : regionSize;
+            int h = height - y1 < regionSize ? height - y1 : regionSize;
+            size_t rowSize = static_cast<size_t>(w) * sizeof(int32_t);
+
+            regions.push_back(AreaRegion{rx, ry, String()});
+            String& data = regions[regions.size - 1].data;
+            data.resize(rowSize * h * layers.size);
+
+            char* dst = data.data;
+            for (size_t z = 0; z < layers.size; z++) {
+                for (int y = y1; y < y1 + h; y++) {
+                    memcpy(dst,
+                           graphics.data + z * layerSize +
+                                   static_cast<size_t>(y) * width + x1,
+                           rowSize);
+                    dst += rowSize;
+                }
+            }
+        }
+    }
+
+    header.regionSize = static_cast<uint32_t>(regionSize);
+    graphics.clear();
+}
+
+#define WRITE_VECTOR(section, vector)                  \
+    writeSection(out,                                  \
+                 header.section,                       \
+                 vector.data,                          \
+                 vector.size * sizeof(vector.data[0]), \
+                 vector.size)
+
+void
+AreaCompiler::write(String& out) noexcept {
+    memcpy(header.magic, AREA_BIN_MAGIC, sizeof(header.magic));
+    header.version = AREA_BIN_VERSION;
+
+    out.clear();
+    out.resize(sizeof(header));
+
+    writeSection(out, header.strings, strings.data, strings.size,
+                 strings.size);
+    WRITE_VECTOR(layers, layers);
+    WRITE_VECTOR(tileSets, tileSets);
+    WRITE_VECTOR(animations, animations);
+    WRITE_VECTOR(frames, frames);
+    WRITE_VECTOR(graphics, graphics);
+    WRITE_VECTOR(objects, objects);
+    WRITE_VECTOR(exits, exits);
+
+    memcpy(out.data, &header, sizeof(header));
+}
+
+AreaCompileResult
+compileArea(StringView path,
+            StringView text,
+            int regionSize,
+            String& out,
+            Vector<AreaRegion>& regions,
+            String& error) noexcept {
+    JsonDocument doc(text);
+    if (!doc.ok || !doc.root.isObject()) {
+        return AREA_NOT_A_MAP;
+    }
+
+    JsonValue root = doc.root;
+    if (root["layers"].isNull() || root["tilesets"].isNull()) {
+        return AREA_NOT_A_MAP;
+    }
+
+    AreaCompiler compiler(path, error);
+    if (!compiler.compileMap(root)) {
+        return AREA_INVALID;
+    }
+
+    if (compiler.needsRegions(regionSize)) {
+        compiler.splitRegions(regionSize, regions);
+    }
+
+    compiler.write(out);
+
+    if (out.size > UINT32_MAX) {
+        error = "compiled area is too large";
+        return AREA_INVALID;
+    }
+
+    return AREA_COMPILED;
+}
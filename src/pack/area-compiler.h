@@ -0,0 +1,63 @@
+/********************************
+** Tsunagari Tile Engine       **
+** area-compiler.h             **
+** Copyright 2020 Paul Merrill **
+********************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#ifndef SRC_PACK_AREA_COMPILER_H_
+#define SRC_PACK_AREA_COMPILER_H_
+
+#include "util/noexcept.h"
+#include "util/string-view.h"
+#include "util/string.h"
+#include "util/vector.h"
+
+enum AreaCompileResult {
+    AREA_COMPILED,
+    AREA_NOT_A_MAP,  // Some other kind of JSON file.
+    AREA_INVALID,
+};
+
+// The tiles of a streamed map at rx, ry in regions, as stored in the file
+// named by areaBinRegionPath.
+struct AreaRegion {
+    int x;
+    int y;
+    String data;
+};
+
+// Compile text, the contents of the JSON file at path, to the binary area
+// format in pack/area-format.h if it is a Tiled map. The tilesets it refers to
+// are read from the file system relative to path. If regionSize is not 0 and
+// the map is larger than one region of that size, its tiles are split into
+// regions instead of being kept in out. On AREA_INVALID, error says why. May
+// be called from several threads at once.
+AreaCompileResult
+compileArea(StringView path,
+            StringView text,
+            int regionSize,
+            String& out,
+            Vector<AreaRegion>& regions,
+            String& error) noexcept;
+
+#endif  // SRC_PACK_AREA_COMPILER_H_
@@ -0,0 +1,211 @@
+/********************************
+** Tsunagari Tile Engine       **
+** area-format.h               **
+** Copyright 2020 Paul Merrill **
+********************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#ifndef SRC_PACK_AREA_FORMAT_H_
+#define SRC_PACK_AREA_FORMAT_H_
+
+#include "util/int.h"
+#include "util/noexcept.h"
+#include "util/string-view.h"
+#include "util/string.h"
+
+// The binary area format that `pack-tool create --compile-areas` turns Tiled
+// JSON maps and their tilesets into. A map at "areas/grove.json" is compiled
+// to "areas/grove.json.bin", and the engine loads that instead when it is
+// there.
+//
+// Everything is little-endian. The file starts with an AreaBinHeader whose
+// sections each point to an array of records elsewhere in the file. Sections
+// start on a multiple of four bytes, but the file itself may be stored at any
+// alignment in an archive, so readers should copy records out rather than
+// cast pointers to them.
+//
+// With `--stream-areas`, the tiles of a large map are left out of its
+// compiled file and split into square regions of regionSize tiles, each in
+// its own file so the engine can load only those near the viewport. The
+// region at rx, ry of "areas/grove.json" is "areas/grove.json.rx.ry.region".
+// It holds the int32_t gids of that region on each layer in turn, row by row,
+// and is smaller than regionSize on a side at the right and bottom edges of
+// the map.
+
+#define AREA_BIN_EXTENSION ".bin"
+#define AREA_BIN_REGION_EXTENSION ".region"
+
+// Side of the regions that `--stream-areas` splits maps into, in tiles.
+#define AREA_BIN_REGION_SIZE 128
+
+static constexpr uint8_t AREA_BIN_MAGIC[4] = {84, 115, 65, 114};  // "TsAr"
+
+// Increase when the layout changes. The engine falls back to the JSON map
+// when a compiled one has a different version.
+static constexpr uint32_t AREA_BIN_VERSION = 2;
+
+// An array of count records starting offset bytes into the file.
+struct AreaBinSection {
+    uint32_t offset;
+    uint32_t count;
+};
+
+// size bytes starting offset bytes into the strings section. Not
+// NUL-terminated.
+struct AreaBinString {
+    uint32_t offset;
+    uint32_t size;
+};
+
+enum AreaBinLoop {
+    AREA_BIN_LOOP_X = 0x1,
+    AREA_BIN_LOOP_Y = 0x2,
+};
+
+struct AreaBinHeader {
+    uint8_t magic[4];
+    uint32_t version;
+
+    // Size of the map in tiles. depth is the number of layers.
+    int32_t width;
+    int32_t height;
+    int32_t depth;
+
+    // Size of a tile in pixels.
+    int32_t tileWidth;
+    int32_t tileHeight;
+
+    uint32_t loop;  // AreaBinLoop flags.
+    uint32_t colorOverlayARGB;
+
+    // Side of the regions the tiles are stored in, or 0 if they are all in
+    // the graphics section.
+    uint32_t regionSize;
+
+    AreaBinString name;
+    AreaBinString music;  // Empty if the area has no music.
+
+    AreaBinSection strings;     // char
+    AreaBinSection layers;      // AreaBinLayer, one per layer
+    AreaBinSection tileSets;    // AreaBinTileSet, in gid order
+    AreaBinSection animations;  // AreaBinAnimation
+    AreaBinSection frames;      // uint32_t, tile indices within a tileset
+    AreaBinSection graphics;    // int32_t gids, width * height * depth or 0
+    AreaBinSection objects;     // AreaBinObject
+    AreaBinSection exits;       // AreaBinExit
+};
+
+enum AreaBinLayerType {
+    AREA_BIN_TILE_LAYER,
+    AREA_BIN_OBJECT_LAYER,
+};
+
+struct AreaBinLayer {
+    float depth;
+    uint32_t type;  // AreaBinLayerType.
+};
+
+struct AreaBinTileSet {
+    AreaBinString image;  // Path of the image within the archive.
+    int32_t firstGid;
+    uint32_t tileCount;
+
+    // Size of the image in tiles.
+    uint32_t width;
+    uint32_t height;
+
+    // This tileset's animated tiles in the animations section.
+    uint32_t firstAnimation;
+    uint32_t animationCount;
+};
+
+struct AreaBinAnimation {
+    uint32_t id;  // Tile index within its tileset.
+    int32_t frameLen;  // Milliseconds.
+
+    // This animation's frames in the frames section.
+    uint32_t firstFrame;
+    uint32_t frameCount;
+};
+
+enum AreaBinScriptType {
+    AREA_BIN_SCRIPT_ENTER,
+    AREA_BIN_SCRIPT_LEAVE,
+    AREA_BIN_SCRIPT_USE,
+    AREA_BIN_SCRIPT_LAST,
+};
+
+// The same values as TILE_NOWALK etc. in core/tile-grid.h.
+enum AreaBinTileFlags {
+    AREA_BIN_NOWALK = 0x1,
+    AREA_BIN_NOWALK_PLAYER = 0x2,
+    AREA_BIN_NOWALK_NPC = 0x4,
+};
+
+// Exits and layermods are indexed by direction in ExitDirection order.
+#define AREA_BIN_DIRECTIONS 5
+
+// An object from an object layer, which gives its properties to a rectangle
+// of tiles on that layer. Later objects override earlier ones.
+struct AreaBinObject {
+    // Position and size in tiles.
+    int32_t x, y, z;
+    int32_t width, height;
+
+    uint32_t flags;  // AreaBinTileFlags.
+
+    // Names of scripts in the area's DataArea, indexed by AreaBinScriptType.
+    // Empty if none.
+    AreaBinString scripts[AREA_BIN_SCRIPT_LAST];
+
+    // One bit per direction that has an exit. The exits are in the exits
+    // section starting at firstExit, in direction order.
+    uint32_t exits;
+    uint32_t firstExit;
+
+    // One bit per direction that has a layermod.
+    uint32_t layermods;
+    float layermodDepths[AREA_BIN_DIRECTIONS];
+};
+
+enum AreaBinExitWide {
+    // The destination's x or y is offset by the tile's position within the
+    // object, as written with "x+" or "y+".
+    AREA_BIN_EXIT_WIDE_X = 0x1,
+    AREA_BIN_EXIT_WIDE_Y = 0x2,
+};
+
+struct AreaBinExit {
+    AreaBinString area;
+    int32_t x;
+    int32_t y;
+    float z;
+    uint32_t wide;  // AreaBinExitWide flags.
+};
+
+static inline String
+areaBinRegionPath(StringView map, int rx, int ry) noexcept {
+    return String() << map << "." << rx << "." << ry
+                    << AREA_BIN_REGION_EXTENSION;
+}
+
+#endif  // SRC_PACK_AREA_FORMAT_H_
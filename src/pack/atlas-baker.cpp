@@ -0,0 +1,301 @@
+/********************************
+** Tsunagari Tile Engine       **
+** atlas-baker.cpp             **
+** Copyright 2020 Paul Merrill **
+********************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#include "pack/atlas-baker.h"
+
+#include "os/c.h"
+#include "os/os.h"
+#include "pack/atlas-format.h"
+#include "pack/texture-writer.h"
+#include "util/int.h"
+#include "util/json.h"
+#include "util/move.h"
+#include "util/png.h"
+#include "util/sort.h"
+
+static StringView
+dirname(StringView path) noexcept {
+    StringPosition slash = path.rfind('/');
+    return slash == SV_NOT_FOUND ? "" : path.substr(0, slash + 1);
+}
+
+// The images of the tilesets a map uses, found the same way AreaJSON does.
+static void
+findMapImages(StringView path, JsonValue root, Vector<String>& images)
+        noexcept {
+    for (JsonNode& tilesetNode : root["tilesets"]) {
+        JsonValue sourceValue = tilesetNode.value["source"];
+        if (!sourceValue.isString()) {
+            continue;
+        }
+
+        String source = String() << dirname(path) << sourceValue.toString();
+
+        String text;
+        if (!readFile(source, text)) {
+            continue;
+        }
+
+        JsonDocument doc(static_cast<String&&>(text));
+        if (!doc.ok || !doc.root.isObject()) {
+            continue;
+        }
+
+        JsonValue imageValue = doc.root["image"];
+        if (imageValue.isString()) {
+            images.push_back(String() << dirname(source)
+                                      << imageValue.toString());
+        }
+    }
+}
+
+void
+atlasFindImages(StringView path, StringView text, Vector<String>& images)
+        noexcept {
+    JsonDocument doc(text);
+    if (!doc.ok || !doc.root.isObject()) {
+        return;
+    }
+
+    JsonValue root = doc.root;
+
+    // A Tiled map.
+    if (root["layers"].isArray() && root["tilesets"].isArray()) {
+        findMapImages(path, root, images);
+        return;
+    }
+
+    // An entity descriptor. Its sprite sheet's path is used as is, as Entity
+    // does.
+    JsonValue sheetPath = root["sprite"]["sheet"]["path"];
+    if (sheetPath.isString()) {
+        images.push_back(String(sheetPath.toString()));
+    }
+}
+
+struct BakedImage {
+    StringView path;
+    uint32_t width;
+    uint32_t height;
+    Vector<uint8_t> rgba;
+
+    uint32_t page;
+    uint32_t x;
+    uint32_t y;
+};
+
+// A row of images across a page, as tall as the first image put in it.
+struct Shelf {
+    uint32_t page;
+    uint32_t y;
+    uint32_t height;
+    uint32_t width;  // Used so far.
+};
+
+// Place each image on a page, tallest first, in the first shelf with room
+// for it. Returns the number of pages used.
+static uint32_t
+placeImages(Vector<BakedImage>& baked) noexcept {
+    Vector<size_t> order;
+    order.reserve(baked.size);
+    for (size_t i = 0; i < baked.size; i++) {
+        order.push_back(i);
+    }
+
+    BakedImage* data = baked.data;
+    size_t* idx = order.data;
+#define LESS(i, j)                                                 \
+    (data[idx[i]].height != data[idx[j]].height                    \
+             ? data[idx[i]].height > data[idx[j]].height           \
+             : data[idx[i]].width != data[idx[j]].width            \
+                       ? data[idx[i]].width > data[idx[j]].width   \
+                       : idx[i] < idx[j])
+#define SWAP(i, j) swap_(idx[i], idx[j])
+    QSORT(order.size, LESS, SWAP);
+#undef LESS
+#undef SWAP
+
+    Vector<Shelf> shelves;
+    Vector<uint32_t> pageHeights;  // Used so far.
+
+    for (size_t i : order) {
+        BakedImage& image = baked[i];
+
+        Shelf* shelf = 0;
+        for (Shelf& s : shelves) {
+            if (image.height <= s.height &&
+                s.width + image.width <= ATLAS_PAGE_SIZE) {
+                shelf = &s;
+                break;
+            }
+        }
+
+        if (!shelf) {
+            uint32_t page = 0;
+            while (page < pageHeights.size &&
+                   pageHeights[page] + image.height > ATLAS_PAGE_SIZE) {
+                page++;
+            }
+            if (page == pageHeights.size) {
+                pageHeights.push_back(0);
+            }
+
+            shelves.push_back({page, pageHeights[page], image.height, 0});
+            pageHeights[page] += image.height;
+            shelf = &shelves[shelves.size - 1];
+        }
+
+        image.page = shelf->page;
+        image.x = shelf->width;
+        image.y = shelf->y;
+        shelf->width += image.width;
+    }
+
+    return static_cast<uint32_t>(pageHeights.size);
+}
+
+static void
+drawPage(Vector<BakedImage>& baked, uint32_t page, Vector<uint8_t>& pixels)
+        noexcept {
+    size_t pitch = ATLAS_PAGE_SIZE * 4;
+
+    pixels.resize(pitch * ATLAS_PAGE_SIZE);
+    memset(pixels.data, 0, pixels.size);
+
+    for (BakedImage& image : baked) {
+        if (image.page != page) {
+            continue;
+        }
+
+        size_t rowSize = image.width * 4;
+        for (uint32_t row = 0; row < image.height; row++) {
+            memcpy(pixels.data + (image.y + row) * pitch + image.x * 4,
+                   image.rgba.data + row * rowSize,
+                   rowSize);
+        }
+    }
+}
+
+static void
+writeManifest(Vector<BakedImage>& baked, uint32_t pageCount, String& out)
+        noexcept {
+    size_t stringsSize = 0;
+    for (BakedImage& image : baked) {
+        stringsSize += image.path.size;
+    }
+
+    AtlasHeader header;
+    memcpy(header.magic, ATLAS_MAGIC, sizeof(header.magic));
+    header.version = ATLAS_VERSION;
+    header.pageCount = pageCount;
+    header.entryCount = static_cast<uint32_t>(baked.size);
+    header.stringsSize = static_cast<uint32_t>(stringsSize);
+
+    size_t entriesOffset = sizeof(header);
+    size_t stringsOffset = entriesOffset + baked.size * sizeof(AtlasEntry);
+
+    out.resize(stringsOffset + stringsSize);
+    memcpy(out.data, &header, sizeof(header));
+
+    uint32_t pathOffset = 0;
+    for (size_t i = 0; i < baked.size; i++) {
+        BakedImage& image = baked[i];
+
+        AtlasEntry entry;
+        entry.pathOffset = pathOffset;
+        entry.pathSize = static_cast<uint32_t>(image.path.size);
+        entry.page = image.page;
+        entry.x = static_cast<uint16_t>(image.x);
+        entry.y = static_cast<uint16_t>(image.y);
+        entry.width = static_cast<uint16_t>(image.width);
+        entry.height = static_cast<uint16_t>(image.height);
+
+        memcpy(out.data + entriesOffset + i * sizeof(entry), &entry,
+               sizeof(entry));
+        memcpy(out.data + stringsOffset + pathOffset, image.path.data,
+               image.path.size);
+
+        pathOffset += entry.pathSize;
+    }
+}
+
+void
+atlasBake(Vector<String>& images,
+          TextureCompression compression,
+          Function<void(StringView path, String& data)> add,
+          Vector<String>& skipped) noexcept {
+    Vector<BakedImage> baked;
+
+    for (String& path : images) {
+        String data;
+        if (!readFile(path, data)) {
+            skipped.push_back(String() << path << ": file not found");
+            continue;
+        }
+
+        BakedImage image;
+        image.path = path;
+        if (!pngDecode(data, image.width, image.height, image.rgba)) {
+            skipped.push_back(String() << path << ": not a PNG");
+            continue;
+        }
+        if (image.width > ATLAS_PAGE_SIZE || image.height > ATLAS_PAGE_SIZE) {
+            skipped.push_back(String() << path
+                                       << ": too large for an atlas page");
+            continue;
+        }
+
+        baked.push_back(move_(image));
+    }
+
+    if (baked.size == 0) {
+        return;
+    }
+
+    uint32_t pageCount = placeImages(baked);
+
+    Vector<uint8_t> pixels;
+    for (uint32_t page = 0; page < pageCount; page++) {
+        drawPage(baked, page, pixels);
+
+        // The images on this page are not needed again.
+        for (BakedImage& image : baked) {
+            if (image.page == page) {
+                image.rgba = Vector<uint8_t>();
+            }
+        }
+
+        String path, texture;
+        path << ATLAS_PAGE_PREFIX << page << TEXTURE_EXTENSION;
+        makeTexture(ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE, pixels.data,
+                    compression, texture);
+        add(path, texture);
+    }
+
+    String manifest;
+    writeManifest(baked, pageCount, manifest);
+    add(ATLAS_MANIFEST_PATH, manifest);
+}
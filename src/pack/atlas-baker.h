@@ -0,0 +1,58 @@
+/********************************
+** Tsunagari Tile Engine       **
+** atlas-baker.h               **
+** Copyright 2020 Paul Merrill **
+********************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#ifndef SRC_PACK_ATLAS_BAKER_H_
+#define SRC_PACK_ATLAS_BAKER_H_
+
+#include "pack/texture-format.h"
+#include "util/function.h"
+#include "util/noexcept.h"
+#include "util/string-view.h"
+#include "util/string.h"
+#include "util/vector.h"
+
+// Add the paths of the images that text, the contents of the JSON file at
+// path, refers to if it is a Tiled map or an entity descriptor. The tilesets
+// a map uses are read from the file system relative to path. May be called
+// from several threads at once.
+void
+atlasFindImages(StringView path, StringView text, Vector<String>& images)
+        noexcept;
+
+// Pack the images at the given paths, read from the file system, into atlas
+// pages and build the manifest for them, in the format in
+// pack/atlas-format.h. Images that are missing, are not PNGs, or don't fit
+// on a page are left out and described in skipped, and the engine loads
+// them one by one as before. Each page is passed to add as soon as it is
+// drawn, and the manifest last, so only one page is held at a time. Nothing
+// is passed to add if no image was packed.
+void
+atlasBake(Vector<String>& images,
+          TextureCompression compression,
+          Function<void(StringView path, String& data)> add,
+          Vector<String>& skipped) noexcept;
+
+#endif  // SRC_PACK_ATLAS_BAKER_H_
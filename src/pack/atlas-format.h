@@ -0,0 +1,74 @@
+/********************************
+** Tsunagari Tile Engine       **
+** atlas-format.h              **
+** Copyright 2020 Paul Merrill **
+********************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#ifndef SRC_PACK_ATLAS_FORMAT_H_
+#define SRC_PACK_ATLAS_FORMAT_H_
+
+#include "util/int.h"
+
+// The texture atlas that `pack-tool create --bake-atlas` builds from the
+// tilesets and sprite sheets a world's areas and entities refer to. The
+// images are packed into pages of ATLAS_PAGE_SIZE pixels on a side, each
+// stored as a texture blob (pack/texture-format.h) at
+// "atlas/page-<n>.tex". The manifest at ATLAS_MANIFEST_PATH says where on
+// which page every image went, and the engine draws from the pages instead
+// of loading those images one by one.
+//
+// The manifest starts with an AtlasHeader, followed by entryCount
+// AtlasEntry records and then stringsSize bytes of image paths. Everything
+// is little-endian.
+
+#define ATLAS_MANIFEST_PATH "atlas/manifest.bin"
+#define ATLAS_PAGE_PREFIX "atlas/page-"
+
+static constexpr uint8_t ATLAS_MAGIC[4] = {84, 115, 65, 116};  // "TsAt"
+
+// Increase when the layout changes. The engine ignores a manifest with a
+// different version and loads images one by one.
+static constexpr uint32_t ATLAS_VERSION = 1;
+
+// Width and height of every page.
+static constexpr uint32_t ATLAS_PAGE_SIZE = 2048;
+
+struct AtlasHeader {
+    uint8_t magic[4];
+    uint32_t version;
+    uint32_t pageCount;
+    uint32_t entryCount;
+    uint32_t stringsSize;
+};
+
+struct AtlasEntry {
+    uint32_t pathOffset;  // Into the strings after the entries.
+    uint32_t pathSize;
+    uint32_t page;
+    uint16_t x;
+    uint16_t y;
+    uint16_t width;
+    uint16_t height;
+};
+
+#endif  // SRC_PACK_ATLAS_FORMAT_H_
@@ -0,0 +1,215 @@
+/********************************
+** Tsunagari Tile Engine       **
+** layered-pack-reader.cpp     **
+** Copyright 2020 Paul Merrill **
+********************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+#include "pack/layered-pack-reader.h"
+
+#include "pack/pack-reader.h"
+#include "util/assert.h"
+#include "util/hashtable.h"
+#include "util/int.h"
+#include "util/move.h"
+#include "util/new.h"
+#include "util/noexcept.h"
+#include "util/string-view.h"
+#include "util/vector.h"
+
+class LayeredPackReader : public PackReader {
+ public:
+    ~LayeredPackReader() noexcept;
+
+    BlobIndex
+    size() noexcept;
+
+    BlobIndex
+    findIndex(StringView path) noexcept;
+
+    StringView
+    getBlobPath(BlobIndex index) noexcept;
+    BlobSize
+    getBlobSize(BlobIndex index) noexcept;
+    void*
+    getBlobData(BlobIndex index) noexcept;
+    BlobSize
+    getBlobCompressedSize(BlobIndex index) noexcept;
+    BlobCompressionType
+    getBlobCompression(BlobIndex index) noexcept;
+    bool
+    getBlobChecksum(BlobIndex index, uint32_t& checksum) noexcept;
+
+    bool
+    readBlob(BlobIndex index, void* buf) noexcept;
+    bool
+    readBlobRange(BlobIndex index, BlobSize offset, size_t size, void* buf)
+            noexcept;
+
+    void
+    prefetch(const BlobIndex* indices, size_t count) noexcept;
+
+ public:
+    // Find the layer an index falls in and the index within that layer.
+    size_t
+    locate(BlobIndex& index) noexcept;
+
+ public:
+    Vector<PackReader*> layers;
+    Vector<BlobIndex> firstIndices;  // Index of each layer's first blob.
+    BlobIndex blobCount;
+
+    // Paths in every layer after the first, each mapped to the index of its
+    // topmost blob. Other paths are looked up in the first layer. Keys point
+    // into the layers' mapped files.
+    Hashmap<StringView, BlobIndex> overrides;
+};
+
+PackReader*
+makeLayeredPackReader(Vector<PackReader*> layers) noexcept {
+    assert_(layers.size > 0);
+
+    LayeredPackReader* reader = new LayeredPackReader;
+    reader->layers = move_(layers);
+    reader->blobCount = 0;
+
+    for (size_t i = 0; i < reader->layers.size; i++) {
+        PackReader* layer = reader->layers[i];
+
+        reader->firstIndices.push_back(reader->blobCount);
+
+        if (i > 0) {
+            for (BlobIndex j = 0; j < layer->size(); j++) {
+                reader->overrides[layer->getBlobPath(j)] =
+                        reader->blobCount + j;
+            }
+        }
+
+        reader->blobCount += layer->size();
+    }
+
+    return reader;
+}
+
+LayeredPackReader::~LayeredPackReader() noexcept {
+    for (PackReader* layer : layers) {
+        delete layer;
+    }
+}
+
+size_t
+LayeredPackReader::locate(BlobIndex& index) noexcept {
+    // There are only ever a few layers.
+    size_t layer = layers.size - 1;
+    while (index < firstIndices[layer]) {
+        layer--;
+    }
+    index -= firstIndices[layer];
+    return layer;
+}
+
+BlobIndex
+LayeredPackReader::size() noexcept {
+    return blobCount;
+}
+
+BlobIndex
+LayeredPackReader::findIndex(StringView path) noexcept {
+    BlobIndex* index = overrides.tryAt(path);
+    if (index) {
+        return *index;
+    }
+    return layers[0]->findIndex(path);
+}
+
+StringView
+LayeredPackReader::getBlobPath(BlobIndex index) noexcept {
+    size_t layer = locate(index);
+    return layers[layer]->getBlobPath(index);
+}
+
+BlobSize
+LayeredPackReader::getBlobSize(BlobIndex index) noexcept {
+    size_t layer = locate(index);
+    return layers[layer]->getBlobSize(index);
+}
+
+void*
+LayeredPackReader::getBlobData(BlobIndex index) noexcept {
+    size_t layer = locate(index);
+    return layers[layer]->getBlobData(index);
+}
+
+BlobSize
+LayeredPackReader::getBlobCompressedSize(BlobIndex index) noexcept {
+    size_t layer = locate(index);
+    return layers[layer]->getBlobCompressedSize(index);
+}
+
+BlobCompressionType
+LayeredPackReader::getBlobCompression(BlobIndex index) noexcept {
+    size_t layer = locate(index);
+    return layers[layer]->getBlobCompression(index);
+}
+
+bool
+LayeredPackReader::getBlobChecksum(BlobIndex index, uint32_t& checksum)
+        noexcept {
+    size_t layer = locate(index);
+    return layers[layer]->getBlobChecksum(index, checksum);
+}
+
+bool
+LayeredPackReader::readBlob(BlobIndex index, void* buf) noexcept {
+    size_t layer = locate(index);
+    return layers[layer]->readBlob(index, buf);
+}
+
+bool
+LayeredPackReader::readBlobRange(BlobIndex index,
+                                 BlobSize offset,
+                                 size_t size,
+                                 void* buf) noexcept {
+    size_t layer = locate(index);
+    return layers[layer]->readBlobRange(index, offset, size, buf);
+}
+
+void
+LayeredPackReader::prefetch(const BlobIndex* indices, size_t count) noexcept {
+    Vector<BlobIndex> local;
+    local.reserve(count);
+
+    for (size_t layer = 0; layer < layers.size; layer++) {
+        local.clear();
+        for (size_t i = 0; i < count; i++) {
+            BlobIndex index = indices[i];
+            if (index == BLOB_NOT_FOUND) {
+                continue;
+            }
+            if (locate(index) == layer) {
+                local.push_back(index);
+            }
+        }
+        if (local.size) {
+            layers[layer]->prefetch(local.data, local.size);
+        }
+    }
+}
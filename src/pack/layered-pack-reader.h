@@ -0,0 +1,45 @@
+/********************************
+** Tsunagari Tile Engine       **
+** layered-pack-reader.h       **
+** Copyright 2020 Paul Merrill **
+********************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+#ifndef SRC_PACK_LAYERED_PACK_READER_H_
+#define SRC_PACK_LAYERED_PACK_READER_H_
+
+#include "pack/pack-reader.h"
+#include "util/noexcept.h"
+#include "util/vector.h"
+
+// Presents several packs as one, such as a base archive followed by patches.
+// A blob in a later layer overrides any blob with the same path in earlier
+// layers. Indices run through the blobs of each layer in turn, so overridden
+// blobs keep their indices but are never returned by findIndex.
+//
+// Finding a path costs one hash table probe for paths from patches plus one
+// probe of the first layer's own lookup table, however many layers there are.
+//
+// Takes ownership of the layers.
+PackReader*
+makeLayeredPackReader(Vector<PackReader*> layers) noexcept;
+
+#endif  // SRC_PACK_LAYERED_PACK_READER_H_
@@ -0,0 +1,276 @@
+/********************************
+** Tsunagari Tile Engine       **
+** lz4.cpp                     **
+** Copyright 2020 Paul Merrill **
+********************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#include "pack/lz4.h"
+
+#include "os/c.h"
+#include "util/constexpr.h"
+#include "util/int.h"
+#include "util/likely.h"
+#include "util/noexcept.h"
+
+// Sequences are <token> [<literal length>...] <literals> <offset>
+// [<match length>...]. The token's high nibble is the literal length and its
+// low nibble is the match length minus MIN_MATCH; a nibble of 15 means more
+// length bytes follow.
+
+static constexpr size_t MIN_MATCH = 4;
+// The last match must start at least this many bytes before the end of input.
+static constexpr size_t MF_LIMIT = 12;
+// The last this-many bytes of input are always literals.
+static constexpr size_t LAST_LITERALS = 5;
+static constexpr size_t MAX_DISTANCE = 65535;
+
+static constexpr int HASH_LOG = 12;
+static constexpr size_t HASH_SIZE = 1 << HASH_LOG;
+
+static inline uint32_t
+read32(const uint8_t* p) noexcept {
+    uint32_t x;
+    memcpy(&x, p, sizeof(x));
+    return x;
+}
+
+static inline uint32_t
+hashPosition(uint32_t sequence) noexcept {
+    return (sequence * 2654435761U) >> (32 - HASH_LOG);
+}
+
+static inline uint8_t*
+writeLength(uint8_t* op, size_t length) noexcept {
+    while (length >= 255) {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = static_cast<uint8_t>(length);
+    return op;
+}
+
+size_t
+lz4CompressBound(size_t srcSize) noexcept {
+    return srcSize + srcSize / 255 + 16;
+}
+
+size_t
+lz4Compress(const void* src, size_t srcSize, void* dst, size_t dstCapacity)
+        noexcept {
+    const uint8_t* const base = static_cast<const uint8_t*>(src);
+    const uint8_t* const iend = base + srcSize;
+    uint8_t* const obase = static_cast<uint8_t*>(dst);
+    uint8_t* const oend = obase + dstCapacity;
+
+    const uint8_t* ip = base;
+    const uint8_t* anchor = base;
+    uint8_t* op = obase;
+
+    if (srcSize > LZ4_MAX_INPUT_SIZE) {
+        return 0;
+    }
+
+    if (srcSize >= MF_LIMIT + 1) {
+        const uint8_t* const mflimit = iend - MF_LIMIT;
+        const uint8_t* const matchlimit = iend - LAST_LITERALS;
+
+        // Offsets from base of the last position that hashed to each slot.
+        uint32_t table[HASH_SIZE];
+        for (size_t i = 0; i < HASH_SIZE; i++) {
+            table[i] = UINT32_MAX;
+        }
+
+        while (ip < mflimit) {
+            uint32_t h = hashPosition(read32(ip));
+            uint32_t candidate = table[h];
+            table[h] = static_cast<uint32_t>(ip - base);
+
+            if (candidate == UINT32_MAX ||
+                static_cast<size_t>(ip - base) - candidate > MAX_DISTANCE ||
+                read32(base + candidate) != read32(ip)) {
+                ip++;
+                continue;
+            }
+
+            const uint8_t* match = base + candidate;
+
+            // Extend the match backwards over pending literals.
+            while (ip > anchor && match > base && ip[-1] == match[-1]) {
+                ip--;
+                match--;
+            }
+
+            // Extend the match forwards.
+            const uint8_t* mp = ip + MIN_MATCH;
+            const uint8_t* mm = match + MIN_MATCH;
+            while (mp < matchlimit && *mp == *mm) {
+                mp++;
+                mm++;
+            }
+
+            size_t literalLength = static_cast<size_t>(ip - anchor);
+            size_t matchLength = static_cast<size_t>(mp - ip) - MIN_MATCH;
+
+            // token + literal length bytes + literals + offset + match length
+            // bytes
+            size_t needed = 1 + literalLength / 255 + 1 + literalLength + 2 +
+                            matchLength / 255 + 1;
+            if (unlikely(static_cast<size_t>(oend - op) < needed)) {
+                return 0;
+            }
+
+            uint8_t* token = op++;
+            if (literalLength >= 15) {
+                *token = 15 << 4;
+                op = writeLength(op, literalLength - 15);
+            }
+            else {
+                *token = static_cast<uint8_t>(literalLength << 4);
+            }
+            memcpy(op, anchor, literalLength);
+            op += literalLength;
+
+            uint16_t offset = static_cast<uint16_t>(ip - match);
+            *op++ = static_cast<uint8_t>(offset);
+            *op++ = static_cast<uint8_t>(offset >> 8);
+
+            if (matchLength >= 15) {
+                *token |= 15;
+                op = writeLength(op, matchLength - 15);
+            }
+            else {
+                *token |= static_cast<uint8_t>(matchLength);
+            }
+
+            ip = mp;
+            anchor = ip;
+
+            // Seed the table with a position inside the match so runs of
+            // repeated data are found again quickly.
+            if (ip - 2 >= base && ip < mflimit) {
+                table[hashPosition(read32(ip - 2))] =
+                        static_cast<uint32_t>(ip - 2 - base);
+            }
+        }
+    }
+
+    // Remaining input is emitted as a final literal-only sequence.
+    size_t literalLength = static_cast<size_t>(iend - anchor);
+    size_t needed = 1 + literalLength / 255 + 1 + literalLength;
+    if (static_cast<size_t>(oend - op) < needed) {
+        return 0;
+    }
+
+    if (literalLength >= 15) {
+        *op++ = 15 << 4;
+        op = writeLength(op, literalLength - 15);
+    }
+    else {
+        *op++ = static_cast<uint8_t>(literalLength << 4);
+    }
+    memcpy(op, anchor, literalLength);
+    op += literalLength;
+
+    return static_cast<size_t>(op - obase);
+}
+
+bool
+lz4Decompress(const void* src, size_t srcSize, void* dst, size_t dstSize)
+        noexcept {
+    const uint8_t* ip = static_cast<const uint8_t*>(src);
+    const uint8_t* const iend = ip + srcSize;
+    uint8_t* const obase = static_cast<uint8_t*>(dst);
+    uint8_t* op = obase;
+    uint8_t* const oend = obase + dstSize;
+
+    while (ip < iend) {
+        uint8_t token = *ip++;
+
+        size_t literalLength = token >> 4;
+        if (literalLength == 15) {
+            uint8_t b;
+            do {
+                if (unlikely(ip >= iend)) {
+                    return false;
+                }
+                b = *ip++;
+                literalLength += b;
+            } while (b == 255);
+        }
+
+        if (unlikely(static_cast<size_t>(iend - ip) < literalLength ||
+                     static_cast<size_t>(oend - op) < literalLength)) {
+            return false;
+        }
+        memcpy(op, ip, literalLength);
+        ip += literalLength;
+        op += literalLength;
+
+        // The last sequence has no match.
+        if (ip == iend) {
+            break;
+        }
+
+        if (unlikely(iend - ip < 2)) {
+            return false;
+        }
+        size_t offset = static_cast<size_t>(ip[0]) |
+                        (static_cast<size_t>(ip[1]) << 8);
+        ip += 2;
+        if (unlikely(offset == 0 ||
+                     offset > static_cast<size_t>(op - obase))) {
+            return false;
+        }
+
+        size_t matchLength = token & 15;
+        if (matchLength == 15) {
+            uint8_t b;
+            do {
+                if (unlikely(ip >= iend)) {
+                    return false;
+                }
+                b = *ip++;
+                matchLength += b;
+            } while (b == 255);
+        }
+        matchLength += MIN_MATCH;
+
+        if (unlikely(static_cast<size_t>(oend - op) < matchLength)) {
+            return false;
+        }
+
+        const uint8_t* match = op - offset;
+        if (offset >= matchLength) {
+            memcpy(op, match, matchLength);
+            op += matchLength;
+        }
+        else {
+            // Overlapping copy: the match repeats bytes it is producing.
+            for (size_t i = 0; i < matchLength; i++) {
+                *op++ = *match++;
+            }
+        }
+    }
+
+    return op == oend;
+}
@@ -0,0 +1,56 @@
+/********************************
+** Tsunagari Tile Engine       **
+** lz4.h                       **
+** Copyright 2020 Paul Merrill **
+********************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#ifndef SRC_PACK_LZ4_H_
+#define SRC_PACK_LZ4_H_
+
+#include "util/int.h"
+#include "util/noexcept.h"
+
+// An implementation of the LZ4 block format. Only single blocks are supported;
+// there is no frame header, checksum, or streaming. The caller is expected to
+// store the uncompressed size out-of-band, which the pack format does anyway.
+
+// The largest input the block format allows.
+static constexpr size_t LZ4_MAX_INPUT_SIZE = 0x7E000000;
+
+// The largest compressed size possible for an input of the given size.
+size_t
+lz4CompressBound(size_t srcSize) noexcept;
+
+// Returns the number of bytes written to dst, or 0 if dst was too small or
+// srcSize is larger than LZ4_MAX_INPUT_SIZE.
+size_t
+lz4Compress(const void* src, size_t srcSize, void* dst, size_t dstCapacity)
+        noexcept;
+
+// Returns false if src is malformed or does not decode to exactly dstSize
+// bytes.
+bool
+lz4Decompress(const void* src, size_t srcSize, void* dst, size_t dstSize)
+        noexcept;
+
+#endif  // SRC_PACK_LZ4_H_
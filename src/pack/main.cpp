@@ -25,50 +25,560 @@
 // **********
 
 #include "os/c.h"
+#include "os/chrono.h"
 #include "os/mutex.h"
 #include "os/os.h"
+#include "os/writable-file.h"
+#include "pack/area-compiler.h"
+#include "pack/area-format.h"
+#include "pack/atlas-baker.h"
+#include "pack/file-type.h"
+#include "pack/lz4.h"
 #include "pack/pack-reader.h"
 #include "pack/pack-writer.h"
+#include "pack/sound-format.h"
+#include "pack/sound-writer.h"
+#include "pack/texture-format.h"
+#include "pack/texture-writer.h"
 #include "pack/walker.h"
+#include "util/decimal.h"
+#include "util/function.h"
+#include "util/hashtable.h"
 #include "util/int.h"
+#include "util/jobs.h"
+#include "util/json.h"
 #include "util/noexcept.h"
+#include "util/png.h"
+#include "util/sort.h"
 #include "util/string-view.h"
 #include "util/string.h"
+#include "util/string2.h"
+#include "util/vector.h"
+#include "util/wav.h"
 
 static String exe;
 static bool verbose = false;
+static StringView orderPath;
+static bool compileAreas = false;
+static bool streamAreas = false;
+static bool decodeImages = false;
+static bool bakeAtlas = false;
+static bool decodeSounds = false;
+
+// Longer sounds are likely music, which is streamed rather than decoded.
+#define MAX_DECODED_SOUND_SECONDS 10
+static TextureCompression decodedCompression = TEXTURE_COMPRESSION_NONE;
 
 static void
 usage() noexcept {
     const char* me = exe.null();
     fprintf(stderr,
-            "usage: %s create [-v] <output-archive> [input-file]...\n"
+            "usage: %s create [-v] [-c <type>=<codec>]... "
+            "[-a <type>=<bytes>]... [--order <trace>] [--compile-areas] "
+            "[--stream-areas] [--decode-images <codec>] [--bake-atlas] "
+            "[--decode-sounds] "
+            "<output-archive> [input-file]...\n"
             "       %s list <input-archive>\n"
-            "       %s extract [-v] <input-archive>\n",
-            me, me, me);
+            "       %s extract [-v] <input-archive>\n"
+            "       %s verify [-v] <input-archive>\n"
+            "       %s diff [-v] <old-archive> <new-archive> "
+            "<patch-archive>\n"
+            "       %s bench-json <input-archive>\n"
+            "       %s bench-images <input-archive>\n"
+            "\n"
+            "  -c  Compress files of <type> with <codec>. <type> is one of\n"
+            "      text, media, unknown, or a file extension such as .tmx.\n"
+            "      <codec> is one of none, lz4. The default is text=lz4.\n"
+            "  -a  Align files of <type> in the archive to a multiple of\n"
+            "      <bytes>, a power of two. <type> is one of text, media,\n"
+            "      unknown. The default is media=4096.\n"
+            "  --order  Lay out files in the order listed in <trace>, one\n"
+            "           path per line, as recorded by the engine's\n"
+            "           \"loadtrace\" option.\n"
+            "  --compile-areas  Also add a compiled copy of each Tiled map,\n"
+            "                   which the engine loads faster than the JSON.\n"
+            "  --stream-areas  Like --compile-areas, but split the tiles of\n"
+            "                  maps larger than 128x128 into .region files,\n"
+            "                  which the engine loads around the viewport as\n"
+            "                  the player moves. They are compressed with\n"
+            "                  lz4 unless -c says otherwise.\n"
+            "  --decode-images  Also add the decoded pixels of each PNG, which\n"
+            "                   the engine uploads without decoding them.\n"
+            "                   <codec> is one of none, lz4.\n"
+            "  --bake-atlas  Also pack the tilesets and sprite sheets that Tiled\n"
+            "                maps and entity descriptors refer to into a few\n"
+            "                texture atlas pages, which the engine loads whole.\n"
+            "  --decode-sounds  Also add the decoded samples of each WAV file\n"
+            "                   up to 10 seconds long, which the engine plays\n"
+            "                   without decoding them. Ogg Vorbis files are\n"
+            "                   not decoded.\n"
+            "\n"
+            "diff writes the files of <new-archive> that are missing from or\n"
+            "different in <old-archive> to <patch-archive>. Mounting the\n"
+            "patch over the old archive with the engine's \"patches\" option\n"
+            "gives the contents of the new one.\n"
+            "\n"
+            "bench-json measures how many megabytes per second of the .json\n"
+            "files in <input-archive> the JSON parser reads with each of its\n"
+            "character scanners, with and without sharing one allocator\n"
+            "between documents, and how many of their numbers per second it\n"
+            "parses compared to the C library. data/bench-json holds a\n"
+            "fixed set of inputs for it, which can be packed with\n"
+            "\"%s create bench.world data/bench-json/*.json\".\n"
+            "\n"
+            "bench-images measures how long getting the pixels of the .png\n"
+            "files in <input-archive> takes from the PNG and from decoded\n"
+            "copies of it, both uncompressed and LZ4-compressed.\n"
+            "\n"
+            "verify checks every file in <input-archive> against its\n"
+            "checksum and that compressed files decompress.\n",
+            me, me, me, me, me, me, me, me);
+}
+
+// Compression used for each FileType, indexed by FileType.
+static BlobCompressionType typeCompressions[] = {
+        BLOB_COMPRESSION_LZ4,   // FT_TEXT
+        BLOB_COMPRESSION_NONE,  // FT_UNKNOWN
+        BLOB_COMPRESSION_NONE,  // FT_MEDIA
+};
+
+struct ExtensionCompression {
+    StringView extension;
+    BlobCompressionType compressionType;
+};
+
+// Overrides typeCompressions.
+static Vector<ExtensionCompression> extensionCompressions;
+
+// Alignment used for each FileType, indexed by FileType.
+static uint32_t typeAlignments[] = {
+        1,     // FT_TEXT
+        1,     // FT_UNKNOWN
+        4096,  // FT_MEDIA
+};
+
+static bool
+parseFileType(StringView name, FileType& type) noexcept {
+    if (name == "text") {
+        type = FT_TEXT;
+    }
+    else if (name == "media") {
+        type = FT_MEDIA;
+    }
+    else if (name == "unknown") {
+        type = FT_UNKNOWN;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+static bool
+parseAlignment(StringView rule) noexcept {
+    StringPosition eq = rule.find('=');
+    if (eq == SV_NOT_FOUND) {
+        return false;
+    }
+
+    FileType type;
+    unsigned alignment;
+    if (!parseFileType(rule.substr(0, eq), type) ||
+        !parseUInt(alignment, rule.substr(eq + 1))) {
+        return false;
+    }
+
+    // Power of two, at most 1 MiB.
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0 ||
+        alignment > 1024 * 1024) {
+        return false;
+    }
+
+    typeAlignments[type] = alignment;
+    return true;
+}
+
+static bool
+parseCompression(StringView rule) noexcept {
+    StringPosition eq = rule.find('=');
+    if (eq == SV_NOT_FOUND) {
+        return false;
+    }
+
+    StringView type = rule.substr(0, eq);
+    StringView codec = rule.substr(eq + 1);
+
+    BlobCompressionType compressionType;
+    if (codec == "none") {
+        compressionType = BLOB_COMPRESSION_NONE;
+    }
+    else if (codec == "lz4") {
+        compressionType = BLOB_COMPRESSION_LZ4;
+    }
+    else {
+        return false;
+    }
+
+    FileType fileType;
+    if (parseFileType(type, fileType)) {
+        typeCompressions[fileType] = compressionType;
+    }
+    else if (type.size > 1 && type.data[0] == '.') {
+        extensionCompressions.push_back({type, compressionType});
+    }
+    else {
+        return false;
+    }
+
+    return true;
 }
 
+static BlobCompressionType
+chooseCompression(StringView path) noexcept {
+    StringPosition dot = path.rfind('.');
+    if (dot != SV_NOT_FOUND) {
+        StringView extension = path.substr(dot);
+        for (ExtensionCompression& ec : extensionCompressions) {
+            if (ec.extension == extension) {
+                return ec.compressionType;
+            }
+        }
+    }
+    return typeCompressions[determineFileType(path)];
+}
+
+static StringView
+compressionName(BlobCompressionType compressionType) noexcept {
+    switch (compressionType) {
+    case BLOB_COMPRESSION_NONE:
+        return "none";
+    case BLOB_COMPRESSION_LZ4:
+        return "lz4";
+    default:
+        return "unknown";
+    }
+}
+
+// Compressed blobs and blobs generated by pack-tool are kept in memory until
+// the archive is written, up to this many bytes in total. Past that, files are
+// compressed a second time while being written instead, and generated blobs
+// are spilled to temporary files next to the archive.
+static constexpr size_t KEPT_COMPRESSED_BUDGET = 64 * 1024 * 1024;
+
 struct CreateArchiveContext {
     PackWriter* pack;
     Mutex packMutex;
+    size_t keptCompressed = 0;  // Guarded by packMutex.
+    Vector<String> generated;  // Guarded by packMutex.
+    String spillPrefix;
+    Vector<String> spilled;  // Guarded by packMutex.
+    Vector<String> atlasImages;  // Guarded by packMutex.
+    size_t undecodedSounds = 0;  // Guarded by packMutex.
 };
 
+static bool
+hasExtension(StringView path, StringView extension) noexcept {
+    StringPosition dot = path.rfind('.');
+    return dot != SV_NOT_FOUND && path.substr(dot) == extension;
+}
+
+static void
+reportGenerateError(StringView path, StringView error) noexcept {
+    fprintf(stderr,
+            "%s",
+            (String() << exe << ": " << path << ": " << error << "\n").null());
+}
+
+// Add a blob made by pack-tool from another file. It is compressed like a file
+// with the same extension would be.
+static void
+addGeneratedBlob(CreateArchiveContext& ctx,
+                 StringView path,
+                 String& data) noexcept {
+    size_t size = data.size;
+    String lz4;
+
+    if (chooseCompression(path) == BLOB_COMPRESSION_LZ4 && size > 0 &&
+        size <= LZ4_MAX_INPUT_SIZE) {
+        lz4.resize(lz4CompressBound(size));
+        size_t lz4Size = lz4Compress(data.data, size, lz4.data, lz4.size);
+        if (lz4Size != 0 && lz4Size < size) {
+            lz4.resize(lz4Size);
+        }
+        else {
+            lz4 = String();
+        }
+    }
+    bool compressed = lz4.size != 0;
+
+    if (verbose) {
+        String message;
+        message << "Generated " << path << ": " << size << " bytes";
+        if (compressed) {
+            message << " (" << lz4.size << " compressed)";
+        }
+        message << "\n";
+        printf("%s", message.null());
+    }
+
+    String& kept = compressed ? lz4 : data;
+
+    // Past the budget, the uncompressed data is written to a file and added
+    // like a file would be.
+    String spillPath;
+    {
+        LockGuard guard(ctx.packMutex);
+        if (ctx.keptCompressed + kept.size <= KEPT_COMPRESSED_BUDGET ||
+            size > UINT32_MAX) {
+            ctx.keptCompressed += kept.size;
+        }
+        else {
+            spillPath << ctx.spillPrefix << ctx.spilled.size;
+            ctx.spilled.push_back(spillPath);
+        }
+    }
+
+    if (spillPath.size &&
+        !writeFile(spillPath, static_cast<uint32_t>(size), data.data)) {
+        reportGenerateError(path,
+                            String() << "could not write " << spillPath
+                                     << ", keeping it in memory");
+        spillPath = String();
+    }
+
+    LockGuard guard(ctx.packMutex);
+
+    if (spillPath.size && compressed) {
+        packWriterAddCompressedFileBlob(ctx.pack, path, spillPath, size,
+                                        lz4.size, BLOB_COMPRESSION_LZ4);
+        return;
+    }
+    if (spillPath.size) {
+        packWriterAddFileBlob(ctx.pack, path, spillPath, size);
+        return;
+    }
+
+    // The writer keeps a pointer to the data, which stays put when the
+    // vector grows.
+    ctx.generated.push_back(static_cast<String&&>(kept));
+    String& blob = ctx.generated[ctx.generated.size - 1];
+    if (compressed) {
+        packWriterAddCompressedBlob(ctx.pack, path, size, blob.size,
+                                    BLOB_COMPRESSION_LZ4, blob.data);
+    }
+    else {
+        packWriterAddBlob(ctx.pack, path, blob.size, blob.data);
+    }
+}
+
+// Add the compiled form of the file at path next to it if it is a Tiled map.
+// text is its contents, if they have been read already.
+static void
+addCompiledArea(CreateArchiveContext& ctx,
+                StringView path,
+                StringView source,
+                String& text) noexcept {
+    if (!hasExtension(path, ".json")) {
+        return;
+    }
+    if (text.size == 0 && !readFile(source, text)) {
+        return;
+    }
+
+    String compiled;
+    Vector<AreaRegion> regions;
+    String error;
+    AreaCompileResult result =
+            compileArea(path,
+                        text,
+                        streamAreas ? AREA_BIN_REGION_SIZE : 0,
+                        compiled,
+                        regions,
+                        error);
+
+    if (result == AREA_NOT_A_MAP) {
+        return;
+    }
+    if (result == AREA_INVALID) {
+        reportGenerateError(path, String() << "not compiled: " << error);
+        return;
+    }
+
+    addGeneratedBlob(ctx, String() << path << AREA_BIN_EXTENSION, compiled);
+
+    for (AreaRegion& region : regions) {
+        addGeneratedBlob(ctx,
+                         areaBinRegionPath(path, region.x, region.y),
+                         region.data);
+    }
+}
+
+// Add the decoded pixels of the file at path next to it if it is a PNG.
+static void
+addDecodedImage(CreateArchiveContext& ctx,
+                StringView path,
+                StringView source,
+                String& data) noexcept {
+    if (!hasExtension(path, ".png")) {
+        return;
+    }
+    if (data.size == 0 && !readFile(source, data)) {
+        return;
+    }
+
+    uint32_t width, height;
+    Vector<uint8_t> rgba;
+    if (!pngDecode(data, width, height, rgba)) {
+        reportGenerateError(path, "not decoded: invalid PNG");
+        return;
+    }
+
+    String texture;
+    makeTexture(width, height, rgba.data, decodedCompression, texture);
+
+    addGeneratedBlob(ctx, String() << path << TEXTURE_EXTENSION, texture);
+}
+
+// Add the decoded samples of the file at path next to it if it is a short
+// WAV file. There is no Vorbis decoder in the tree, so Ogg Vorbis sounds are
+// only counted, to say that they were left to be decoded by the engine.
+static void
+addDecodedSound(CreateArchiveContext& ctx,
+                StringView path,
+                StringView source,
+                String& data) noexcept {
+    if (hasExtension(path, ".oga") || hasExtension(path, ".ogg")) {
+        LockGuard guard(ctx.packMutex);
+        ctx.undecodedSounds += 1;
+        return;
+    }
+    if (!hasExtension(path, ".wav")) {
+        return;
+    }
+    if (data.size == 0 && !readFile(source, data)) {
+        return;
+    }
+
+    uint32_t rate, channels;
+    Vector<int16_t> samples;
+    if (!wavDecode(data, rate, channels, samples)) {
+        reportGenerateError(path, "not decoded: unsupported WAV file");
+        return;
+    }
+
+    if (samples.size / channels > rate * MAX_DECODED_SOUND_SECONDS) {
+        return;
+    }
+
+    String sound;
+    makeDecodedSound(rate, channels, samples.data, samples.size, sound);
+
+    addGeneratedBlob(ctx, String() << path << SOUND_EXTENSION, sound);
+}
+
+// Remember the images the file at path refers to if it is a Tiled map or an
+// entity descriptor, to bake into the atlas once every file is added.
+static void
+findAtlasImages(CreateArchiveContext& ctx,
+                StringView path,
+                StringView source,
+                String& text) noexcept {
+    if (!hasExtension(path, ".json")) {
+        return;
+    }
+    if (text.size == 0 && !readFile(source, text)) {
+        return;
+    }
+
+    Vector<String> images;
+    atlasFindImages(path, text, images);
+
+    LockGuard guard(ctx.packMutex);
+    for (String& image : images) {
+        ctx.atlasImages.push_back(static_cast<String&&>(image));
+    }
+}
+
+static void
+addAtlas(CreateArchiveContext& ctx) noexcept {
+    // Bake each image once, in the same order every time.
+    Vector<String>& images = ctx.atlasImages;
+    String* data = images.data;
+#define LESS(i, j) data[i] < data[j]
+#define SWAP(i, j) swap_(data[i], data[j])
+    QSORT(images.size, LESS, SWAP);
+#undef LESS
+#undef SWAP
+
+    Vector<String> unique;
+    for (String& image : images) {
+        if (unique.size == 0 || unique[unique.size - 1] != image) {
+            unique.push_back(static_cast<String&&>(image));
+        }
+    }
+
+    // Each page goes through addGeneratedBlob as it is drawn, so pages past
+    // the kept-compressed budget are spilled rather than all held at once.
+    Vector<String> skipped;
+    atlasBake(unique,
+              TEXTURE_COMPRESSION_LZ4,
+              [&](StringView path, String& data) noexcept {
+                  addGeneratedBlob(ctx, path, data);
+              },
+              skipped);
+
+    if (verbose) {
+        for (String& message : skipped) {
+            printf("%s",
+                   (String() << "Left out of atlas " << message << "\n")
+                           .null());
+        }
+    }
+}
+
 static void
 addFile(CreateArchiveContext& ctx, StringView path) noexcept {
-    String data;
-    bool ok = readFile(path, data);
+    // Only the size of most files is needed now. Their contents are copied
+    // straight into the archive when it is written.
+    Filesize size = getFileSize(path);
 
-    if (!ok) {
+    if (size == FS_ERROR) {
         if (verbose) {
             printf("%s", (String() << "Skipped " << path << ": file not found\n\0").null());
         }
         return;
     }
 
+    // Files to be compressed are compressed now to learn their size. Keep
+    // the original if compression doesn't make it smaller.
+    String data;
+    char* compressed = 0;
+    size_t compressedSize = 0;
+
+    if (chooseCompression(path) == BLOB_COMPRESSION_LZ4 && size > 0 &&
+        size <= LZ4_MAX_INPUT_SIZE && readFile(path, data)) {
+        size_t bound = lz4CompressBound(data.size);
+        compressed = static_cast<char*>(malloc(bound));
+        compressedSize = lz4Compress(data.data, data.size, compressed, bound);
+        if (compressedSize == 0 || compressedSize >= data.size) {
+            free(compressed);
+            compressed = 0;
+        }
+        size = data.size;
+    }
+
     if (verbose) {
-        printf("%s", (String() << "Added " << path << ": " << data.size << " bytes\n").null());
+        String message;
+        message << "Added " << path << ": " << size << " bytes";
+        if (compressed) {
+            message << " (" << compressedSize << " compressed)";
+        }
+        message << "\n";
+        printf("%s", message.null());
     }
 
+    StringView source = path;
+
     // Write the file path to the pack file with '/' instead of '\\' on Windows.
     String standardizedPath;
 
@@ -84,21 +594,78 @@ addFile(CreateArchiveContext& ctx, StringView path) noexcept {
         path = standardizedPath;
     }
 
-    LockGuard guard(ctx.packMutex);
-    packWriterAddBlob(ctx.pack, path, static_cast<uint32_t>(data.size),
-                      data.data);
+    {
+        LockGuard guard(ctx.packMutex);
+        if (!compressed) {
+            packWriterAddFileBlob(ctx.pack, path, source, size);
+        }
+        else if (ctx.keptCompressed + compressedSize <=
+                 KEPT_COMPRESSED_BUDGET) {
+            ctx.keptCompressed += compressedSize;
+            packWriterAddCompressedBlob(ctx.pack, path, size, compressedSize,
+                                        BLOB_COMPRESSION_LZ4, compressed);
+        }
+        else {
+            packWriterAddCompressedFileBlob(ctx.pack, path, source, size,
+                                            compressedSize,
+                                            BLOB_COMPRESSION_LZ4);
+            free(compressed);
+        }
+    }
 
-    data.reset();  // Don't delete data pointer.
+    if (compileAreas) {
+        addCompiledArea(ctx, path, source, data);
+    }
+    if (decodeImages) {
+        addDecodedImage(ctx, path, source, data);
+    }
+    if (decodeSounds) {
+        addDecodedSound(ctx, path, source, data);
+    }
+    if (bakeAtlas) {
+        findAtlasImages(ctx, path, source, data);
+    }
 }
 
 static bool
 createArchive(StringView archivePath, Vector<StringView> paths) noexcept {
     CreateArchiveContext ctx;
     ctx.pack = makePackWriter();
+    ctx.spillPrefix << archivePath << ".spill";
+
+    packWriterSetAlignment(ctx.pack, FT_TEXT, typeAlignments[FT_TEXT]);
+    packWriterSetAlignment(ctx.pack, FT_UNKNOWN, typeAlignments[FT_UNKNOWN]);
+    packWriterSetAlignment(ctx.pack, FT_MEDIA, typeAlignments[FT_MEDIA]);
+
+    String trace;
+    if (orderPath.size) {
+        if (!readFile(orderPath, trace)) {
+            fprintf(stderr,
+                    "%s",
+                    (String() << exe << ": " << orderPath << ": not found\n")
+                            .null());
+            destroyPackWriter(ctx.pack);
+            return false;
+        }
+        packWriterSetOrder(ctx.pack, trace);
+    }
 
     walk(static_cast<Vector<StringView>&&>(paths),
          [&](StringView path) noexcept { addFile(ctx, path); });
 
+    if (bakeAtlas) {
+        addAtlas(ctx);
+    }
+
+    if (ctx.undecodedSounds) {
+        fprintf(stderr,
+                "%s",
+                (String() << exe << ": --decode-sounds: " << ctx.undecodedSounds
+                          << " Ogg Vorbis files were not decoded, only WAV "
+                             "files are\n")
+                        .null());
+    }
+
     if (verbose) {
         printf("%s", (String() << "Writing to " << archivePath << "\n").null());
     }
@@ -106,9 +673,50 @@ createArchive(StringView archivePath, Vector<StringView> paths) noexcept {
     bool ok = packWriterWriteToFile(ctx.pack, archivePath);
 
     destroyPackWriter(ctx.pack);
+
+    for (String& path : ctx.spilled) {
+        removeFile(path);
+    }
+
     return ok;
 }
 
+struct BlobLocation {
+    const char* data;
+    BlobIndex index;
+};
+
+static void
+countDuplicates(PackReader* pack,
+                BlobIndex& duplicates,
+                BlobSize& bytesSaved) noexcept {
+    Vector<BlobLocation> locations;
+    locations.reserve(pack->size());
+
+    // An empty blob may start where the next blob does without sharing any
+    // data with it.
+    for (BlobIndex i = 0; i < pack->size(); i++) {
+        if (pack->getBlobCompressedSize(i) > 0) {
+            locations.push_back(
+                    {static_cast<const char*>(pack->getBlobData(i)), i});
+        }
+    }
+
+    BlobLocation* data = locations.data;
+#define LESS(i, j) data[i].data < data[j].data
+#define SWAP(i, j) swap_(data[i], data[j])
+    QSORT(locations.size, LESS, SWAP);
+#undef LESS
+#undef SWAP
+
+    for (size_t i = 1; i < locations.size; i++) {
+        if (locations[i].data == locations[i - 1].data) {
+            duplicates += 1;
+            bytesSaved += pack->getBlobCompressedSize(locations[i].index);
+        }
+    }
+}
+
 static bool
 listArchive(StringView archivePath) noexcept {
     PackReader* pack = PackReader::fromFile(archivePath);
@@ -118,7 +726,8 @@ listArchive(StringView archivePath) noexcept {
 
         for (BlobIndex i = 0; i < pack->size(); i++) {
             StringView blobPath = pack->getBlobPath(i);
-            uint64_t blobSize = pack->getBlobSize(i);
+            BlobSize blobSize = pack->getBlobSize(i);
+            BlobCompressionType compressionType = pack->getBlobCompression(i);
 
             // Print file paths with '\\' Windows.
             String standardizedPath;
@@ -135,7 +744,21 @@ listArchive(StringView archivePath) noexcept {
                 blobPath = standardizedPath;
             }
 
-            output << blobPath << ": " << blobSize << " bytes\n";
+            output << blobPath << ": " << blobSize << " bytes";
+            if (compressionType != BLOB_COMPRESSION_NONE) {
+                output << " (" << pack->getBlobCompressedSize(i) << " "
+                       << compressionName(compressionType) << ")";
+            }
+            output << "\n";
+        }
+
+        // Deduplicated blobs share their data with an earlier blob.
+        BlobIndex duplicates = 0;
+        BlobSize bytesSaved = 0;
+        countDuplicates(pack, duplicates, bytesSaved);
+        if (duplicates) {
+            output << duplicates << " duplicate files, " << bytesSaved
+                   << " bytes saved\n";
         }
 
         printf("%s", output.null());
@@ -166,74 +789,718 @@ getParentPath(StringView path, StringView& parent) noexcept {
     }
 }
 
+// Directories already made by extract, which runs on several threads.
+static Mutex createdDirsMutex;
+static Hashmap<String, bool> createdDirs;
+
 static void
 createDirs(StringView path) noexcept {
     StringView parentPath;
-    if (getParentPath(path, parentPath)) {
-        // Make sure parentPath's parent exists.
-        createDirs(parentPath);
+    if (!getParentPath(path, parentPath)) {
+        return;
+    }
 
-        makeDirectory(parentPath);
+    {
+        LockGuard guard(createdDirsMutex);
+        if (createdDirs.contains(parentPath)) {
+            return;
+        }
     }
-}
 
-static void
-putFile(StringView path, uint32_t size, void* data) noexcept {
-    createDirs(path);
+    // Make sure parentPath's parent exists. Two threads may both get here
+    // for the same directory, which is harmless.
+    createDirs(parentPath);
 
-    // TODO: Propagate error up.
-    writeFile(path, size, data);
+    makeDirectory(parentPath);
+
+    LockGuard guard(createdDirsMutex);
+    createdDirs[String(parentPath)] = true;
 }
 
 static bool
-extractArchive(StringView archivePath) noexcept {
-    PackReader* pack = PackReader::fromFile(archivePath);
+putFile(StringView path, BlobSize size, void* data) noexcept {
+    createDirs(path);
 
-    if (pack) {
-        Vector<void*> blobDatas;
-        for (BlobIndex i = 0; i < pack->size(); i++) {
-            blobDatas.push_back(pack->getBlobData(i));
-        }
+    WritableFile file;
+    if (!makeWritableFile(path, size, file)) {
+        return false;
+    }
 
-        for (BlobIndex i = 0; i < pack->size(); i++) {
-            StringView blobPath = pack->getBlobPath(i);
-            uint32_t blobSize = pack->getBlobSize(i);
-            void* blobData = blobDatas[i];
+    bool ok = writableFileWrite(file, 0, data, static_cast<size_t>(size));
 
-            // Change file paths to use '\\' on Windows.
-            String standardizedPath;
+    destroyWritableFile(file);
+    return ok;
+}
 
-            if (dirSeparator != '/') {
-                standardizedPath = blobPath;
+static void
+reportBlobError(StringView blobPath, StringView error) noexcept {
+    fprintf(stderr,
+            "%s",
+            (String() << exe << ": " << blobPath << ": " << error << "\n")
+                    .null());
+}
 
-                for (size_t i = 0; i < blobPath.size; i++) {
-                    if (standardizedPath[i] == '/') {
-                        standardizedPath[i] = dirSeparator;
-                    }
-                }
+static bool
+extractBlob(PackReader* pack, BlobIndex i) noexcept {
+    StringView blobPath = pack->getBlobPath(i);
+    BlobSize blobSize = pack->getBlobSize(i);
+    void* blobData = pack->getBlobData(i);
 
-                blobPath = standardizedPath;
-            }
+    // Compressed blobs are inflated into a temporary buffer. Others are
+    // written straight from the mapped archive.
+    char* inflated = 0;
+    if (pack->getBlobCompression(i) != BLOB_COMPRESSION_NONE) {
+        inflated = static_cast<char*>(malloc(blobSize));
+        if (!pack->readBlob(i, inflated)) {
+            reportBlobError(blobPath, "corrupt blob");
+            free(inflated);
+            return false;
+        }
+        blobData = inflated;
+    }
 
-            if (verbose) {
-                printf("%s", (String() << "Extracting " << blobPath << ": " << blobSize << " bytes\n").null());
-            }
+    // Change file paths to use '\\' on Windows.
+    String standardizedPath;
+
+    if (dirSeparator != '/') {
+        standardizedPath = blobPath;
 
-            putFile(blobPath, blobSize, blobData);
+        for (size_t i = 0; i < blobPath.size; i++) {
+            if (standardizedPath[i] == '/') {
+                standardizedPath[i] = dirSeparator;
+            }
         }
 
-        delete pack;
-        return true;
+        blobPath = standardizedPath;
     }
-    else {
-        fprintf(stderr,
-                "%s: %s: not found\n",
-                exe.null(),
-                String(archivePath).null());
 
-        delete pack;
+    if (verbose) {
+        printf("%s", (String() << "Extracting " << blobPath << ": " << blobSize << " bytes\n").null());
+    }
+
+    bool ok = putFile(blobPath, blobSize, blobData);
+    if (!ok) {
+        reportBlobError(blobPath, "could not write file");
+    }
+
+    free(inflated);
+    return ok;
+}
+
+// Call op on every blob in the pack in parallel, continuing past failures.
+// Returns the number of blobs op failed on.
+static BlobIndex
+forEachBlob(PackReader* pack,
+            Function<bool(PackReader*, BlobIndex) noexcept> op) noexcept {
+    Mutex mutex;
+    BlobIndex failures = 0;
+
+    JobsForEach(pack->size(), [&](size_t i) noexcept {
+        if (!op(pack, static_cast<BlobIndex>(i))) {
+            LockGuard guard(mutex);
+            failures += 1;
+        }
+        return true;
+    });
+
+    return failures;
+}
+
+static bool
+extractArchive(StringView archivePath) noexcept {
+    PackReader* pack = PackReader::fromFile(archivePath);
+
+    if (pack) {
+        bool ok = forEachBlob(pack, extractBlob) == 0;
+
+        delete pack;
+        return ok;
+    }
+    else {
+        fprintf(stderr,
+                "%s: %s: not found\n",
+                exe.null(),
+                String(archivePath).null());
+
+        delete pack;
+        return false;
+    }
+}
+
+// Check a blob's stored bytes against its checksum, then check that it
+// decompresses.
+static bool
+verifyBlob(PackReader* pack, BlobIndex i) noexcept {
+    StringView blobPath = pack->getBlobPath(i);
+
+    uint32_t expected;
+    if (pack->getBlobChecksum(i, expected)) {
+        size_t storedSize = static_cast<size_t>(pack->getBlobCompressedSize(i));
+        if (packChecksum(pack->getBlobData(i), storedSize) != expected) {
+            reportBlobError(blobPath, "checksum mismatch");
+            return false;
+        }
+    }
+
+    if (pack->getBlobCompression(i) != BLOB_COMPRESSION_NONE) {
+        BlobSize blobSize = pack->getBlobSize(i);
+        char* inflated = static_cast<char*>(malloc(blobSize));
+        bool ok = pack->readBlob(i, inflated);
+        free(inflated);
+        if (!ok) {
+            reportBlobError(blobPath, "corrupt blob");
+            return false;
+        }
+    }
+
+    if (verbose) {
+        printf("%s", (String() << "Verified " << blobPath << "\n").null());
+    }
+
+    return true;
+}
+
+static bool
+verifyArchive(StringView archivePath) noexcept {
+    PackReader* pack = PackReader::fromFile(archivePath);
+
+    if (!pack) {
+        fprintf(stderr,
+                "%s: %s: not found\n",
+                exe.null(),
+                String(archivePath).null());
+        return false;
+    }
+
+    uint32_t checksum;
+    if (pack->size() > 0 && !pack->getBlobChecksum(0, checksum)) {
+        fprintf(stderr,
+                "%s",
+                (String() << exe << ": " << archivePath
+                          << ": archive has no checksums, only checking that "
+                             "compressed files decompress\n")
+                        .null());
+    }
+
+    BlobIndex failures = forEachBlob(pack, verifyBlob);
+
+    if (failures) {
+        printf("%s",
+               (String() << failures << " of " << pack->size()
+                         << " files corrupt\n")
+                       .null());
+    }
+    else {
+        printf("%s", (String() << pack->size() << " files OK\n").null());
+    }
+
+    delete pack;
+    return failures == 0;
+}
+
+// Whether two blobs have the same uncompressed contents.
+static bool
+sameBlob(PackReader* a, BlobIndex ai, PackReader* b, BlobIndex bi) noexcept {
+    BlobSize size = a->getBlobSize(ai);
+    if (size != b->getBlobSize(bi)) {
+        return false;
+    }
+
+    // Stored the same way, so the stored bytes can be compared directly.
+    if (a->getBlobCompression(ai) == b->getBlobCompression(bi) &&
+        a->getBlobCompressedSize(ai) == b->getBlobCompressedSize(bi)) {
+        return memcmp(a->getBlobData(ai), b->getBlobData(bi),
+                      static_cast<size_t>(a->getBlobCompressedSize(ai))) == 0;
+    }
+
+    char* inflatedA = static_cast<char*>(malloc(static_cast<size_t>(size)));
+    char* inflatedB = static_cast<char*>(malloc(static_cast<size_t>(size)));
+    bool same = a->readBlob(ai, inflatedA) && b->readBlob(bi, inflatedB) &&
+                memcmp(inflatedA, inflatedB, static_cast<size_t>(size)) == 0;
+    free(inflatedA);
+    free(inflatedB);
+    return same;
+}
+
+static bool
+diffArchives(StringView oldPath,
+             StringView newPath,
+             StringView patchPath) noexcept {
+    PackReader* oldPack = PackReader::fromFile(oldPath);
+    if (!oldPack) {
+        fprintf(stderr,
+                "%s",
+                (String() << exe << ": " << oldPath << ": not found\n")
+                        .null());
         return false;
     }
+
+    PackReader* newPack = PackReader::fromFile(newPath);
+    if (!newPack) {
+        fprintf(stderr,
+                "%s",
+                (String() << exe << ": " << newPath << ": not found\n")
+                        .null());
+        delete oldPack;
+        return false;
+    }
+
+    PackWriter* patch = makePackWriter();
+
+    packWriterSetAlignment(patch, FT_TEXT, typeAlignments[FT_TEXT]);
+    packWriterSetAlignment(patch, FT_UNKNOWN, typeAlignments[FT_UNKNOWN]);
+    packWriterSetAlignment(patch, FT_MEDIA, typeAlignments[FT_MEDIA]);
+
+    BlobIndex changed = 0;
+
+    // Blob data is added straight from the new archive's mapping, compressed
+    // or not, so nothing is recompressed.
+    for (BlobIndex i = 0; i < newPack->size(); i++) {
+        StringView path = newPack->getBlobPath(i);
+        BlobIndex old = oldPack->findIndex(path);
+
+        if (old != BLOB_NOT_FOUND && sameBlob(oldPack, old, newPack, i)) {
+            continue;
+        }
+
+        if (verbose) {
+            printf("%s",
+                   (String() << (old == BLOB_NOT_FOUND ? "Added " : "Changed ")
+                             << path << "\n")
+                           .null());
+        }
+
+        BlobCompressionType compressionType = newPack->getBlobCompression(i);
+        if (compressionType == BLOB_COMPRESSION_NONE) {
+            packWriterAddBlob(patch, path, newPack->getBlobSize(i),
+                              newPack->getBlobData(i));
+        }
+        else {
+            packWriterAddCompressedBlob(patch, path, newPack->getBlobSize(i),
+                                        newPack->getBlobCompressedSize(i),
+                                        compressionType,
+                                        newPack->getBlobData(i));
+        }
+        changed++;
+    }
+
+    // Patches can add and replace files but not remove them.
+    BlobIndex removed = 0;
+    for (BlobIndex i = 0; i < oldPack->size(); i++) {
+        if (newPack->findIndex(oldPack->getBlobPath(i)) == BLOB_NOT_FOUND) {
+            removed++;
+        }
+    }
+    if (removed) {
+        fprintf(stderr,
+                "%s",
+                (String() << exe << ": warning: " << removed
+                          << " files removed from " << oldPath
+                          << " remain visible through the patch\n")
+                        .null());
+    }
+
+    if (verbose) {
+        printf("%s",
+               (String() << "Writing " << changed << " files to " << patchPath
+                         << "\n")
+                       .null());
+    }
+
+    bool ok = packWriterWriteToFile(patch, patchPath);
+
+    destroyPackWriter(patch);
+    delete newPack;
+    delete oldPack;
+    return ok;
+}
+
+// Returns megabytes per second parsed with scanner, or 0 if a file fails to
+// parse. If shared is set, every document is built in it, and it is reset
+// after each one.
+static uint64_t
+benchJsonRun(Vector<String>& texts,
+             size_t textBytes,
+             size_t passes,
+             JsonScanner scanner,
+             JsonAllocator* shared) noexcept {
+    Nanoseconds start = chronoNow();
+
+    for (size_t pass = 0; pass < passes; pass++) {
+        for (String& text : texts) {
+            bool ok;
+            if (shared) {
+                JsonDocument doc(String(text), scanner, *shared);
+                ok = doc.ok;
+            }
+            else {
+                JsonDocument doc(String(text), scanner);
+                ok = doc.ok;
+            }
+            if (!ok) {
+                return 0;
+            }
+            if (shared) {
+                shared->reset();
+            }
+        }
+    }
+
+    Nanoseconds elapsed = chronoNow() - start;
+    if (elapsed <= 0) {
+        elapsed = 1;
+    }
+
+    uint64_t bytes = static_cast<uint64_t>(textBytes) * passes;
+    return bytes * 1000 / static_cast<uint64_t>(elapsed);
+}
+
+// Compares giving each document its own memory to sharing one allocator
+// between them.
+static void
+benchJsonAllocators(Vector<String>& texts,
+                    size_t textBytes,
+                    size_t passes) noexcept {
+    JsonScanner scanner = jsonBestScanner();
+
+    // Count the blocks each document allocates on its own.
+    size_t ownMallocs = 0;
+    size_t largest = 0;
+    for (String& text : texts) {
+        JsonAllocator allocator;
+        {
+            JsonDocument doc(String(text), scanner, allocator);
+        }
+        ownMallocs += allocator.stats.mallocs;
+        if (largest < allocator.stats.peak) {
+            largest = allocator.stats.peak;
+        }
+    }
+
+    uint64_t ownMbps = benchJsonRun(texts, textBytes, passes, scanner, 0);
+
+    JsonAllocator shared;
+    uint64_t sharedMbps = benchJsonRun(texts, textBytes, passes, scanner,
+                                       &shared);
+    size_t sharedMallocs = (shared.stats.mallocs + passes - 1) / passes;
+
+    String out;
+    out << "largest document uses " << largest << " bytes\n"
+        << "allocator  MB/s  mallocs per pass\n"
+        << "own  " << ownMbps << "  " << ownMallocs << "\n"
+        << "shared  " << sharedMbps << "  " << sharedMallocs << "\n";
+    printf("%s", out.null());
+}
+
+// Written to so number parsing is not optimized away.
+static volatile double numberSink;
+
+// Times parseDecimal against the C library's strtod on every number in
+// texts, and checks that they agree.
+static void
+benchJsonNumbers(Vector<String>& texts) noexcept {
+    // A number starts with '-' or a digit just after a delimiter. This also
+    // picks up some digits inside strings, which are numbers all the same.
+    Vector<const char*> numbers;
+    for (String& text : texts) {
+        const char* s = text.null();
+        char prev = ' ';
+        for (; *s; prev = *s++) {
+            bool start = *s == '-' || (*s >= '0' && *s <= '9');
+            bool delim = prev == ' ' || prev == '\n' || prev == '\t' ||
+                         prev == '\r' || prev == ',' || prev == ':' ||
+                         prev == '[';
+            if (start && delim) {
+                numbers.push_back(s);
+            }
+        }
+    }
+
+    if (numbers.size == 0) {
+        return;
+    }
+
+    // About ten million numbers per parser.
+    size_t passes = 10000000 / numbers.size + 1;
+    uint64_t count = static_cast<uint64_t>(passes) * numbers.size;
+
+    double sum = 0;
+    char* end;
+
+    Nanoseconds start = chronoNow();
+    for (size_t pass = 0; pass < passes; pass++) {
+        for (const char* number : numbers) {
+            sum += parseDecimal(number, &end);
+        }
+    }
+    Nanoseconds decimalTime = chronoNow() - start;
+
+    start = chronoNow();
+    for (size_t pass = 0; pass < passes; pass++) {
+        for (const char* number : numbers) {
+            sum += strtod(number, &end);
+        }
+    }
+    Nanoseconds strtodTime = chronoNow() - start;
+
+    numberSink = sum;
+
+    size_t differ = 0;
+    for (const char* number : numbers) {
+        double a = parseDecimal(number, &end);
+        double b = strtod(number, &end);
+        if (memcmp(&a, &b, sizeof(a)) != 0) {
+            differ++;
+        }
+    }
+
+    if (decimalTime <= 0) {
+        decimalTime = 1;
+    }
+    if (strtodTime <= 0) {
+        strtodTime = 1;
+    }
+
+    String out;
+    out << numbers.size << " numbers, " << differ << " differ from strtod"
+        << "\n"
+        << "parser  numbers/s\n"
+        << "parseDecimal  "
+        << count * 1000000000 / static_cast<uint64_t>(decimalTime) << "\n"
+        << "strtod  "
+        << count * 1000000000 / static_cast<uint64_t>(strtodTime) << "\n";
+    printf("%s", out.null());
+}
+
+static bool
+benchJsonArchive(StringView archivePath) noexcept {
+    PackReader* pack = PackReader::fromFile(archivePath);
+
+    if (!pack) {
+        fprintf(stderr,
+                "%s",
+                (String() << exe << ": " << archivePath << ": not found\n")
+                        .null());
+        return false;
+    }
+
+    Vector<String> texts;
+    size_t textBytes = 0;
+
+    for (BlobIndex i = 0; i < pack->size(); i++) {
+        StringView path = pack->getBlobPath(i);
+        if (path.size < 5 || path.substr(path.size - 5) != ".json") {
+            continue;
+        }
+
+        String text;
+        text.resize(static_cast<size_t>(pack->getBlobSize(i)));
+        if (!pack->readBlob(i, text.data)) {
+            reportBlobError(path, "corrupt blob");
+            delete pack;
+            return false;
+        }
+
+        textBytes += text.size;
+        texts.push_back(static_cast<String&&>(text));
+    }
+
+    delete pack;
+
+    if (textBytes == 0) {
+        fprintf(stderr,
+                "%s",
+                (String() << exe << ": " << archivePath
+                          << ": no .json files\n")
+                        .null());
+        return false;
+    }
+
+    // About 100 MB per scanner.
+    size_t passes = 100000000 / textBytes + 1;
+
+    const char* names[] = {"scalar", "sse2"};
+    JsonScanner scanners[] = {JSON_SCANNER_SCALAR, JSON_SCANNER_SSE2};
+
+    printf("%s",
+           (String() << texts.size << " files, " << textBytes << " bytes\n"
+                     << "scanner  MB/s\n")
+                   .null());
+
+    for (size_t i = 0; i < 2; i++) {
+        String line;
+        line << names[i] << "  ";
+
+        JsonScanFns fns;
+        if (!jsonGetScanFns(scanners[i], fns)) {
+            line << "unsupported\n";
+        }
+        else {
+            uint64_t mbps = benchJsonRun(texts, textBytes, passes,
+                                         scanners[i], 0);
+            if (mbps == 0) {
+                fprintf(stderr,
+                        "%s",
+                        (String() << exe << ": " << archivePath
+                                  << ": invalid JSON\n")
+                                .null());
+                return false;
+            }
+            line << mbps << "\n";
+        }
+
+        printf("%s", line.null());
+    }
+
+    benchJsonAllocators(texts, textBytes, passes);
+    benchJsonNumbers(texts);
+
+    return true;
+}
+
+// A PNG from an archive and the texture blobs it decodes to.
+struct BenchImage {
+    String png;
+    String raw;  // TEXTURE_COMPRESSION_NONE.
+    String lz4;  // TEXTURE_COMPRESSION_LZ4.
+};
+
+// Returns nanoseconds spent getting the pixels of every image out of the
+// form chosen by which, or -1 if one fails to decode: 0 is the PNG, 1 the
+// raw texture, and 2 the LZ4 texture.
+static Nanoseconds
+benchImagesRun(Vector<BenchImage>& images,
+               Vector<uint8_t>& pixels,
+               size_t passes,
+               int which) noexcept {
+    Nanoseconds start = chronoNow();
+
+    for (size_t pass = 0; pass < passes; pass++) {
+        for (BenchImage& image : images) {
+            if (which == 0) {
+                uint32_t width, height;
+                if (!pngDecode(image.png, width, height, pixels)) {
+                    return -1;
+                }
+                continue;
+            }
+
+            String& texture = which == 1 ? image.raw : image.lz4;
+
+            TextureHeader header;
+            memcpy(&header, texture.data, sizeof(header));
+            const char* data = texture.data + sizeof(header);
+            size_t size = static_cast<size_t>(header.width) * header.height * 4;
+
+            pixels.resize(size);
+            if (header.compression == TEXTURE_COMPRESSION_LZ4) {
+                if (!lz4Decompress(data, header.size, pixels.data, size)) {
+                    return -1;
+                }
+            }
+            else {
+                memcpy(pixels.data, data, size);
+            }
+        }
+    }
+
+    Nanoseconds elapsed = chronoNow() - start;
+    return elapsed > 0 ? elapsed : 1;
+}
+
+static bool
+benchImagesArchive(StringView archivePath) noexcept {
+    PackReader* pack = PackReader::fromFile(archivePath);
+
+    if (!pack) {
+        fprintf(stderr,
+                "%s",
+                (String() << exe << ": " << archivePath << ": not found\n")
+                        .null());
+        return false;
+    }
+
+    Vector<BenchImage> images;
+    size_t pngBytes = 0;
+    size_t rawBytes = 0;
+    size_t lz4Bytes = 0;
+
+    for (BlobIndex i = 0; i < pack->size(); i++) {
+        StringView path = pack->getBlobPath(i);
+        if (!hasExtension(path, ".png")) {
+            continue;
+        }
+
+        BenchImage image;
+        image.png.resize(static_cast<size_t>(pack->getBlobSize(i)));
+        if (!pack->readBlob(i, image.png.data)) {
+            reportBlobError(path, "corrupt blob");
+            delete pack;
+            return false;
+        }
+
+        uint32_t width, height;
+        Vector<uint8_t> rgba;
+        if (!pngDecode(image.png, width, height, rgba)) {
+            reportBlobError(path, "invalid PNG");
+            delete pack;
+            return false;
+        }
+
+        makeTexture(width, height, rgba.data, TEXTURE_COMPRESSION_NONE,
+                    image.raw);
+        makeTexture(width, height, rgba.data, TEXTURE_COMPRESSION_LZ4,
+                    image.lz4);
+
+        pngBytes += image.png.size;
+        rawBytes += rgba.size;
+        lz4Bytes += image.lz4.size;
+        images.push_back(static_cast<BenchImage&&>(image));
+    }
+
+    delete pack;
+
+    if (rawBytes == 0) {
+        fprintf(stderr,
+                "%s",
+                (String() << exe << ": " << archivePath << ": no .png files\n")
+                        .null());
+        return false;
+    }
+
+    // About 100 MB of pixels per form.
+    size_t passes = 100000000 / rawBytes + 1;
+
+    printf("%s",
+           (String() << images.size << " images, " << rawBytes
+                     << " bytes of pixels\n"
+                     << "form  bytes in archive  microseconds per MB\n")
+                   .null());
+
+    const char* names[] = {"png", "texture", "texture-lz4"};
+    size_t sizes[] = {pngBytes, rawBytes, lz4Bytes};
+
+    Vector<uint8_t> pixels;
+    for (int which = 0; which < 3; which++) {
+        Nanoseconds elapsed = benchImagesRun(images, pixels, passes, which);
+        if (elapsed < 0) {
+            fprintf(stderr,
+                    "%s",
+                    (String() << exe << ": " << archivePath
+                              << ": image failed to decode\n")
+                            .null());
+            return false;
+        }
+
+        uint64_t bytes = static_cast<uint64_t>(rawBytes) * passes;
+        uint64_t usPerMB = static_cast<uint64_t>(elapsed) * 1000 / bytes;
+        printf("%s",
+               (String() << names[which] << "  " << sizes[which] << "  "
+                         << usPerMB << "\n")
+                       .null());
+    }
+
+    return true;
 }
 
 int
@@ -263,9 +1530,68 @@ main(int argc, char* argv[]) noexcept {
     int exitCode;
 
     if (command == "create") {
-        if (args.size > 0 && args[0] == "-v") {
-            verbose = true;
-            args.erase(0);
+        while (args.size > 0 && args[0].size > 0 && args[0].data[0] == '-') {
+            if (args[0] == "-v") {
+                verbose = true;
+                args.erase(0);
+            }
+            else if (args[0] == "--compile-areas") {
+                compileAreas = true;
+                args.erase(0);
+            }
+            else if (args[0] == "--stream-areas") {
+                compileAreas = true;
+                streamAreas = true;
+                args.erase(0);
+            }
+            else if (args[0] == "--bake-atlas") {
+                bakeAtlas = true;
+                args.erase(0);
+            }
+            else if (args[0] == "--decode-sounds") {
+                decodeSounds = true;
+                args.erase(0);
+            }
+            else if (args[0] == "--decode-images" && args.size > 1) {
+                if (args[1] == "none") {
+                    decodedCompression = TEXTURE_COMPRESSION_NONE;
+                }
+                else if (args[1] == "lz4") {
+                    decodedCompression = TEXTURE_COMPRESSION_LZ4;
+                }
+                else {
+                    usage();
+                    return 1;
+                }
+                decodeImages = true;
+                args.erase(0);
+                args.erase(0);
+            }
+            else if (args[0] == "--order" && args.size > 1) {
+                orderPath = args[1];
+                args.erase(0);
+                args.erase(0);
+            }
+            else if (args[0] == "-a" && args.size > 1) {
+                if (!parseAlignment(args[1])) {
+                    usage();
+                    return 1;
+                }
+                args.erase(0);
+                args.erase(0);
+            }
+            else if (args[0] == "-c" && args.size > 1) {
+                if (!parseCompression(args[1])) {
+                    usage();
+                    return 1;
+                }
+                args.erase(0);
+                args.erase(0);
+            }
+            else {
+                usage();
+                return 1;
+            }
         }
 
         if (args.size < 2) {
@@ -273,6 +1599,13 @@ main(int argc, char* argv[]) noexcept {
             return 1;
         }
 
+        // Regions read straight from the archive would stay mapped after the
+        // engine drops them. A -c rule given for them comes first and wins.
+        if (streamAreas) {
+            extensionCompressions.push_back(
+                    {AREA_BIN_REGION_EXTENSION, BLOB_COMPRESSION_LZ4});
+        }
+
         // The first argument is the archive, the rest are files to add to it.
         StringView archivePath = args[0];
         args.erase(0);
@@ -290,6 +1623,35 @@ main(int argc, char* argv[]) noexcept {
 
         exitCode = listArchive(args[0]) ? 0 : 1;
     }
+    else if (command == "diff") {
+        if (args.size > 0 && args[0] == "-v") {
+            verbose = true;
+            args.erase(0);
+        }
+
+        if (args.size != 3) {
+            usage();
+            return 1;
+        }
+
+        exitCode = diffArchives(args[0], args[1], args[2]) ? 0 : 1;
+    }
+    else if (command == "bench-json") {
+        if (args.size != 1) {
+            usage();
+            return 1;
+        }
+
+        exitCode = benchJsonArchive(args[0]) ? 0 : 1;
+    }
+    else if (command == "bench-images") {
+        if (args.size != 1) {
+            usage();
+            return 1;
+        }
+
+        exitCode = benchImagesArchive(args[0]) ? 0 : 1;
+    }
     else if (command == "extract") {
         if (args.size > 0 && args[0] == "-v") {
             verbose = true;
@@ -303,6 +1665,19 @@ main(int argc, char* argv[]) noexcept {
 
         exitCode = extractArchive(args[0]) ? 0 : 1;
     }
+    else if (command == "verify") {
+        if (args.size > 0 && args[0] == "-v") {
+            verbose = true;
+            args.erase(0);
+        }
+
+        if (args.size != 1) {
+            usage();
+            return 1;
+        }
+
+        exitCode = verifyArchive(args[0]) ? 0 : 1;
+    }
     else {
         usage();
         return 1;
@@ -28,18 +28,25 @@
 
 #include "os/c.h"
 #include "os/mapped-file.h"
+#include "pack/lz4.h"
 #include "util/constexpr.h"
 #include "util/hashtable.h"
 #include "util/int.h"
+#include "util/move.h"
 #include "util/new.h"
 #include "util/noexcept.h"
+#include "util/sort.h"
+#include "util/vector.h"
 
 //                                       "T   s    u    n    a   g    a   r"
 static constexpr uint8_t PACK_MAGIC[8] = {84, 115, 117, 110, 97, 103, 97, 114};
 
-static constexpr uint8_t PACK_VERSION = 1;
+// Version 1 has no lookup block. Version 2 adds one. Version 3 widens offsets
+// and sizes to 64 bits. Version 4 adds a checksum to each blob's metadata.
+static constexpr uint8_t PACK_VERSION_MIN = 1;
+static constexpr uint8_t PACK_VERSION = 4;
 
-struct HeaderBlock {
+struct HeaderBlockV1 {
     uint8_t magic[8];
     uint8_t version;
     uint8_t unused[7];
@@ -51,14 +58,45 @@ struct HeaderBlock {
     uint32_t dataOffsetsBlockOffset;
 };
 
+struct HeaderBlockV2 : HeaderBlockV1 {
+    uint32_t lookupBlockOffset;
+    uint32_t lookupSlotCount;  // A power of two.
+};
+
+struct HeaderBlock {
+    uint8_t magic[8];
+    uint8_t version;
+    uint8_t unused[7];
+    BlobIndex blobCount;
+    uint32_t lookupSlotCount;  // A power of two.
+    uint64_t pathOffsetsBlockOffset;
+    uint64_t pathsBlockOffset;
+    uint64_t pathsBlockSize;
+    uint64_t metadataBlockOffset;
+    uint64_t dataOffsetsBlockOffset;
+    uint64_t lookupBlockOffset;
+};
+
 typedef uint32_t PathOffset;
 
-enum BlobCompressionType { BLOB_COMPRESSION_NONE };
+// An open-addressed hash table of paths, probed linearly. Empty slots have
+// an index of BLOB_NOT_FOUND.
+struct LookupSlot {
+    uint32_t hash;
+    BlobIndex index;
+};
+
+struct BlobMetadataV1 {
+    uint32_t uncompressedSize;
+    uint32_t compressedSize;
+    BlobCompressionType compressionType;
+};
 
 struct BlobMetadata {
     BlobSize uncompressedSize;
     BlobSize compressedSize;
     BlobCompressionType compressionType;
+    uint32_t checksum;  // Zero before version 4.
 };
 
 class PackReaderImpl : public PackReader {
@@ -77,22 +115,51 @@ class PackReaderImpl : public PackReader {
     getBlobSize(BlobIndex index) noexcept;
     void*
     getBlobData(BlobIndex index) noexcept;
+    BlobSize
+    getBlobCompressedSize(BlobIndex index) noexcept;
+    BlobCompressionType
+    getBlobCompression(BlobIndex index) noexcept;
+    bool
+    getBlobChecksum(BlobIndex index, uint32_t& checksum) noexcept;
+
+    bool
+    readBlob(BlobIndex index, void* buf) noexcept;
+    bool
+    readBlobRange(BlobIndex index, BlobSize offset, size_t size, void* buf)
+            noexcept;
+
+    void
+    prefetch(const BlobIndex* indices, size_t count) noexcept;
 
  public:
     void
     constructLookups() noexcept;
 
+    BlobMetadata
+    getMetadata(BlobIndex index) noexcept;
+    BlobSize
+    getDataOffset(BlobIndex index) noexcept;
+
  public:
     MappedFile file;
 
-    // Pointers into `file`.
-    HeaderBlock* header;
+    BlobIndex blobCount;
+
+    // Pointers into `file`. Versions 1 and 2 use the V1 metadata and 32-bit
+    // data offsets, versions 3 and 4 use the others.
     PathOffset* pathOffsets;
     char* paths;
+    BlobMetadataV1* metadatasV1;
+    uint32_t* dataOffsetsV1;
     BlobMetadata* metadatas;
-    uint32_t* dataOffsets;
-
-    bool lookupsConstructed = false;
+    uint64_t* dataOffsets;
+    LookupSlot* lookupSlots;  // Null in version 1 packs.
+    uint32_t lookupMask;
+    bool hasChecksums;
+
+    // Only used for version 1 packs, which have no lookup block. Built when
+    // the pack is opened so findIndex never writes and can be called from
+    // several threads at once.
     Hashmap<StringView, BlobIndex> lookups;
 };
 
@@ -104,18 +171,25 @@ PackReader::fromFile(StringView path) noexcept {
     }
     char* data = file.data;
 
-    size_t offset = 0;
-
-    HeaderBlock* header = reinterpret_cast<HeaderBlock*>(data + offset);
+    if (file.size < sizeof(HeaderBlockV1)) {
+        destroyMappedFile(file);
+        return 0;
+    }
 
-    offset += sizeof(*header);
+    HeaderBlockV1* header = reinterpret_cast<HeaderBlockV1*>(data);
 
     if (memcmp(header->magic, PACK_MAGIC, sizeof(header->magic)) != 0) {
         destroyMappedFile(file);
         return 0;
     }
 
-    if (header->version != PACK_VERSION) {
+    if (header->version < PACK_VERSION_MIN ||
+        header->version > PACK_VERSION) {
+        destroyMappedFile(file);
+        return 0;
+    }
+
+    if (header->version >= 3 && file.size < sizeof(HeaderBlock)) {
         destroyMappedFile(file);
         return 0;
     }
@@ -125,21 +199,47 @@ PackReader::fromFile(StringView path) noexcept {
     new (reader) PackReaderImpl;
 
     reader->file = file;
-    reader->header = header;
-
-    BlobIndex blobCount = header->blobCount;
-
-    reader->pathOffsets = reinterpret_cast<PathOffset*>(data + offset);
-    offset += (blobCount + 1) * sizeof(PathOffset);
-
-    reader->paths = reinterpret_cast<char*>(data + offset);
-    offset += header->pathsBlockSize;
-
-    reader->metadatas = reinterpret_cast<BlobMetadata*>(data + offset);
-    offset += blobCount * sizeof(BlobMetadata);
-
-    reader->dataOffsets = reinterpret_cast<uint32_t*>(data + offset);
-    // offset += blobCount * sizeof(uint64_t);
+    reader->blobCount = header->blobCount;
+    reader->metadatasV1 = 0;
+    reader->dataOffsetsV1 = 0;
+    reader->metadatas = 0;
+    reader->dataOffsets = 0;
+    reader->lookupSlots = 0;
+    reader->lookupMask = 0;
+    reader->hasChecksums = header->version >= 4;
+
+    if (header->version >= 3) {
+        HeaderBlock* header3 = reinterpret_cast<HeaderBlock*>(data);
+        reader->pathOffsets = reinterpret_cast<PathOffset*>(
+                data + header3->pathOffsetsBlockOffset);
+        reader->paths = data + header3->pathsBlockOffset;
+        reader->metadatas = reinterpret_cast<BlobMetadata*>(
+                data + header3->metadataBlockOffset);
+        reader->dataOffsets = reinterpret_cast<uint64_t*>(
+                data + header3->dataOffsetsBlockOffset);
+        reader->lookupSlots = reinterpret_cast<LookupSlot*>(
+                data + header3->lookupBlockOffset);
+        reader->lookupMask = header3->lookupSlotCount - 1;
+    }
+    else {
+        reader->pathOffsets = reinterpret_cast<PathOffset*>(
+                data + header->pathOffsetsBlockOffset);
+        reader->paths = data + header->pathsBlockOffset;
+        reader->metadatasV1 = reinterpret_cast<BlobMetadataV1*>(
+                data + header->metadataBlockOffset);
+        reader->dataOffsetsV1 = reinterpret_cast<uint32_t*>(
+                data + header->dataOffsetsBlockOffset);
+
+        if (header->version == 2) {
+            HeaderBlockV2* header2 = static_cast<HeaderBlockV2*>(header);
+            reader->lookupSlots = reinterpret_cast<LookupSlot*>(
+                    data + header2->lookupBlockOffset);
+            reader->lookupMask = header2->lookupSlotCount - 1;
+        }
+        else {
+            reader->constructLookups();
+        }
+    }
 
     return reader;
 }
@@ -150,14 +250,130 @@ PackReaderImpl::~PackReaderImpl() noexcept {
 
 BlobIndex
 PackReaderImpl::size() noexcept {
-    return header->blobCount;
+    return blobCount;
+}
+
+// Copies the index'th element out of a block, which packs written before
+// blocks were padded may leave unaligned.
+template<typename T>
+static T
+readElement(T* block, size_t index) noexcept {
+    T x;
+    memcpy(&x, reinterpret_cast<char*>(block) + index * sizeof(T), sizeof(T));
+    return x;
+}
+
+BlobMetadata
+PackReaderImpl::getMetadata(BlobIndex index) noexcept {
+    if (metadatas) {
+        return readElement(metadatas, index);
+    }
+    BlobMetadataV1 v1 = readElement(metadatasV1, index);
+    return {v1.uncompressedSize, v1.compressedSize, v1.compressionType, 0};
+}
+
+BlobSize
+PackReaderImpl::getDataOffset(BlobIndex index) noexcept {
+    return dataOffsets ? readElement(dataOffsets, index)
+                       : readElement(dataOffsetsV1, index);
+}
+
+uint32_t
+packHashPath(StringView path) noexcept {
+    // 32-bit FNV-1a, so the hash is the same on every platform.
+    uint32_t hash = 0x811c9dc5;
+    for (size_t i = 0; i < path.size; i++) {
+        hash ^= static_cast<uint8_t>(path.data[i]);
+        hash *= 0x01000193;
+    }
+    return hash;
+}
+
+// xxHash32 with a seed of zero. Reads words in native byte order, which is
+// little-endian on every platform we support.
+static constexpr uint32_t XXH_PRIME1 = 2654435761U;
+static constexpr uint32_t XXH_PRIME2 = 2246822519U;
+static constexpr uint32_t XXH_PRIME3 = 3266489917U;
+static constexpr uint32_t XXH_PRIME4 = 668265263U;
+static constexpr uint32_t XXH_PRIME5 = 374761393U;
+
+static inline uint32_t
+rotl32(uint32_t x, int r) noexcept {
+    return (x << r) | (x >> (32 - r));
+}
+
+static inline uint32_t
+read32(const uint8_t* p) noexcept {
+    uint32_t x;
+    memcpy(&x, p, sizeof(x));
+    return x;
+}
+
+static inline uint32_t
+xxhRound(uint32_t acc, uint32_t input) noexcept {
+    acc += input * XXH_PRIME2;
+    acc = rotl32(acc, 13);
+    return acc * XXH_PRIME1;
+}
+
+uint32_t
+packChecksum(const void* data, size_t size) noexcept {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    const uint8_t* end = p + size;
+    uint32_t hash;
+
+    if (size >= 16) {
+        // Four independent lanes so the multiplies overlap.
+        const uint8_t* limit = end - 16;
+        uint32_t v1 = XXH_PRIME1 + XXH_PRIME2;
+        uint32_t v2 = XXH_PRIME2;
+        uint32_t v3 = 0;
+        uint32_t v4 = 0 - XXH_PRIME1;
+        do {
+            v1 = xxhRound(v1, read32(p));
+            v2 = xxhRound(v2, read32(p + 4));
+            v3 = xxhRound(v3, read32(p + 8));
+            v4 = xxhRound(v4, read32(p + 12));
+            p += 16;
+        } while (p <= limit);
+        hash = rotl32(v1, 1) + rotl32(v2, 7) + rotl32(v3, 12) + rotl32(v4, 18);
+    }
+    else {
+        hash = XXH_PRIME5;
+    }
+
+    hash += static_cast<uint32_t>(size);
+
+    for (; p + 4 <= end; p += 4) {
+        hash += read32(p) * XXH_PRIME3;
+        hash = rotl32(hash, 17) * XXH_PRIME4;
+    }
+    for (; p < end; p++) {
+        hash += *p * XXH_PRIME5;
+        hash = rotl32(hash, 11) * XXH_PRIME1;
+    }
+
+    hash ^= hash >> 15;
+    hash *= XXH_PRIME2;
+    hash ^= hash >> 13;
+    hash *= XXH_PRIME3;
+    hash ^= hash >> 16;
+    return hash;
 }
 
 BlobIndex
 PackReaderImpl::findIndex(StringView path) noexcept {
-    if (!lookupsConstructed) {
-        lookupsConstructed = true;
-        constructLookups();
+    if (lookupSlots) {
+        uint32_t hash = packHashPath(path);
+        for (uint32_t i = hash & lookupMask;; i = (i + 1) & lookupMask) {
+            LookupSlot slot = readElement(lookupSlots, i);
+            if (slot.index == BLOB_NOT_FOUND) {
+                return BLOB_NOT_FOUND;
+            }
+            if (slot.hash == hash && getBlobPath(slot.index) == path) {
+                return slot.index;
+            }
+        }
     }
 
     Hashmap<StringView, BlobIndex>::iterator it = lookups.find(path);
@@ -178,17 +394,123 @@ PackReaderImpl::getBlobPath(BlobIndex index) noexcept {
 
 BlobSize
 PackReaderImpl::getBlobSize(BlobIndex index) noexcept {
-    return metadatas[index].uncompressedSize;
+    return getMetadata(index).uncompressedSize;
 }
 
 void*
 PackReaderImpl::getBlobData(BlobIndex index) noexcept {
-    return file.data + dataOffsets[index];
+    return file.data + getDataOffset(index);
+}
+
+BlobSize
+PackReaderImpl::getBlobCompressedSize(BlobIndex index) noexcept {
+    return getMetadata(index).compressedSize;
+}
+
+BlobCompressionType
+PackReaderImpl::getBlobCompression(BlobIndex index) noexcept {
+    return getMetadata(index).compressionType;
+}
+
+bool
+PackReaderImpl::getBlobChecksum(BlobIndex index, uint32_t& checksum) noexcept {
+    if (!hasChecksums) {
+        return false;
+    }
+    checksum = getMetadata(index).checksum;
+    return true;
+}
+
+bool
+PackReaderImpl::readBlobRange(BlobIndex index,
+                              BlobSize offset,
+                              size_t size,
+                              void* buf) noexcept {
+    BlobMetadata metadata = getMetadata(index);
+
+    if (metadata.compressionType != BLOB_COMPRESSION_NONE) {
+        return false;
+    }
+    if (offset > metadata.uncompressedSize ||
+        size > metadata.uncompressedSize - offset) {
+        return false;
+    }
+
+    memcpy(buf, file.data + getDataOffset(index) + offset, size);
+    return true;
+}
+
+bool
+PackReaderImpl::readBlob(BlobIndex index, void* buf) noexcept {
+    BlobMetadata metadata = getMetadata(index);
+    void* data = getBlobData(index);
+
+    switch (metadata.compressionType) {
+    case BLOB_COMPRESSION_NONE:
+        memcpy(buf, data, metadata.uncompressedSize);
+        return true;
+    case BLOB_COMPRESSION_LZ4:
+        return lz4Decompress(data, metadata.compressedSize, buf,
+                             metadata.uncompressedSize);
+    default:
+        return false;
+    }
+}
+
+struct PrefetchRange {
+    size_t begin;
+    size_t end;
+};
+
+void
+PackReaderImpl::prefetch(const BlobIndex* indices, size_t count) noexcept {
+    // Blobs closer together than this are advised as one range.
+    static constexpr size_t MERGE_GAP = 4096;
+    // Ranges at least this large are also marked for sequential access so the
+    // OS reads ahead aggressively.
+    static constexpr size_t SEQUENTIAL_MIN = 64 * 1024;
+
+    Vector<PrefetchRange> ranges;
+    ranges.reserve(count);
+
+    for (size_t i = 0; i < count; i++) {
+        BlobIndex index = indices[i];
+        if (index == BLOB_NOT_FOUND) {
+            continue;
+        }
+        size_t begin = static_cast<size_t>(getDataOffset(index));
+        size_t end = begin + static_cast<size_t>(getBlobCompressedSize(index));
+        ranges.push_back({begin, end});
+    }
+
+    PrefetchRange* data = ranges.data;
+#define LESS(i, j) data[i].begin < data[j].begin
+#define SWAP(i, j) swap_(data[i], data[j])
+    QSORT(ranges.size, LESS, SWAP);
+#undef LESS
+#undef SWAP
+
+    size_t i = 0;
+    while (i < ranges.size) {
+        PrefetchRange merged = ranges[i++];
+        while (i < ranges.size && ranges[i].begin <= merged.end + MERGE_GAP) {
+            if (ranges[i].end > merged.end) {
+                merged.end = ranges[i].end;
+            }
+            i++;
+        }
+
+        size_t size = merged.end - merged.begin;
+        if (size >= SEQUENTIAL_MIN) {
+            mappedFileAdvise(file, merged.begin, size, MFA_SEQUENTIAL);
+        }
+        mappedFileAdvise(file, merged.begin, size, MFA_WILLNEED);
+    }
 }
 
 void
 PackReaderImpl::constructLookups() noexcept {
-    for (BlobIndex i = 0; i < header->blobCount; i++) {
+    for (BlobIndex i = 0; i < blobCount; i++) {
         uint32_t pathBegin = pathOffsets[i];
         uint32_t pathEnd = pathOffsets[i + 1];
         StringView blobPath(paths + pathBegin, pathEnd - pathBegin);
@@ -32,10 +32,14 @@
 #include "util/string-view.h"
 
 typedef uint32_t BlobIndex;
-typedef uint32_t BlobSize;
+typedef uint64_t BlobSize;
 
 static BlobIndex BLOB_NOT_FOUND = UINT32_MAX;
 
+enum BlobCompressionType { BLOB_COMPRESSION_NONE, BLOB_COMPRESSION_LZ4 };
+
+// Once opened, a PackReader is read-only and every method may be called from
+// several threads at once.
 class PackReader {
  public:
     static PackReader*
@@ -52,8 +56,44 @@ class PackReader {
     getBlobPath(BlobIndex index) noexcept = 0;
     virtual BlobSize
     getBlobSize(BlobIndex index) noexcept = 0;
+
+    // The blob's bytes as stored in the archive. If the blob is compressed,
+    // these are getBlobCompressedSize() bytes of compressed data.
     virtual void*
     getBlobData(BlobIndex index) noexcept = 0;
+    virtual BlobSize
+    getBlobCompressedSize(BlobIndex index) noexcept = 0;
+    virtual BlobCompressionType
+    getBlobCompression(BlobIndex index) noexcept = 0;
+
+    // The packChecksum of the blob's bytes as stored in the archive. Returns
+    // false if the archive predates checksums.
+    virtual bool
+    getBlobChecksum(BlobIndex index, uint32_t& checksum) noexcept = 0;
+
+    // Write the blob's uncompressed contents, getBlobSize() bytes, to buf.
+    virtual bool
+    readBlob(BlobIndex index, void* buf) noexcept = 0;
+
+    // Copy size bytes starting at offset of an uncompressed blob to buf.
+    // Returns false for compressed blobs and out-of-range reads. Lets large
+    // blobs be read piecewise.
+    virtual bool
+    readBlobRange(BlobIndex index, BlobSize offset, size_t size, void* buf)
+            noexcept = 0;
+
+    // Hint that these blobs will be read soon so the OS can start paging
+    // them in. Indices of BLOB_NOT_FOUND are ignored.
+    virtual void
+    prefetch(const BlobIndex* indices, size_t count) noexcept = 0;
 };
 
+// The hash used by the on-disk path lookup table.
+uint32_t
+packHashPath(StringView path) noexcept;
+
+// The checksum stored for each blob, xxHash32.
+uint32_t
+packChecksum(const void* data, size_t size) noexcept;
+
 #endif  // SRC_PACK_PACK_READER_H_
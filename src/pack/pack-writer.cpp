@@ -26,12 +26,21 @@
 
 #include "pack/pack-writer.h"
 
+#include "os/c.h"
+#include "os/mapped-file.h"
 #include "os/os.h"
+#include "os/writable-file.h"
 #include "pack/file-type.h"
+#include "pack/lz4.h"
 #include "pack/pack-reader.h"
 #include "util/constexpr.h"
+#include "util/function.h"
+#include "util/hashtable.h"
 #include "util/int.h"
+#include "util/jobs.h"
+#include "util/math2.h"
 #include "util/move.h"
+#include "util/new.h"
 #include "util/noexcept.h"
 #include "util/sort.h"
 #include "util/string.h"
@@ -40,38 +49,54 @@
 //                                       "T   s    u    n    a   g    a   r"
 static constexpr uint8_t PACK_MAGIC[8] = {84, 115, 117, 110, 97, 103, 97, 114};
 
-static constexpr uint8_t PACK_VERSION = 1;
+static constexpr uint8_t PACK_VERSION = 4;
 
 struct HeaderBlock {
     uint8_t magic[8];
     uint8_t version;
     uint8_t unused[7];
     uint32_t blobCount;
-    uint32_t pathOffsetsBlockOffset;
-    uint32_t pathsBlockOffset;
-    uint32_t pathsBlockSize;
-    uint32_t metadataBlockOffset;
-    uint32_t dataOffsetsBlockOffset;
+    uint32_t lookupSlotCount;
+    uint64_t pathOffsetsBlockOffset;
+    uint64_t pathsBlockOffset;
+    uint64_t pathsBlockSize;
+    uint64_t metadataBlockOffset;
+    uint64_t dataOffsetsBlockOffset;
+    uint64_t lookupBlockOffset;
 };
 
-typedef uint32_t BlobSize;
 typedef uint32_t PathOffset;
-enum BlobCompressionType { BLOB_COMPRESSION_NONE };
+
+struct LookupSlot {
+    uint32_t hash;
+    BlobIndex index;
+};
 
 struct BlobMetadata {
     BlobSize uncompressedSize;
     BlobSize compressedSize;
     BlobCompressionType compressionType;
+    uint32_t checksum;
 };
 
 struct Blob {
     String path;
-    BlobSize size;
-    const void* data;
+    BlobSize size;  // Size of data, which may be compressed.
+    const void* data;  // Null if the blob is read from source.
+    BlobSize uncompressedSize;
+    BlobCompressionType compressionType;
+    uint32_t order;  // Position in the load order, or UINT32_MAX if absent.
+    String source;  // File the blob is copied from when data is null.
+    uint32_t checksum;  // packChecksum of the data as stored.
 };
 
 static bool
 operator<(const Blob& a, const Blob& b) noexcept {
+    // Blobs with a known load order come first, in that order.
+    if (a.order != b.order) {
+        return a.order < b.order;
+    }
+
     FileType typeA = determineFileType(a.path);
     FileType typeB = determineFileType(b.path);
     if (typeA < typeB) {
@@ -85,9 +110,16 @@ operator<(const Blob& a, const Blob& b) noexcept {
     }
 }
 
+// Rounds a block's offset up so the 64-bit integers in it are aligned.
+static uint64_t
+alignBlockOffset(uint64_t offset) noexcept {
+    return (offset + alignof(uint64_t) - 1) & ~uint64_t{alignof(uint64_t) - 1};
+}
 
 struct PackWriter {
     Vector<Blob> blobs;
+    Hashmap<String, uint32_t> order;
+    uint32_t alignments[FT_MEDIA + 1] = {1, 1, 1};  // Indexed by FileType.
 };
 
 PackWriter*
@@ -104,7 +136,231 @@ destroyPackWriter(PackWriter* writer) noexcept {
 void
 packWriterAddBlob(PackWriter* writer, StringView path, BlobSize size,
         const void* data) noexcept {
-    writer->blobs.push_back({String(path), size, data});
+    writer->blobs.push_back({String(path), size, data, size,
+                             BLOB_COMPRESSION_NONE, 0, String(), 0});
+}
+
+void
+packWriterAddCompressedBlob(PackWriter* writer, StringView path,
+        BlobSize uncompressedSize, BlobSize compressedSize,
+        BlobCompressionType compressionType, const void* data) noexcept {
+    writer->blobs.push_back({String(path), compressedSize, data,
+                             uncompressedSize, compressionType, 0, String(), 0});
+}
+
+void
+packWriterAddFileBlob(PackWriter* writer, StringView path, StringView source,
+        BlobSize size) noexcept {
+    writer->blobs.push_back({String(path), size, 0, size,
+                             BLOB_COMPRESSION_NONE, 0, String(source), 0});
+}
+
+void
+packWriterAddCompressedFileBlob(PackWriter* writer, StringView path,
+        StringView source, BlobSize uncompressedSize, BlobSize compressedSize,
+        BlobCompressionType compressionType) noexcept {
+    writer->blobs.push_back({String(path), compressedSize, 0,
+                             uncompressedSize, compressionType, 0,
+                             String(source), 0});
+}
+
+void
+packWriterSetAlignment(PackWriter* writer, FileType type, uint32_t alignment)
+        noexcept {
+    writer->alignments[type] = alignment;
+}
+
+void
+packWriterSetOrder(PackWriter* writer, StringView trace) noexcept {
+    uint32_t position = 0;
+    while (trace.size) {
+        StringPosition eol = trace.find('\n');
+        StringView line = eol == SV_NOT_FOUND ? trace : trace.substr(0, eol);
+        trace = eol == SV_NOT_FOUND ? StringView() : trace.substr(eol + 1);
+
+        if (line.size && line.data[line.size - 1] == '\r') {
+            line = line.substr(0, line.size - 1);
+        }
+        if (line.size == 0 || writer->order.contains(line)) {
+            continue;
+        }
+        writer->order[String(line)] = position++;
+    }
+}
+
+// The bytes a blob's identity is derived from: its data if it is held in
+// memory, otherwise its source file, mapped.
+struct BlobContent {
+    const char* data;
+    size_t size;
+    MappedFile map;
+    bool mapped;
+};
+
+static bool
+openContent(Blob& blob, BlobContent& content) noexcept {
+    content.mapped = false;
+
+    if (blob.data) {
+        content.data = static_cast<const char*>(blob.data);
+        content.size = static_cast<size_t>(blob.size);
+        return true;
+    }
+
+    content.data = 0;
+    content.size = static_cast<size_t>(blob.uncompressedSize);
+    if (content.size == 0) {
+        return true;
+    }
+
+    StringView source = blob.source;
+    if (!makeMappedFile(source, content.map)) {
+        return false;
+    }
+    content.mapped = true;
+    content.data = content.map.data;
+
+    // The file changed since it was added.
+    return content.map.size == content.size;
+}
+
+static void
+closeContent(BlobContent& content) noexcept {
+    if (content.mapped) {
+        destroyMappedFile(content.map);
+    }
+}
+
+// Unless the blob is compressed as it is written, its content is the data
+// that will be stored, so the hash doubles as its checksum.
+static bool
+hashContent(Blob& blob, uint32_t& hash) noexcept {
+    BlobContent content;
+    bool ok = openContent(blob, content);
+    if (ok) {
+        hash = packChecksum(content.data, content.size);
+        if (blob.data || blob.compressionType == BLOB_COMPRESSION_NONE) {
+            blob.checksum = hash;
+        }
+    }
+    closeContent(content);
+    return ok;
+}
+
+// Whether two blobs would be stored as the same bytes. Called on blobs with
+// equal content hashes, so usually true.
+static bool
+sameContent(Blob& a, Blob& b) noexcept {
+    if (a.size != b.size || a.uncompressedSize != b.uncompressedSize ||
+        a.compressionType != b.compressionType ||
+        (a.data == 0) != (b.data == 0)) {
+        return false;
+    }
+
+    BlobContent contentA, contentB;
+    bool openA = openContent(a, contentA);
+    bool openB = openContent(b, contentB);
+    bool same = openA && openB &&
+                memcmp(contentA.data, contentB.data, contentA.size) == 0;
+    closeContent(contentA);
+    closeContent(contentB);
+    return same;
+}
+
+struct HashedBlob {
+    uint32_t hash;
+    uint32_t index;
+};
+
+static bool
+operator<(const HashedBlob& a, const HashedBlob& b) noexcept {
+    return a.hash < b.hash || (a.hash == b.hash && a.index < b.index);
+}
+
+// Find blobs with the same content as an earlier blob. duplicateOf[i] is set
+// to the index of the earliest such blob, or BLOB_NOT_FOUND if i is unique.
+static bool
+findDuplicates(Vector<Blob>& blobs, Vector<BlobIndex>& duplicateOf) noexcept {
+    Vector<HashedBlob> hashes;
+    hashes.resize(blobs.size);
+
+    bool ok = JobsForEach(blobs.size, [&](size_t i) noexcept {
+        hashes[i].index = static_cast<uint32_t>(i);
+        return hashContent(blobs[i], hashes[i].hash);
+    });
+    if (!ok) {
+        return false;
+    }
+
+    HashedBlob* data = hashes.data;
+#define LESS(i, j) data[i] < data[j]
+#define SWAP(i, j) swap_(data[i], data[j])
+    QSORT(hashes.size, LESS, SWAP);
+#undef LESS
+#undef SWAP
+
+    duplicateOf.resize(blobs.size);
+    for (BlobIndex& original : duplicateOf) {
+        original = BLOB_NOT_FOUND;
+    }
+
+    // Within a run of equal hashes, compare each blob against the unique
+    // blobs before it.
+    for (size_t begin = 0; begin < hashes.size;) {
+        size_t end = begin + 1;
+        while (end < hashes.size && hashes[end].hash == hashes[begin].hash) {
+            end++;
+        }
+
+        for (size_t j = begin + 1; j < end; j++) {
+            uint32_t candidate = hashes[j].index;
+            for (size_t k = begin; k < j; k++) {
+                uint32_t earlier = hashes[k].index;
+                if (duplicateOf[earlier] == BLOB_NOT_FOUND &&
+                    sameContent(blobs[earlier], blobs[candidate])) {
+                    duplicateOf[candidate] = earlier;
+                    break;
+                }
+            }
+        }
+
+        begin = end;
+    }
+
+    return true;
+}
+
+static bool
+writeBlob(WritableFile file, Blob& blob, uint64_t offset) noexcept {
+    if (blob.data) {
+        return writableFileWrite(file, offset, blob.data,
+                                 static_cast<size_t>(blob.size));
+    }
+
+    if (blob.compressionType == BLOB_COMPRESSION_NONE) {
+        return writableFileCopy(file, offset, blob.source, blob.size);
+    }
+
+    // Compressed blobs whose output was not kept in memory are compressed
+    // again. Compression is deterministic, so the size matches the one the
+    // layout was computed from.
+    String data;
+    if (!readFile(blob.source, data) || data.size != blob.uncompressedSize) {
+        return false;
+    }
+
+    size_t bound = lz4CompressBound(data.size);
+    char* compressed = static_cast<char*>(malloc(bound));
+    size_t compressedSize =
+            lz4Compress(data.data, data.size, compressed, bound);
+
+    blob.checksum = packChecksum(compressed, compressedSize);
+
+    bool ok = compressedSize == blob.size &&
+              writableFileWrite(file, offset, compressed, compressedSize);
+
+    free(compressed);
+    return ok;
 }
 
 bool
@@ -113,7 +369,12 @@ packWriterWriteToFile(PackWriter* writer, StringView path) noexcept {
 
     uint32_t blobCount = static_cast<uint32_t>(blobs.size);
 
-    // Sort blobs by size (smallest first).
+    for (Blob& blob : blobs) {
+        uint32_t* position = writer->order.tryAt(blob.path);
+        blob.order = position ? *position : UINT32_MAX;
+    }
+
+    // Sort blobs by load order, then type, then path.
     Blob* data = blobs.data;
 #define LESS(i, j) data[i] < data[j]
 #define SWAP(i, j) swap_(data[i], data[j])
@@ -123,12 +384,30 @@ packWriterWriteToFile(PackWriter* writer, StringView path) noexcept {
     uint32_t pathOffsetsBlockSize = (blobCount + 1) * sizeof(PathOffset);
     uint32_t pathsBlockSize = 0;
     uint32_t metadataBlockSize = blobCount * sizeof(BlobMetadata);
-    uint32_t dataOffsetsBlockSize = blobCount * sizeof(uint32_t);
+    uint32_t dataOffsetsBlockSize = blobCount * sizeof(uint64_t);
+
+    // Keep the lookup table at most half full so probe sequences stay short.
+    uint32_t lookupSlotCount = pow2(blobCount * 2);
+    if (lookupSlotCount == 0) {
+        lookupSlotCount = 1;
+    }
+    uint32_t lookupBlockSize = lookupSlotCount * sizeof(LookupSlot);
 
     for (Blob& blob : blobs) {
         pathsBlockSize += static_cast<uint32_t>(blob.path.size);
     }
 
+    // The paths block has no alignment, so the blocks after it are padded to
+    // keep the integers in them aligned when the pack is mapped.
+    uint64_t pathOffsetsBlockOffset = sizeof(HeaderBlock);
+    uint64_t pathsBlockOffset = pathOffsetsBlockOffset + pathOffsetsBlockSize;
+    uint64_t metadataBlockOffset =
+            alignBlockOffset(pathsBlockOffset + pathsBlockSize);
+    uint64_t dataOffsetsBlockOffset =
+            alignBlockOffset(metadataBlockOffset + metadataBlockSize);
+    uint64_t lookupBlockOffset =
+            alignBlockOffset(dataOffsetsBlockOffset + dataOffsetsBlockSize);
+
     // Construct blocks.
     HeaderBlock headerBlock = {
             {PACK_MAGIC[0],
@@ -145,27 +424,22 @@ packWriterWriteToFile(PackWriter* writer, StringView path) noexcept {
 
             // blobCount
             static_cast<uint32_t>(blobCount),
+            // lookupSlotCount
+            lookupSlotCount,
 
-            // We write blocks contiguously (well, so far we do).
-
-            // pathOffsetsBlockOffset
-            sizeof(HeaderBlock),
-            // pathsBlockOffset
-            static_cast<uint32_t>(sizeof(HeaderBlock)) + pathOffsetsBlockSize,
-            // pathsBlockSize
+            pathOffsetsBlockOffset,
+            pathsBlockOffset,
             pathsBlockSize,
-            // metadataBlockOffset
-            static_cast<uint32_t>(sizeof(HeaderBlock)) + pathOffsetsBlockSize +
-                    pathsBlockSize,
-            // dataOffsetsBlockOffset
-            static_cast<uint32_t>(sizeof(HeaderBlock)) + pathOffsetsBlockSize +
-                    pathsBlockSize + metadataBlockSize,
+            metadataBlockOffset,
+            dataOffsetsBlockOffset,
+            lookupBlockOffset,
     };
 
     Vector<PathOffset> pathOffsetsBlock;
     String pathsBlock;
     Vector<BlobMetadata> metadatasBlock;
-    Vector<uint32_t> dataOffsetsBlock;
+    Vector<uint64_t> dataOffsetsBlock;
+    Vector<LookupSlot> lookupBlock;
 
     pathOffsetsBlock.reserve(blobCount + 1);
     pathsBlock.reserve(pathsBlockSize);
@@ -182,46 +456,87 @@ packWriterWriteToFile(PackWriter* writer, StringView path) noexcept {
         pathsBlock << blob.path;
     }
 
-    for (Blob& blob : blobs) {
-        BlobMetadata metadata = {blob.size, blob.size, BLOB_COMPRESSION_NONE};
-        metadatasBlock.push_back(metadata);
+    lookupBlock.resize(lookupSlotCount);
+    for (LookupSlot& slot : lookupBlock) {
+        slot = {0, BLOB_NOT_FOUND};
+    }
+    uint32_t lookupMask = lookupSlotCount - 1;
+    for (uint32_t i = 0; i < blobCount; i++) {
+        uint32_t hash = packHashPath(blobs[i].path);
+        uint32_t slot = hash & lookupMask;
+        while (lookupBlock[slot].index != BLOB_NOT_FOUND) {
+            slot = (slot + 1) & lookupMask;
+        }
+        lookupBlock[slot] = {hash, i};
     }
 
-    // Blob data starts immediately after the data offset block.
-    uint32_t dataOffset =
-            headerBlock.dataOffsetsBlockOffset + dataOffsetsBlockSize;
-    for (Blob& blob : blobs) {
+    // Blobs with the same content share one copy of the data.
+    Vector<BlobIndex> duplicateOf;
+    if (!findDuplicates(blobs, duplicateOf)) {
+        return false;
+    }
+
+    // Blob data starts after the lookup block. Each blob is preceded by
+    // enough padding to align it. The file is created at its final size, so
+    // padding is already zero and need not be written.
+    dataOffsetsBlock.reserve(blobCount);
+
+    uint64_t dataOffset = headerBlock.lookupBlockOffset + lookupBlockSize;
+    for (uint32_t i = 0; i < blobCount; i++) {
+        if (duplicateOf[i] != BLOB_NOT_FOUND) {
+            uint64_t sharedOffset = dataOffsetsBlock[duplicateOf[i]];
+            dataOffsetsBlock.push_back(sharedOffset);
+            continue;
+        }
+
+        Blob& blob = blobs[i];
+        uint32_t alignment = writer->alignments[determineFileType(blob.path)];
+        dataOffset += (alignment - dataOffset % alignment) % alignment;
         dataOffsetsBlock.push_back(dataOffset);
         dataOffset += blob.size;
     }
 
-    // Build IO vector.
-    Vector<uint32_t> writeLengths;
-    Vector<void*> writeDatas;
-
-    writeLengths.reserve(5 + blobCount);
-    writeDatas.reserve(5 + blobCount);
-
-    writeLengths.push_back(static_cast<uint32_t>(sizeof(headerBlock)));
-    writeLengths.push_back(pathOffsetsBlockSize);
-    writeLengths.push_back(pathsBlockSize);
-    writeLengths.push_back(metadataBlockSize);
-    writeLengths.push_back(dataOffsetsBlockSize);
+    WritableFile file;
+    if (!makeWritableFile(path, dataOffset, file)) {
+        return false;
+    }
 
-    writeDatas.push_back(&headerBlock);
-    writeDatas.push_back(pathOffsetsBlock.data);
-    writeDatas.push_back(const_cast<char*>(pathsBlock.data));
-    writeDatas.push_back(metadatasBlock.data);
-    writeDatas.push_back(dataOffsetsBlock.data);
+    bool ok = writableFileWrite(file, 0, &headerBlock, sizeof(headerBlock)) &&
+              writableFileWrite(file, headerBlock.pathOffsetsBlockOffset,
+                                pathOffsetsBlock.data, pathOffsetsBlockSize) &&
+              writableFileWrite(file, headerBlock.pathsBlockOffset,
+                                pathsBlock.data, pathsBlockSize) &&
+              writableFileWrite(file, headerBlock.dataOffsetsBlockOffset,
+                                dataOffsetsBlock.data, dataOffsetsBlockSize) &&
+              writableFileWrite(file, headerBlock.lookupBlockOffset,
+                                lookupBlock.data, lookupBlockSize);
+
+    // Blob data is written in parallel. A job holds at most one blob's worth
+    // of memory at a time.
+    if (ok) {
+        ok = JobsForEach(blobCount, [&](size_t i) noexcept {
+            if (duplicateOf[i] != BLOB_NOT_FOUND) {
+                return true;
+            }
+            return writeBlob(file, blobs[i], dataOffsetsBlock[i]);
+        });
+    }
 
-    for (Blob& blob : blobs) {
-        writeLengths.push_back(blob.size);
-        writeDatas.push_back(const_cast<void*>(blob.data));
+    // Checksums are known once every blob has been written.
+    if (ok) {
+        for (uint32_t i = 0; i < blobCount; i++) {
+            Blob& blob = blobs[i];
+            uint32_t checksum = duplicateOf[i] == BLOB_NOT_FOUND
+                                        ? blob.checksum
+                                        : blobs[duplicateOf[i]].checksum;
+            metadatasBlock.push_back({blob.uncompressedSize, blob.size,
+                                      blob.compressionType, checksum});
+        }
+
+        ok = writableFileWrite(file, headerBlock.metadataBlockOffset,
+                               metadatasBlock.data, metadataBlockSize);
     }
 
-    // Write file.
-    return writeFileVec(path,
-                        static_cast<uint32_t>(writeLengths.size),
-                        writeLengths.data,
-                        writeDatas.data);
+    destroyWritableFile(file);
+    return ok;
 }
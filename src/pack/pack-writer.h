@@ -27,6 +27,8 @@
 #ifndef SRC_PACK_PACK_WRITER_H_
 #define SRC_PACK_PACK_WRITER_H_
 
+#include "pack/file-type.h"
+#include "pack/pack-reader.h"
 #include "util/int.h"
 #include "util/noexcept.h"
 #include "util/string-view.h"
@@ -40,9 +42,42 @@ void
 destroyPackWriter(PackWriter* writer) noexcept;
 
 void
-packWriterAddBlob(PackWriter* writer, StringView path, uint32_t size,
+packWriterAddBlob(PackWriter* writer, StringView path, BlobSize size,
         const void* data) noexcept;
 
+// Add a blob whose data has already been compressed with compressionType.
+void
+packWriterAddCompressedBlob(PackWriter* writer, StringView path,
+        BlobSize uncompressedSize, BlobSize compressedSize,
+        BlobCompressionType compressionType, const void* data) noexcept;
+
+// Add a blob whose data is copied from the file at source when the pack is
+// written instead of being held in memory.
+void
+packWriterAddFileBlob(PackWriter* writer, StringView path, StringView source,
+        BlobSize size) noexcept;
+
+// Add a blob that is compressed from the file at source with compressionType
+// when the pack is written. compressedSize must be the size that compression
+// produces.
+void
+packWriterAddCompressedFileBlob(PackWriter* writer, StringView path,
+        StringView source, BlobSize uncompressedSize, BlobSize compressedSize,
+        BlobCompressionType compressionType) noexcept;
+
+// Start the data of each blob of the given type on a multiple of alignment
+// bytes, which must be a power of two.
+void
+packWriterSetAlignment(PackWriter* writer, FileType type, uint32_t alignment)
+        noexcept;
+
+// Lay out the blobs named in trace, a newline-separated list of paths, first
+// and in the order given. Other blobs follow.
+void
+packWriterSetOrder(PackWriter* writer, StringView trace) noexcept;
+
+// Blob data is written from several threads at once. Memory use does not
+// depend on the size of blobs added with packWriterAddFileBlob.
 bool
 packWriterWriteToFile(PackWriter* writer, StringView path) noexcept;
 
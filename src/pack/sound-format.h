@@ -0,0 +1,67 @@
+/********************************
+** Tsunagari Tile Engine       **
+** sound-format.h              **
+** Copyright 2020 Paul Merrill **
+********************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#ifndef SRC_PACK_SOUND_FORMAT_H_
+#define SRC_PACK_SOUND_FORMAT_H_
+
+#include "util/int.h"
+
+// The decoded sound format that `pack-tool create --decode-sounds` turns
+// short sound effects into. A sound at "sounds/step.wav" is decoded to
+// "sounds/step.wav.pcm", and the engine plays that instead when it is there
+// and the audio device uses the same format, without decoding or copying it.
+//
+// A SoundHeader is followed by size bytes of samples. Everything is
+// little-endian.
+
+#define SOUND_EXTENSION ".pcm"
+
+static constexpr uint8_t SOUND_MAGIC[4] = {84, 115, 80, 99};  // "TsPc"
+
+// Increase when the layout changes. The engine falls back to the original
+// sound when a decoded one has a different version.
+static constexpr uint32_t SOUND_VERSION = 1;
+
+// The format the engine opens the audio device with.
+static constexpr uint32_t SOUND_RATE = 44100;
+static constexpr uint32_t SOUND_CHANNELS = 2;
+
+enum SoundFormat {
+    // 16-bit signed samples, interleaved by channel.
+    SOUND_S16LE,
+};
+
+// A multiple of 8 bytes long, so samples stay aligned after it.
+struct SoundHeader {
+    uint8_t magic[4];
+    uint32_t version;
+    uint32_t rate;
+    uint32_t channels;
+    uint32_t format;  // SoundFormat.
+    uint32_t size;    // Bytes of samples after the header.
+};
+
+#endif  // SRC_PACK_SOUND_FORMAT_H_
@@ -0,0 +1,91 @@
+/********************************
+** Tsunagari Tile Engine       **
+** sound-writer.cpp            **
+** Copyright 2020 Paul Merrill **
+********************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#include "pack/sound-writer.h"
+
+#include "os/c.h"
+#include "pack/sound-format.h"
+
+// Sample of channel at frame, reading the first channel for every channel of
+// a mono sound.
+static int32_t
+sampleAt(const int16_t* samples,
+         uint32_t channels,
+         size_t frame,
+         uint32_t channel) noexcept {
+    if (channel >= channels) {
+        channel = 0;
+    }
+    return samples[frame * channels + channel];
+}
+
+void
+makeDecodedSound(uint32_t rate,
+                 uint32_t channels,
+                 const int16_t* samples,
+                 size_t sampleCount,
+                 String& out) noexcept {
+    size_t inFrames = sampleCount / channels;
+    size_t outFrames = static_cast<size_t>(
+            (static_cast<uint64_t>(inFrames) * SOUND_RATE + rate - 1) / rate);
+
+    SoundHeader header;
+    memcpy(header.magic, SOUND_MAGIC, sizeof(header.magic));
+    header.version = SOUND_VERSION;
+    header.rate = SOUND_RATE;
+    header.channels = SOUND_CHANNELS;
+    header.format = SOUND_S16LE;
+    header.size =
+            static_cast<uint32_t>(outFrames * SOUND_CHANNELS * sizeof(int16_t));
+
+    out.resize(sizeof(header) + header.size);
+    memcpy(out.data, &header, sizeof(header));
+
+    char* dst = out.data + sizeof(header);
+
+    for (size_t frame = 0; frame < outFrames; frame++) {
+        // Interpolate linearly between the two nearest input frames, in
+        // fixed point with 16 fractional bits.
+        uint64_t position = (static_cast<uint64_t>(frame) * rate << 16) /
+                            SOUND_RATE;
+        size_t before = static_cast<size_t>(position >> 16);
+        size_t after = before + 1 < inFrames ? before + 1 : before;
+        int64_t fraction = static_cast<int64_t>(position & 0xFFFF);
+
+        for (uint32_t channel = 0; channel < SOUND_CHANNELS; channel++) {
+            int64_t a = sampleAt(samples, channels, before, channel);
+            int64_t b = sampleAt(samples, channels, after, channel);
+            int16_t sample =
+                    static_cast<int16_t>(a + (((b - a) * fraction) >> 16));
+
+            // Little-endian regardless of this machine.
+            uint16_t bits = static_cast<uint16_t>(sample);
+            dst[0] = static_cast<char>(bits & 0xFF);
+            dst[1] = static_cast<char>(bits >> 8);
+            dst += 2;
+        }
+    }
+}
@@ -0,0 +1,45 @@
+/********************************
+** Tsunagari Tile Engine       **
+** sound-writer.h              **
+** Copyright 2020 Paul Merrill **
+********************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#ifndef SRC_PACK_SOUND_WRITER_H_
+#define SRC_PACK_SOUND_WRITER_H_
+
+#include "util/int.h"
+#include "util/noexcept.h"
+#include "util/string.h"
+
+// Build a sound blob in the engine's device format from sampleCount 16-bit
+// samples interleaved by channel, played at rate frames per second. Mono is
+// copied to both channels, only the first two of more channels are kept, and
+// other rates are resampled.
+void
+makeDecodedSound(uint32_t rate,
+                 uint32_t channels,
+                 const int16_t* samples,
+                 size_t sampleCount,
+                 String& out) noexcept;
+
+#endif  // SRC_PACK_SOUND_WRITER_H_
@@ -0,0 +1,69 @@
+/********************************
+** Tsunagari Tile Engine       **
+** texture-format.h            **
+** Copyright 2020 Paul Merrill **
+********************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#ifndef SRC_PACK_TEXTURE_FORMAT_H_
+#define SRC_PACK_TEXTURE_FORMAT_H_
+
+#include "util/int.h"
+
+// The decoded image format that `pack-tool create --decode-images` turns PNGs
+// into. An image at "tiles/forest.png" is decoded to "tiles/forest.png.tex",
+// and the engine uploads that instead when it is there.
+//
+// A TextureHeader is followed by size bytes of pixels, which are compressed
+// if compression is not TEXTURE_COMPRESSION_NONE. Everything is
+// little-endian.
+
+#define TEXTURE_EXTENSION ".tex"
+
+static constexpr uint8_t TEXTURE_MAGIC[4] = {84, 115, 84, 120};  // "TsTx"
+
+// Increase when the layout changes. The engine falls back to the PNG when a
+// decoded image has a different version.
+static constexpr uint32_t TEXTURE_VERSION = 1;
+
+enum TextureFormat {
+    // 8 bits each of red, green, blue, and alpha, in that order in memory.
+    // Rows are from top to bottom with no padding.
+    TEXTURE_RGBA8,
+};
+
+enum TextureCompression {
+    TEXTURE_COMPRESSION_NONE,
+    TEXTURE_COMPRESSION_LZ4,  // One LZ4 block, as in pack/lz4.h.
+};
+
+struct TextureHeader {
+    uint8_t magic[4];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t format;       // TextureFormat.
+    uint32_t compression;  // TextureCompression.
+    uint32_t size;         // Bytes of pixel data after the header.
+};
+
+#endif  // SRC_PACK_TEXTURE_FORMAT_H_
@@ -0,0 +1,67 @@
+/********************************
+** Tsunagari Tile Engine       **
+** texture-writer.cpp          **
+** Copyright 2020 Paul Merrill **
+********************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#include "pack/texture-writer.h"
+
+#include "os/c.h"
+#include "pack/lz4.h"
+
+void
+makeTexture(uint32_t width,
+            uint32_t height,
+            const uint8_t* rgba,
+            TextureCompression compression,
+            String& out) noexcept {
+    size_t size = static_cast<size_t>(width) * height * 4;
+
+    TextureHeader header;
+    memcpy(header.magic, TEXTURE_MAGIC, sizeof(header.magic));
+    header.version = TEXTURE_VERSION;
+    header.width = width;
+    header.height = height;
+    header.format = TEXTURE_RGBA8;
+    header.compression = TEXTURE_COMPRESSION_NONE;
+    header.size = static_cast<uint32_t>(size);
+
+    out.resize(sizeof(header) + size);
+
+    size_t compressedSize = 0;
+    if (compression == TEXTURE_COMPRESSION_LZ4) {
+        compressedSize = lz4Compress(rgba, size, out.data + sizeof(header),
+                                     size);
+    }
+
+    if (compressedSize) {
+        header.compression = TEXTURE_COMPRESSION_LZ4;
+        header.size = static_cast<uint32_t>(compressedSize);
+        out.resize(sizeof(header) + compressedSize);
+    }
+    else {
+        memcpy(out.data + sizeof(header), rgba, size);
+    }
+
+    memcpy(out.data, &header, sizeof(header));
+}
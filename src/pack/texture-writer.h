@@ -0,0 +1,45 @@
+/********************************
+** Tsunagari Tile Engine       **
+** texture-writer.h            **
+** Copyright 2020 Paul Merrill **
+********************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#ifndef SRC_PACK_TEXTURE_WRITER_H_
+#define SRC_PACK_TEXTURE_WRITER_H_
+
+#include "pack/texture-format.h"
+#include "util/int.h"
+#include "util/noexcept.h"
+#include "util/string.h"
+
+// Build a texture blob of width by height RGBA8 pixels. With
+// TEXTURE_COMPRESSION_LZ4, the pixels are stored uncompressed anyway if LZ4
+// doesn't make them smaller.
+void
+makeTexture(uint32_t width,
+            uint32_t height,
+            const uint8_t* rgba,
+            TextureCompression compression,
+            String& out) noexcept;
+
+#endif  // SRC_PACK_TEXTURE_WRITER_H_
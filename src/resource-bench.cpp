@@ -0,0 +1,213 @@
+/********************************
+** Tsunagari Tile Engine       **
+** resource-bench.cpp          **
+** Copyright 2020 Paul Merrill **
+********************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+// Measures how many resourceLoad and resourceRelease pairs per second threads
+// can make at once from an archive, for 1, 2, 4... threads. It links the
+// engine and the null world's data so that it measures the resource layer the
+// game uses, including the decompression cache and its lock.
+
+#include "core/client-conf.h"
+#include "core/log.h"
+#include "core/resources.h"
+#include "data/data-world.h"
+#include "os/c.h"
+#include "os/chrono.h"
+#include "os/mutex.h"
+#include "os/thread.h"
+#include "pack/pack-reader.h"
+#include "util/int.h"
+#include "util/noexcept.h"
+#include "util/string-view.h"
+#include "util/string.h"
+#include "util/string2.h"
+#include "util/vector.h"
+
+struct BenchContext {
+    Vector<String>* paths;
+    size_t passes;
+
+    // If set, every load and release happens while holding mutex, as
+    // resourceLoad once did.
+    bool locked;
+    Mutex mutex;
+};
+
+static uint32_t
+benchLoad(StringView path) noexcept {
+    StringView data;
+    if (!resourceLoad(path, data)) {
+        return 0;
+    }
+    uint32_t x = data.size ? static_cast<uint8_t>(data.data[0]) : 0;
+    resourceRelease(path);
+    return x;
+}
+
+static void
+benchWorker(BenchContext& ctx, uint32_t& sum) noexcept {
+    uint32_t local = 0;
+    for (size_t pass = 0; pass < ctx.passes; pass++) {
+        for (String& path : *ctx.paths) {
+            if (ctx.locked) {
+                LockGuard guard(ctx.mutex);
+                local += benchLoad(path);
+            }
+            else {
+                local += benchLoad(path);
+            }
+        }
+    }
+    sum = local;
+}
+
+// Returns loads per second across all threads, or 0 if there are no paths.
+static uint64_t
+benchRun(BenchContext& ctx, unsigned threadCount) noexcept {
+    if (ctx.paths->size == 0) {
+        return 0;
+    }
+
+    // About a million loads per thread.
+    ctx.passes = 1000000 / ctx.paths->size + 1;
+
+    // Written by each thread so the reads are not optimized away.
+    Vector<uint32_t> sums;
+    sums.resize(threadCount);
+
+    Vector<Thread> threads;
+    threads.reserve(threadCount);
+
+    Nanoseconds start = chronoNow();
+
+    for (unsigned i = 0; i < threadCount; i++) {
+        uint32_t* sum = &sums[i];
+        threads.push_back(Thread([&ctx, sum]() { benchWorker(ctx, *sum); }));
+    }
+    for (Thread& thread : threads) {
+        thread.join();
+    }
+
+    Nanoseconds elapsed = chronoNow() - start;
+    if (elapsed <= 0) {
+        elapsed = 1;
+    }
+
+    uint64_t loads = static_cast<uint64_t>(threadCount) * ctx.passes *
+                     ctx.paths->size;
+    return loads * 1000000000 / static_cast<uint64_t>(elapsed);
+}
+
+int
+main(int argc, char* argv[]) noexcept {
+    unsigned maxThreads = threadHardwareConcurrency();
+    StringView archivePath;
+
+    if (argc == 4 && StringView(argv[1]) == "-t" &&
+        parseUInt(maxThreads, argv[2]) && maxThreads > 0) {
+        archivePath = argv[3];
+    }
+    else if (argc == 2) {
+        archivePath = argv[1];
+    }
+    else {
+        fprintf(stderr,
+                "usage: %s [-t <threads>] <archive>\n"
+                "\n"
+                "Measures how many resourceLoad and resourceRelease pairs per\n"
+                "second 1, 2, 4... threads up to <threads> make at once, both\n"
+                "lock-free and with every call behind one mutex. Files stored\n"
+                "without compression are read from the archive, and compressed\n"
+                "ones through the decompression cache, so each kind is measured\n"
+                "on its own. The default for <threads> is the number of cores.\n",
+                argv[0]);
+        return 1;
+    }
+
+    if (maxThreads == 0) {
+        maxThreads = 1;
+    }
+
+    PackReader* pack = PackReader::fromFile(archivePath);
+    if (!pack) {
+        fprintf(stderr,
+                "%s",
+                (String() << argv[0] << ": " << archivePath << ": not found\n")
+                        .null());
+        return 1;
+    }
+
+    Vector<String> uncompressed;
+    Vector<String> compressed;
+    for (BlobIndex i = 0; i < pack->size(); i++) {
+        if (pack->getBlobCompression(i) == BLOB_COMPRESSION_NONE) {
+            uncompressed.push_back(pack->getBlobPath(i));
+        }
+        else {
+            compressed.push_back(pack->getBlobPath(i));
+        }
+    }
+    delete pack;
+
+    logInit();
+    logSetVerbosity(LogVerbosity::NORMAL);
+
+    dataWorldDatafile = archivePath;
+    if (!resourceInit()) {
+        return 1;
+    }
+
+    String line;
+    line << uncompressed.size << " uncompressed and " << compressed.size
+         << " compressed files\n"
+         << "threads  uncompressed loads/s  compressed loads/s  "
+            "uncompressed locked  compressed locked\n";
+    printf("%s", line.null());
+
+    BenchContext ctx;
+    for (unsigned threadCount = 1;; threadCount *= 2) {
+        if (threadCount > maxThreads) {
+            threadCount = maxThreads;
+        }
+
+        uint64_t results[4];
+        for (int i = 0; i < 4; i++) {
+            ctx.paths = i % 2 ? &compressed : &uncompressed;
+            ctx.locked = i >= 2;
+            results[i] = benchRun(ctx, threadCount);
+        }
+
+        line.clear();
+        line << threadCount << "  " << results[0] << "  " << results[1]
+             << "  " << results[2] << "  " << results[3] << "\n";
+        printf("%s", line.null());
+
+        if (threadCount == maxThreads) {
+            break;
+        }
+    }
+
+    return 0;
+}
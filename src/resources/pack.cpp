@@ -24,22 +24,66 @@
 // IN THE SOFTWARE.
 // **********
 
+#include "core/client-conf.h"
 #include "core/log.h"
 #include "core/measure.h"
 #include "core/resources.h"
 #include "data/data-world.h"
+#include "os/c.h"
 #include "os/mutex.h"
+#include "os/os.h"
+#include "pack/layered-pack-reader.h"
 #include "pack/pack-reader.h"
+#include "util/assert.h"
+#include "util/constexpr.h"
+#include "util/hashtable.h"
 #include "util/int.h"
+#include "util/move.h"
+#include "util/new.h"
+#include "util/vector.h"
 
-static Mutex mutex;
-static PackReader* pack = 0;
+// Compressed blobs are inflated into this cache. Blobs that are in use are
+// never evicted, so the cache may temporarily exceed its budget. Once a blob
+// is released it stays resident until the least-recently-used unreferenced
+// blobs need to make room.
+static constexpr size_t CACHE_BUDGET = 32 * 1024 * 1024;
 
-static bool
-openPackFile() noexcept {
-    if (pack) {
-        return true;
+struct CachedBlob {
+    char* data;
+    size_t size;
+    int numUsers;
+    uint64_t lastUse;
+};
+
+struct EmptyBlobIndex {
+    static BlobIndex
+    value() noexcept {
+        return BLOB_NOT_FOUND;
     }
+};
+
+// Set once by resourceInit before any other thread can load resources, and
+// read-only afterward. Looking up and reading uncompressed blobs needs no
+// lock.
+static PackReader* pack = 0;
+
+typedef Hashmap<BlobIndex, CachedBlob, EmptyBlobIndex> BlobCache;
+
+// Guards cache, cacheSize, and cacheClock.
+static Mutex cacheMutex;
+static BlobCache cache;
+static size_t cacheSize = 0;
+static uint64_t cacheClock = 0;
+
+// Paths already written to confLoadTrace. Each is only recorded the first time
+// it is loaded. Guarded by traceMutex.
+static Mutex traceMutex;
+static Hashmap<String, bool> tracedPaths;
+static bool traceStarted = false;
+
+bool
+resourceInit() noexcept {
+    assert_(!pack);
 
     StringView path = dataWorldDatafile;
 
@@ -52,6 +96,25 @@ openPackFile() noexcept {
         return false;
     }
 
+    if (confPatches.size == 0) {
+        return true;
+    }
+
+    // Mount patches over the world, each overriding those before it.
+    Vector<PackReader*> layers;
+    layers.push_back(pack);
+
+    for (String& patchPath : confPatches) {
+        PackReader* patch = PackReader::fromFile(patchPath);
+        if (!patch) {
+            logErr("PackResources",
+                   String() << patchPath << ": could not open patch");
+            continue;
+        }
+        layers.push_back(patch);
+    }
+
+    pack = makeLayeredPackReader(move_(layers));
     return true;
 }
 
@@ -60,12 +123,118 @@ getFullPath(StringView path) noexcept {
     return String() << dataWorldDatafile << "/" << path;
 }
 
+// Record the first load of each path, in order, so that `pack-tool create
+// --order` can lay out a pack in the order the engine reads it.
+static void
+traceLoad(StringView path) noexcept {
+    LockGuard lock(traceMutex);
+
+    if (!traceStarted) {
+        traceStarted = true;
+        if (!writeFile(confLoadTrace, 0, 0)) {
+            logErr("PackResources",
+                   String() << confLoadTrace << ": could not write trace");
+        }
+    }
+
+    if (tracedPaths.contains(path)) {
+        return;
+    }
+    tracedPaths[String(path)] = true;
+
+    String line;
+    line << path << "\n";
+    appendFile(confLoadTrace, static_cast<uint32_t>(line.size), line.data);
+}
+
+static void
+cacheEvict() noexcept {
+    while (cacheSize > CACHE_BUDGET) {
+        BlobCache::iterator victim = cache.end();
+        for (BlobCache::iterator it = cache.begin(); it != cache.end(); ++it) {
+            if (it->value.numUsers == 0 &&
+                (victim == cache.end() ||
+                 it->value.lastUse < victim->value.lastUse)) {
+                victim = it;
+            }
+        }
+        if (victim == cache.end()) {
+            // Everything left is in use.
+            return;
+        }
+
+        cacheSize -= victim->value.size;
+        free(victim->value.data);
+        cache.erase(victim);
+    }
+}
+
+static bool
+cacheLoad(StringView path, BlobIndex index, StringView& data) noexcept {
+    {
+        LockGuard lock(cacheMutex);
+
+        CachedBlob* cached = cache.tryAt(index);
+        if (cached) {
+            cached->numUsers += 1;
+            cached->lastUse = ++cacheClock;
+            data.data = cached->data;
+            data.size = cached->size;
+            return true;
+        }
+    }
+
+    // Decompress without holding the lock so other threads can use the cache
+    // meanwhile.
+    size_t blobSize = static_cast<size_t>(pack->getBlobSize(index));
+    char* blob = static_cast<char*>(malloc(blobSize));
+
+    {
+        TimeMeasure m(String() << "Decompressed " << path);
+
+        if (!pack->readBlob(index, blob)) {
+            logErr("PackResources",
+                   String() << getFullPath(path) << ": file corrupt");
+            free(blob);
+            return false;
+        }
+    }
+
+    LockGuard lock(cacheMutex);
+
+    // Another thread may have decompressed the same blob first.
+    CachedBlob* cached = cache.tryAt(index);
+    if (cached) {
+        free(blob);
+        cached->numUsers += 1;
+        cached->lastUse = ++cacheClock;
+        data.data = cached->data;
+        data.size = cached->size;
+        return true;
+    }
+
+    cache[index] = {blob, blobSize, 1, ++cacheClock};
+    cacheSize += blobSize;
+    cacheEvict();
+
+    data.data = blob;
+    data.size = blobSize;
+    return true;
+}
+
+bool
+resourceExists(StringView path) noexcept {
+    assert_(pack);
+
+    return pack->findIndex(path) != BLOB_NOT_FOUND;
+}
+
 bool
 resourceLoad(StringView path, StringView& data) noexcept {
-    LockGuard lock(mutex);
+    assert_(pack);
 
-    if (!openPackFile()) {
-        return false;
+    if (confLoadTrace.size) {
+        traceLoad(path);
     }
 
     BlobIndex index = pack->findIndex(path);
@@ -76,18 +245,140 @@ resourceLoad(StringView path, StringView& data) noexcept {
         return false;
     }
 
-    uint32_t blobSize = pack->getBlobSize(index);
+    BlobSize blobSize = pack->getBlobSize(index);
 
     // Will it fit in memory?
-    if (blobSize > static_cast<uint32_t>(INT32_MAX)) {
+    if (blobSize > static_cast<BlobSize>(INT32_MAX)) {
         logErr("PackResources",
-               String() << getFullPath(path) << ": file too large");
+               String() << getFullPath(path)
+                        << ": file too large, use resourceStreamOpen");
         return false;
     }
 
+    if (pack->getBlobCompression(index) != BLOB_COMPRESSION_NONE) {
+        return cacheLoad(path, index, data);
+    }
+
     void* blob = pack->getBlobData(index);
 
     data.data = static_cast<char*>(blob);
-    data.size = blobSize;
+    data.size = static_cast<size_t>(blobSize);
     return true;
 }
+
+struct ResourceStream {
+    BlobIndex index;
+    BlobSize size;
+    // Compressed blobs are inflated whole into the cache and read from
+    // there, others are read straight from the archive.
+    StringView cached;
+};
+
+ResourceStream*
+resourceStreamOpen(StringView path) noexcept {
+    assert_(pack);
+
+    if (confLoadTrace.size) {
+        traceLoad(path);
+    }
+
+    BlobIndex index = pack->findIndex(path);
+
+    if (index == BLOB_NOT_FOUND) {
+        logErr("PackResources",
+               String() << getFullPath(path) << ": file missing");
+        return 0;
+    }
+
+    StringView cached;
+    if (pack->getBlobCompression(index) != BLOB_COMPRESSION_NONE) {
+        if (!cacheLoad(path, index, cached)) {
+            return 0;
+        }
+    }
+
+    ResourceStream* stream =
+            static_cast<ResourceStream*>(malloc(sizeof(ResourceStream)));
+    new (stream) ResourceStream;
+    stream->index = index;
+    stream->size = pack->getBlobSize(index);
+    stream->cached = cached;
+    return stream;
+}
+
+uint64_t
+resourceStreamSize(ResourceStream* stream) noexcept {
+    return stream->size;
+}
+
+bool
+resourceStreamRead(ResourceStream* stream,
+                   uint64_t offset,
+                   size_t size,
+                   void* buf) noexcept {
+    if (offset > stream->size || size > stream->size - offset) {
+        return false;
+    }
+
+    if (stream->cached.data) {
+        memcpy(buf, stream->cached.data + offset, size);
+        return true;
+    }
+
+    return pack->readBlobRange(stream->index, offset, size, buf);
+}
+
+void
+resourceStreamClose(ResourceStream* stream) noexcept {
+    if (stream->cached.data) {
+        LockGuard lock(cacheMutex);
+        CachedBlob* cached = cache.tryAt(stream->index);
+        assert_(cached && cached->numUsers > 0);
+        cached->numUsers -= 1;
+        cacheEvict();
+    }
+
+    stream->~ResourceStream();
+    free(stream);
+}
+
+void
+resourceRelease(StringView path) noexcept {
+    assert_(pack);
+
+    BlobIndex index = pack->findIndex(path);
+    if (index == BLOB_NOT_FOUND) {
+        return;
+    }
+
+    // Uncompressed blobs point into the archive and are not cached.
+    if (pack->getBlobCompression(index) == BLOB_COMPRESSION_NONE) {
+        return;
+    }
+
+    LockGuard lock(cacheMutex);
+
+    CachedBlob* cached = cache.tryAt(index);
+    if (!cached) {
+        return;
+    }
+
+    assert_(cached->numUsers > 0);
+    cached->numUsers -= 1;
+
+    cacheEvict();
+}
+
+void
+resourcePrefetch(Vector<String>& paths) noexcept {
+    assert_(pack);
+
+    Vector<BlobIndex> indices;
+    indices.reserve(paths.size);
+
+    for (String& path : paths) {
+        indices.push_back(pack->findIndex(path));
+    }
+
+    pack->prefetch(indices.data, indices.size);
+}
@@ -0,0 +1,118 @@
+/********************************
+** Tsunagari Tile Engine       **
+** base64.cpp                  **
+** Copyright 2020 Paul Merrill **
+********************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#include "util/base64.h"
+
+#include "util/int.h"
+#include "util/noexcept.h"
+#include "util/string-view.h"
+
+// The value of each base64 digit, or 64 if the character is not one.
+static const uint8_t digitValues[256] = {
+#define X 64
+        X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,
+        X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,
+        X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  62, X,  X,  X,  63,
+        52, 53, 54, 55, 56, 57, 58, 59, 60, 61, X,  X,  X,  X,  X,  X,
+        X,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9,  10, 11, 12, 13, 14,
+        15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, X,  X,  X,  X,  X,
+        X,  26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+        41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, X,  X,  X,  X,  X,
+        X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,
+        X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,
+        X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,
+        X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,
+        X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,
+        X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,
+        X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,
+        X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,
+#undef X
+};
+
+size_t
+base64DecodedSize(StringView text) noexcept {
+    if (text.size % 4 != 0) {
+        return 0;
+    }
+
+    size_t size = text.size / 4 * 3;
+    if (text.size && text.data[text.size - 1] == '=') {
+        size--;
+    }
+    if (text.size && text.data[text.size - 2] == '=') {
+        size--;
+    }
+    return size;
+}
+
+bool
+base64Decode(StringView text, uint8_t* out) noexcept {
+    if (text.size % 4 != 0) {
+        return false;
+    }
+
+    const uint8_t* in = reinterpret_cast<const uint8_t*>(text.data);
+    const uint8_t* end = in + text.size;
+
+    // All groups but the last have no padding.
+    const uint8_t* last = text.size ? end - 4 : end;
+    for (; in < last; in += 4) {
+        uint32_t a = digitValues[in[0]];
+        uint32_t b = digitValues[in[1]];
+        uint32_t c = digitValues[in[2]];
+        uint32_t d = digitValues[in[3]];
+        if ((a | b | c | d) & 64) {
+            return false;
+        }
+
+        uint32_t group = (a << 18) | (b << 12) | (c << 6) | d;
+        *out++ = static_cast<uint8_t>(group >> 16);
+        *out++ = static_cast<uint8_t>(group >> 8);
+        *out++ = static_cast<uint8_t>(group);
+    }
+
+    if (in == end) {
+        return true;
+    }
+
+    uint32_t a = digitValues[in[0]];
+    uint32_t b = digitValues[in[1]];
+    uint32_t c = in[2] == '=' ? 0 : digitValues[in[2]];
+    uint32_t d = in[3] == '=' ? 0 : digitValues[in[3]];
+    if ((a | b | c | d) & 64 || (in[2] == '=' && in[3] != '=')) {
+        return false;
+    }
+
+    uint32_t group = (a << 18) | (b << 12) | (c << 6) | d;
+    *out++ = static_cast<uint8_t>(group >> 16);
+    if (in[2] != '=') {
+        *out++ = static_cast<uint8_t>(group >> 8);
+    }
+    if (in[3] != '=') {
+        *out++ = static_cast<uint8_t>(group);
+    }
+    return true;
+}
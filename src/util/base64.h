@@ -0,0 +1,43 @@
+/********************************
+** Tsunagari Tile Engine       **
+** base64.h                    **
+** Copyright 2020 Paul Merrill **
+********************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#ifndef SRC_UTIL_BASE64_H_
+#define SRC_UTIL_BASE64_H_
+
+#include "util/int.h"
+#include "util/noexcept.h"
+#include "util/string-view.h"
+
+// The number of bytes text decodes to, or zero if it is not validly padded.
+size_t
+base64DecodedSize(StringView text) noexcept;
+
+// Decode base64 text into out, which must have room for
+// base64DecodedSize(text) bytes. Returns false if text is malformed.
+bool
+base64Decode(StringView text, uint8_t* out) noexcept;
+
+#endif  // SRC_UTIL_BASE64_H_
@@ -0,0 +1,72 @@
+/********************************
+** Tsunagari Tile Engine       **
+** bitset.h                    **
+** Copyright 2020 Paul Merrill **
+********************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#ifndef SRC_UTIL_BITSET_H_
+#define SRC_UTIL_BITSET_H_
+
+#include "util/int.h"
+#include "util/noexcept.h"
+#include "util/vector.h"
+
+// An array of bits, all clear until set. Bits past the end read as clear.
+class Bitset {
+ public:
+    // Make room for at least n bits. New bits are clear.
+    void
+    resize(size_t n) noexcept {
+        size_t count = (n + 31) / 32;
+        if (words.size < count) {
+            words.resize(count);
+        }
+    }
+
+    bool
+    test(size_t i) noexcept {
+        size_t word = i / 32;
+        return word < words.size && ((words[word] >> (i % 32)) & 1) != 0;
+    }
+
+    void
+    set(size_t i) noexcept {
+        words[i / 32] |= 1u << (i % 32);
+    }
+
+    void
+    reset(size_t i) noexcept {
+        words[i / 32] &= ~(1u << (i % 32));
+    }
+
+    // Bytes allocated for the bits.
+    size_t
+    memoryUsage() noexcept {
+        return words.capacity * sizeof(uint32_t);
+    }
+
+ private:
+    Vector<uint32_t> words;
+};
+
+#endif  // SRC_UTIL_BITSET_H_
@@ -155,11 +155,24 @@ class Function<R(ArgTypes...) noexcept> {
         return reinterpret_cast<base*>(p);
     }
 
+    // Small callables live inside buf. Vector relocates its elements with
+    // memmove, so a pointer into our own buf would go stale after a move;
+    // "local" records that the callable is in buf and the pointer to it is
+    // recomputed on every use.
     Align<void* [3]> buf;
     base* f;
+    bool local;
+
+    base*
+    get() const noexcept {
+        return local ? asBase(const_cast<Align<void* [3]>*>(&buf)) : f;
+    }
+
+    void
+    takeFrom(Function& other) noexcept;
 
  public:
-    inline Function() noexcept : f(0) {}
+    inline Function() noexcept : f(0), local(false) {}
     Function(const Function&) noexcept;
     Function(Function&&) noexcept;
     template<class F>
@@ -188,44 +201,55 @@ class Function<R(ArgTypes...) noexcept> {
     void
     swap(Function&) noexcept;
 
-    inline explicit operator bool() const noexcept { return f != 0; }
+    inline explicit operator bool() const noexcept { return local || f != 0; }
 
     R
     operator()(ArgTypes...) const noexcept;
 };
 
 template<class R, class... ArgTypes>
-Function<R(ArgTypes...) noexcept>::Function(const Function& other) noexcept {
-    if (other.f == 0) {
+void
+Function<R(ArgTypes...) noexcept>::takeFrom(Function& other) noexcept {
+    if (other.local) {
+        other.get()->clone(asBase(&buf));
+        other.get()->destroy();
         f = 0;
-    }
-    else if ((void*)other.f == &other.buf) {
-        f = asBase(&buf);
-        other.f->clone(f);
+        local = true;
+        other.local = false;
     }
     else {
-        f = other.f->clone();
+        f = other.f;
+        local = false;
+        other.f = 0;
     }
 }
 
 template<class R, class... ArgTypes>
-Function<R(ArgTypes...) noexcept>::Function(Function&& other) noexcept {
-    if (other.f == 0) {
+Function<R(ArgTypes...) noexcept>::Function(const Function& other) noexcept {
+    if (other.local) {
+        other.get()->clone(asBase(&buf));
         f = 0;
+        local = true;
     }
-    else if ((void*)other.f == &other.buf) {
-        f = asBase(&buf);
-        other.f->clone(f);
+    else if (other.f == 0) {
+        f = 0;
+        local = false;
     }
     else {
-        f = other.f;
-        other.f = 0;
+        f = other.f->clone();
+        local = false;
     }
 }
 
+template<class R, class... ArgTypes>
+Function<R(ArgTypes...) noexcept>::Function(Function&& other) noexcept {
+    takeFrom(other);
+}
+
 template<class R, class... ArgTypes>
 template<class F>
-Function<R(ArgTypes...) noexcept>::Function(F something) noexcept : f(0) {
+Function<R(ArgTypes...) noexcept>::Function(F something) noexcept
+        : f(0), local(false) {
     set(something);
 }
 
@@ -236,8 +260,10 @@ Function<R(ArgTypes...) noexcept>::set(
         F& something,
         EnableIf<sizeof(function::func<F, R(ArgTypes...) noexcept>) <=
                  sizeof(buf)>) noexcept {
-    f = new ((void*)&buf)
+    new ((void*)&buf)
             function::func<F, R(ArgTypes...) noexcept>(static_cast<F&&>(something));
+    f = 0;
+    local = true;
 }
 
 template<class R, class... ArgTypes>
@@ -253,6 +279,7 @@ Function<R(ArgTypes...) noexcept>::set(
     void* buf = malloc(sizeof(T));
     new (buf) T(static_cast<F&&>(something));
     f = reinterpret_cast<T*>(buf);
+    local = false;
 }
 
 template<class R, class... ArgTypes>
@@ -265,18 +292,11 @@ Function<R(ArgTypes...) noexcept>::operator=(const Function& other) noexcept {
 template<class R, class... ArgTypes>
 Function<R(ArgTypes...) noexcept>&
 Function<R(ArgTypes...) noexcept>::operator=(Function&& other) noexcept {
-    this->~Function();
-    if (other.f == 0) {
-        f = 0;
-    }
-    else if ((void*)other.f == &other.buf) {
-        f = asBase(&buf);
-        other.f->clone(f);
-    }
-    else {
-        f = other.f;
-        other.f = 0;
+    if (&other == this) {
+        return *this;
     }
+    this->~Function();
+    takeFrom(other);
     return *this;
 }
 
@@ -290,8 +310,8 @@ Function<R(ArgTypes...) noexcept>::operator=(F&& other) noexcept {
 
 template<class R, class... ArgTypes>
 Function<R(ArgTypes...) noexcept>::~Function() noexcept {
-    if ((void*)f == &buf) {
-        f->destroy();
+    if (local) {
+        get()->destroy();
     }
     else if (f) {
         f->destroyDeallocate();
@@ -305,42 +325,16 @@ Function<R(ArgTypes...) noexcept>::swap(Function& other) noexcept {
         return;
     }
 
-    if ((void*)f == &buf && (void*)other.f == &other.buf) {
-        alignas(alignof(void* [3])) char tempbuf[3 * sizeof(void*)];
-        base* t = asBase(&tempbuf);
-        f->clone(t);
-        f->destroy();
-        f = 0;
-        other.f->clone(asBase(&buf));
-        other.f->destroy();
-        other.f = 0;
-        f = asBase(&buf);
-        t->clone(asBase(&other.buf));
-        t->destroy();
-        other.f = asBase(&other.buf);
-    }
-    else if ((void*)f == &buf) {
-        f->clone(asBase(&other.buf));
-        f->destroy();
-        f = other.f;
-        other.f = asBase(&other.buf);
-    }
-    else if ((void*)other.f == &other.buf) {
-        other.f->clone(asBase(&buf));
-        other.f->destroy();
-        other.f = f;
-        f = asBase(&buf);
-    }
-    else {
-        swap_(f, other.f);
-    }
+    Function temp(move_(other));
+    other.takeFrom(*this);
+    takeFrom(temp);
 }
 
 template<class R, class... ArgTypes>
 R
 Function<R(ArgTypes...) noexcept>::operator()(ArgTypes... args) const noexcept {
-    assert_(f != 0);
-    return (*f)(forward_<ArgTypes>(args)...);
+    assert_(local || f != 0);
+    return (*get())(forward_<ArgTypes>(args)...);
 }
 
 #pragma warning(pop)
@@ -26,10 +26,25 @@
 
 #include "util/hash.h"
 
+#include "os/c.h"
+#include "util/int.h"
 #include "util/noexcept.h"
 
 size_t
 hash_(float d) noexcept {
-    char* bits = reinterpret_cast<char*>(&d);
-    return *reinterpret_cast<size_t*>(bits);
+    uint32_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    return static_cast<size_t>(bits);
+}
+
+size_t
+hash_(uint32_t x) noexcept {
+    // Murmur3's finalizer. Hashmap masks off the low bits, so they need to
+    // depend on every bit of the input.
+    x ^= x >> 16;
+    x *= 0x85ebca6b;
+    x ^= x >> 13;
+    x *= 0xc2b2ae35;
+    x ^= x >> 16;
+    return static_cast<size_t>(x);
 }
@@ -37,4 +37,7 @@ hash_(const T&) noexcept;
 size_t
 hash_(float d) noexcept;
 
+size_t
+hash_(uint32_t x) noexcept;
+
 #endif  // SRC_UTIL_HASH_H_
@@ -55,6 +55,7 @@
 #include "util/hash.h"
 #include "util/int.h"
 #include "util/math2.h"
+#include "util/new.h"
 #include "util/noexcept.h"
 
 /*
@@ -141,6 +142,7 @@ class Hashmap {
     Hashmap(size_t bucketCount = 0) noexcept {
         size = 0;
         capacity = 0;
+        data = 0;
 
         if (bucketCount) {
             capacity = pow2(bucketCount);
@@ -224,6 +226,9 @@ class Hashmap {
     iterator
     find(const K& k) noexcept {
         assert_(k != E::value());  // Empty key shouldn't be used.
+        if (capacity == 0) {
+            return end();
+        }
         for (size_t idx = keyToIdx(k);; idx = probe(idx)) {
             if (data[idx].key == E::value()) {
                 return end();
@@ -251,6 +256,11 @@ class Hashmap {
     }
 
     // Utility
+    size_t
+    memoryUsage() noexcept {
+        return capacity * sizeof(Entry);
+    }
+
     void
     reserve(size_t size) noexcept {
         // Only allow a 50% load limit.
@@ -0,0 +1,471 @@
+/********************************
+** Tsunagari Tile Engine       **
+** inflate.cpp                 **
+** Copyright 2020 Paul Merrill **
+********************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+// A small decoder for DEFLATE (RFC 1951), after Mark Adler's puff.c.
+// Huffman codes are decoded a bit at a time, which is fast enough for the
+// tile layer data it is used on.
+
+#include "util/inflate.h"
+
+#include "util/int.h"
+#include "util/noexcept.h"
+
+#define MAX_BITS 15
+#define MAX_LITERAL_CODES 286
+#define MAX_DISTANCE_CODES 30
+#define FIXED_LITERAL_CODES 288
+
+struct Input {
+    const uint8_t* data;
+    const uint8_t* end;
+    uint32_t bits;  // Bits read from data but not yet used.
+    int bitCount;
+    bool overrun;  // Whether we tried to read past end.
+};
+
+struct Output {
+    uint8_t* data;
+    size_t size;
+    size_t used;
+};
+
+struct Huffman {
+    uint16_t counts[MAX_BITS + 1];  // Number of codes of each length.
+    uint16_t symbols[FIXED_LITERAL_CODES];  // Ordered by code.
+};
+
+static const uint16_t lengthBases[29] = {
+        3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+        31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t lengthExtras[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1,
+                                         1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+                                         4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t distanceBases[30] = {
+        1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+        33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+        1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t distanceExtras[30] = {0, 0, 0,  0,  1,  1,  2,  2,
+                                           3, 3, 4,  4,  5,  5,  6,  6,
+                                           7, 7, 8,  8,  9,  9,  10, 10,
+                                           11, 11, 12, 12, 13, 13};
+
+// The order code length code lengths are sent in.
+static const uint8_t codeLengthOrder[19] = {16, 17, 18, 0, 8,  7, 9,  6, 10, 5,
+                                            11, 4,  12, 3, 13, 2, 14, 1, 15};
+
+static uint32_t
+getBits(Input& in, int count) noexcept {
+    while (in.bitCount < count) {
+        uint32_t byte = 0;
+        if (in.data < in.end) {
+            byte = *in.data++;
+        }
+        else {
+            in.overrun = true;
+        }
+        in.bits |= byte << in.bitCount;
+        in.bitCount += 8;
+    }
+
+    uint32_t value = in.bits & ((1u << count) - 1);
+    in.bits >>= count;
+    in.bitCount -= count;
+    return value;
+}
+
+// Build a canonical Huffman code from the length of each symbol's code.
+// Returns false if the lengths describe more codes than can exist.
+static bool
+buildHuffman(Huffman& h, const uint8_t* lengths, int symbolCount) noexcept {
+    for (int len = 0; len <= MAX_BITS; len++) {
+        h.counts[len] = 0;
+    }
+    for (int symbol = 0; symbol < symbolCount; symbol++) {
+        h.counts[lengths[symbol]]++;
+    }
+    h.counts[0] = 0;
+
+    int left = 1;
+    for (int len = 1; len <= MAX_BITS; len++) {
+        left <<= 1;
+        left -= h.counts[len];
+        if (left < 0) {
+            return false;
+        }
+    }
+
+    uint16_t offsets[MAX_BITS + 1];
+    offsets[1] = 0;
+    for (int len = 1; len < MAX_BITS; len++) {
+        offsets[len + 1] = offsets[len] + h.counts[len];
+    }
+
+    for (int symbol = 0; symbol < symbolCount; symbol++) {
+        if (lengths[symbol]) {
+            h.symbols[offsets[lengths[symbol]]++] = symbol;
+        }
+    }
+    return true;
+}
+
+// Returns -1 for codes that are not in h.
+static int
+decodeSymbol(Input& in, Huffman& h) noexcept {
+    int code = 0;   // Bits read so far.
+    int first = 0;  // First code of the current length.
+    int index = 0;  // Index of the first code of the current length.
+
+    for (int len = 1; len <= MAX_BITS; len++) {
+        code |= getBits(in, 1);
+        int count = h.counts[len];
+        if (code - count < first) {
+            return h.symbols[index + (code - first)];
+        }
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+    return -1;
+}
+
+static bool
+inflateStored(Input& in, Output& out) noexcept {
+    // Skip to the next byte boundary. Whole bytes are never left unused.
+    in.bits = 0;
+    in.bitCount = 0;
+
+    if (in.end - in.data < 4) {
+        return false;
+    }
+    size_t len = in.data[0] | (in.data[1] << 8);
+    size_t nlen = in.data[2] | (in.data[3] << 8);
+    in.data += 4;
+    if (len != (~nlen & 0xFFFF)) {
+        return false;
+    }
+
+    if (static_cast<size_t>(in.end - in.data) < len ||
+        out.size - out.used < len) {
+        return false;
+    }
+    for (size_t i = 0; i < len; i++) {
+        out.data[out.used++] = *in.data++;
+    }
+    return true;
+}
+
+static bool
+inflateCodes(Input& in,
+             Output& out,
+             Huffman& literals,
+             Huffman& distances) noexcept {
+    while (true) {
+        int symbol = decodeSymbol(in, literals);
+        if (symbol < 0 || in.overrun) {
+            return false;
+        }
+
+        if (symbol < 256) {
+            if (out.used == out.size) {
+                return false;
+            }
+            out.data[out.used++] = static_cast<uint8_t>(symbol);
+            continue;
+        }
+        if (symbol == 256) {
+            return true;
+        }
+
+        symbol -= 257;
+        if (symbol >= 29) {
+            return false;
+        }
+        size_t len = lengthBases[symbol] + getBits(in, lengthExtras[symbol]);
+
+        symbol = decodeSymbol(in, distances);
+        if (symbol < 0 || symbol >= 30) {
+            return false;
+        }
+        size_t distance =
+                distanceBases[symbol] + getBits(in, distanceExtras[symbol]);
+
+        if (distance > out.used || out.size - out.used < len) {
+            return false;
+        }
+
+        // The source and destination may overlap.
+        uint8_t* from = out.data + out.used - distance;
+        uint8_t* to = out.data + out.used;
+        for (size_t i = 0; i < len; i++) {
+            to[i] = from[i];
+        }
+        out.used += len;
+    }
+}
+
+static bool
+inflateFixed(Input& in, Output& out) noexcept {
+    uint8_t lengths[FIXED_LITERAL_CODES];
+    Huffman literals, distances;
+
+    int symbol = 0;
+    for (; symbol < 144; symbol++) {
+        lengths[symbol] = 8;
+    }
+    for (; symbol < 256; symbol++) {
+        lengths[symbol] = 9;
+    }
+    for (; symbol < 280; symbol++) {
+        lengths[symbol] = 7;
+    }
+    for (; symbol < FIXED_LITERAL_CODES; symbol++) {
+        lengths[symbol] = 8;
+    }
+    buildHuffman(literals, lengths, FIXED_LITERAL_CODES);
+
+    for (symbol = 0; symbol < MAX_DISTANCE_CODES; symbol++) {
+        lengths[symbol] = 5;
+    }
+    buildHuffman(distances, lengths, MAX_DISTANCE_CODES);
+
+    return inflateCodes(in, out, literals, distances);
+}
+
+static bool
+inflateDynamic(Input& in, Output& out) noexcept {
+    uint8_t lengths[MAX_LITERAL_CODES + MAX_DISTANCE_CODES];
+    Huffman literals, distances;
+
+    int literalCount = getBits(in, 5) + 257;
+    int distanceCount = getBits(in, 5) + 1;
+    int codeLengthCount = getBits(in, 4) + 4;
+    if (literalCount > MAX_LITERAL_CODES ||
+        distanceCount > MAX_DISTANCE_CODES) {
+        return false;
+    }
+
+    // First, the code that the other codes' lengths are sent with.
+    int i = 0;
+    for (; i < codeLengthCount; i++) {
+        lengths[codeLengthOrder[i]] = getBits(in, 3);
+    }
+    for (; i < 19; i++) {
+        lengths[codeLengthOrder[i]] = 0;
+    }
+    if (!buildHuffman(literals, lengths, 19)) {
+        return false;
+    }
+
+    // Then the literal/length and distance code lengths, run-length encoded.
+    int total = literalCount + distanceCount;
+    for (i = 0; i < total;) {
+        int symbol = decodeSymbol(in, literals);
+        if (symbol < 0 || in.overrun) {
+            return false;
+        }
+
+        if (symbol < 16) {
+            lengths[i++] = symbol;
+            continue;
+        }
+
+        uint8_t len = 0;
+        int repeat;
+        if (symbol == 16) {
+            if (i == 0) {
+                return false;
+            }
+            len = lengths[i - 1];
+            repeat = 3 + getBits(in, 2);
+        }
+        else if (symbol == 17) {
+            repeat = 3 + getBits(in, 3);
+        }
+        else {
+            repeat = 11 + getBits(in, 7);
+        }
+
+        if (i + repeat > total) {
+            return false;
+        }
+        while (repeat--) {
+            lengths[i++] = len;
+        }
+    }
+
+    // A block must be able to end.
+    if (lengths[256] == 0) {
+        return false;
+    }
+
+    if (!buildHuffman(literals, lengths, literalCount) ||
+        !buildHuffman(distances, lengths + literalCount, distanceCount)) {
+        return false;
+    }
+
+    return inflateCodes(in, out, literals, distances);
+}
+
+// Decompress raw DEFLATE data. On success, in.data is just past the end of
+// the compressed data.
+static bool
+inflate(Input& in, Output& out) noexcept {
+    bool last;
+    do {
+        last = getBits(in, 1);
+        uint32_t type = getBits(in, 2);
+
+        bool ok;
+        switch (type) {
+        case 0:
+            ok = inflateStored(in, out);
+            break;
+        case 1:
+            ok = inflateFixed(in, out);
+            break;
+        case 2:
+            ok = inflateDynamic(in, out);
+            break;
+        default:
+            ok = false;
+            break;
+        }
+
+        if (!ok || in.overrun) {
+            return false;
+        }
+    } while (!last);
+
+    return out.used == out.size;
+}
+
+static uint32_t
+adler32(const uint8_t* data, size_t size) noexcept {
+    uint32_t a = 1, b = 0;
+    while (size) {
+        // The largest run that cannot overflow before the modulo.
+        size_t run = size < 5552 ? size : 5552;
+        size -= run;
+        while (run--) {
+            a += *data++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+bool
+zlibDecompress(const uint8_t* in,
+               size_t inSize,
+               uint8_t* out,
+               size_t outSize) noexcept {
+    if (inSize < 6) {
+        return false;
+    }
+
+    // Compression method 8 is DEFLATE. Preset dictionaries are not supported.
+    uint8_t cmf = in[0];
+    uint8_t flg = in[1];
+    if ((cmf & 0x0F) != 8 || ((cmf << 8) | flg) % 31 != 0 || (flg & 0x20)) {
+        return false;
+    }
+
+    Input input = {in + 2, in + inSize, 0, 0, false};
+    Output output = {out, outSize, 0};
+    if (!inflate(input, output)) {
+        return false;
+    }
+
+    if (input.end - input.data < 4) {
+        return false;
+    }
+    const uint8_t* p = input.data;
+    uint32_t checksum = (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) |
+                        (p[2] << 8) | p[3];
+    return checksum == adler32(out, outSize);
+}
+
+bool
+gzipDecompress(const uint8_t* in,
+               size_t inSize,
+               uint8_t* out,
+               size_t outSize) noexcept {
+    const uint8_t* end = in + inSize;
+
+    if (inSize < 18 || in[0] != 31 || in[1] != 139 || in[2] != 8) {
+        return false;
+    }
+
+    uint8_t flags = in[3];
+    const uint8_t* p = in + 10;
+
+    if (flags & 4) {  // FEXTRA
+        if (end - p < 2) {
+            return false;
+        }
+        size_t extraSize = p[0] | (p[1] << 8);
+        p += 2;
+        if (static_cast<size_t>(end - p) < extraSize) {
+            return false;
+        }
+        p += extraSize;
+    }
+    for (int field = 8; field <= 16; field <<= 1) {  // FNAME, FCOMMENT
+        if (flags & field) {
+            while (p < end && *p) {
+                p++;
+            }
+            if (p == end) {
+                return false;
+            }
+            p++;
+        }
+    }
+    if (flags & 2) {  // FHCRC
+        p += 2;
+    }
+    if (p > end) {
+        return false;
+    }
+
+    Input input = {p, end, 0, 0, false};
+    Output output = {out, outSize, 0};
+    if (!inflate(input, output)) {
+        return false;
+    }
+
+    // The trailer holds a CRC-32, which we do not check, and the size.
+    if (input.end - input.data < 8) {
+        return false;
+    }
+    const uint8_t* size = input.data + 4;
+    uint32_t storedSize = size[0] | (size[1] << 8) | (size[2] << 16) |
+                          (static_cast<uint32_t>(size[3]) << 24);
+    return storedSize == static_cast<uint32_t>(outSize);
+}
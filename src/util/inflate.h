@@ -0,0 +1,49 @@
+/********************************
+** Tsunagari Tile Engine       **
+** inflate.h                   **
+** Copyright 2020 Paul Merrill **
+********************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#ifndef SRC_UTIL_INFLATE_H_
+#define SRC_UTIL_INFLATE_H_
+
+#include "util/int.h"
+#include "util/noexcept.h"
+
+// Decompress a zlib stream (RFC 1950) into out. Returns false if the stream
+// is corrupt or does not decompress to exactly outSize bytes.
+bool
+zlibDecompress(const uint8_t* in,
+               size_t inSize,
+               uint8_t* out,
+               size_t outSize) noexcept;
+
+// Decompress a gzip stream (RFC 1952) into out. Returns false if the stream
+// is corrupt or does not decompress to exactly outSize bytes.
+bool
+gzipDecompress(const uint8_t* in,
+               size_t inSize,
+               uint8_t* out,
+               size_t outSize) noexcept;
+
+#endif  // SRC_UTIL_INFLATE_H_
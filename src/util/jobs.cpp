@@ -141,3 +141,47 @@ JobsFlush() noexcept {
     workers.clear();
     tearingDown = false;
 }
+
+struct ForEachContext {
+    size_t count;
+    Function<bool(size_t) noexcept> op;
+    size_t next;  // Next index to process.
+    bool ok;
+    Mutex mutex;  // Guards next and ok.
+};
+
+static void
+forEachWorker(ForEachContext& ctx) noexcept {
+    while (true) {
+        size_t i;
+        {
+            LockGuard guard(ctx.mutex);
+            if (!ctx.ok || ctx.next == ctx.count) {
+                return;
+            }
+            i = ctx.next++;
+        }
+
+        if (!ctx.op(i)) {
+            LockGuard guard(ctx.mutex);
+            ctx.ok = false;
+        }
+    }
+}
+
+bool
+JobsForEach(size_t count, Function<bool(size_t) noexcept> op) noexcept {
+    ForEachContext ctx;
+    ctx.count = count;
+    ctx.op = static_cast<Function<bool(size_t) noexcept>&&>(op);
+    ctx.next = 0;
+    ctx.ok = true;
+
+    size_t jobCount = threadHardwareConcurrency();
+    for (size_t i = 0; i < jobCount; i++) {
+        JobsEnqueue([&ctx]() noexcept { forEachWorker(ctx); });
+    }
+    JobsFlush();
+
+    return ctx.ok;
+}
@@ -28,6 +28,7 @@
 #define SRC_UTIL_JOBS_H_
 
 #include "util/function.h"
+#include "util/int.h"
 #include "util/noexcept.h"
 
 typedef Function<void() noexcept> Job;
@@ -37,4 +38,10 @@ JobsEnqueue(Job job) noexcept;
 void
 JobsFlush() noexcept;
 
+// Call op on every index below count from one job per core, each taking the
+// next index until none are left. Stops early and returns false if op returns
+// false. Flushes the job queue.
+bool
+JobsForEach(size_t count, Function<bool(size_t) noexcept> op) noexcept;
+
 #endif  // SRC_UTIL_JOBS_H_
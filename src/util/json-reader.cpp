@@ -0,0 +1,409 @@
+/********************************
+** Tsunagari Tile Engine       **
+** json-reader.cpp             **
+** Copyright 2020 Paul Merrill **
+********************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#include "util/json-reader.h"
+
+#include "os/c.h"
+#include "util/decimal.h"
+
+static inline bool
+isdigit(char c) noexcept {
+    return c >= '0' && c <= '9';
+}
+
+static inline bool
+isxdigit(char c) noexcept {
+    return (c >= '0' && c <= '9') || ((c & ~' ') >= 'A' && (c & ~' ') <= 'F');
+}
+
+static inline int
+char2int(char c) noexcept {
+    if (c <= '9') {
+        return c - '0';
+    }
+    return (c & ~' ') - 'A' + 10;
+}
+
+static inline bool
+isNumberChar(char c) noexcept {
+    return isdigit(c) || c == '-' || c == '+' || c == '.' || c == 'e' ||
+           c == 'E';
+}
+
+static inline bool
+isLiteral(const char* p, const char* end, StringView literal) noexcept {
+    return static_cast<size_t>(end - p) >= literal.size &&
+           memcmp(p, literal.data, literal.size) == 0;
+}
+
+JsonReader::JsonReader(StringView text) noexcept
+        : number(0),
+          p(text.data),
+          end(text.data + text.size),
+          valueStart(text.data),
+          keyStart(0),
+          last(JSON_TOKEN_END),
+          depth(0),
+          first(false),
+          started(false) {
+    jsonGetScanFns(jsonBestScanner(), scan);
+}
+
+JsonToken
+JsonReader::fail() noexcept {
+    p = end;
+    depth = 0;
+    return last = JSON_TOKEN_ERROR;
+}
+
+JsonToken
+JsonReader::next() noexcept {
+    if (last == JSON_TOKEN_ERROR) {
+        return JSON_TOKEN_ERROR;
+    }
+
+    key = StringView();
+    keyStart = 0;
+
+    p = scan.skipSpace(p, end);
+
+    if (depth == 0) {
+        if (started) {
+            if (p != end) {
+                return fail();
+            }
+            return last = JSON_TOKEN_END;
+        }
+        started = true;
+    }
+    else {
+        if (p == end) {
+            return fail();
+        }
+
+        char closer = closers[depth - 1];
+        if (*p == closer) {
+            valueStart = p++;
+            depth--;
+            first = false;
+            return last = closer == '}' ? JSON_TOKEN_OBJECT_END
+                                        : JSON_TOKEN_ARRAY_END;
+        }
+
+        if (!first) {
+            if (*p != ',') {
+                return fail();
+            }
+            p = scan.skipSpace(p + 1, end);
+        }
+        first = false;
+
+        if (closer == '}') {
+            if (p == end || *p != '"') {
+                return fail();
+            }
+            keyStart = p++;
+            if (!readString(keyScratch, key)) {
+                return fail();
+            }
+            p = scan.skipSpace(p, end);
+            if (p == end || *p != ':') {
+                return fail();
+            }
+            p = scan.skipSpace(p + 1, end);
+        }
+    }
+
+    if (p == end) {
+        return fail();
+    }
+
+    valueStart = p;
+
+    switch (*p) {
+    case '{':
+    case '[':
+        if (depth == JSON_READER_DEPTH) {
+            return fail();
+        }
+        closers[depth++] = *p == '{' ? '}' : ']';
+        first = true;
+        return last = *p++ == '{' ? JSON_TOKEN_OBJECT_BEGIN
+                                  : JSON_TOKEN_ARRAY_BEGIN;
+    case '"':
+        p++;
+        if (!readString(stringScratch, string)) {
+            return fail();
+        }
+        return last = JSON_TOKEN_STRING;
+    case 't':
+        if (!isLiteral(p, end, "true")) {
+            return fail();
+        }
+        p += 4;
+        return last = JSON_TOKEN_TRUE;
+    case 'f':
+        if (!isLiteral(p, end, "false")) {
+            return fail();
+        }
+        p += 5;
+        return last = JSON_TOKEN_FALSE;
+    case 'n':
+        if (!isLiteral(p, end, "null")) {
+            return fail();
+        }
+        p += 4;
+        return last = JSON_TOKEN_NULL;
+    default:
+        if (!readNumber()) {
+            return fail();
+        }
+        return last = JSON_TOKEN_NUMBER;
+    }
+}
+
+bool
+JsonReader::readString(String& scratch, StringView& out) noexcept {
+    const char* q = scan.scanString(p, end);
+    if (q == end) {
+        return false;
+    }
+
+    // Most strings have no escapes and can be returned in place.
+    if (*q == '"') {
+        out = StringView(p, static_cast<size_t>(q - p));
+        p = q + 1;
+        return true;
+    }
+
+    scratch.clear();
+
+    while (true) {
+        scratch << StringView(p, static_cast<size_t>(q - p));
+        p = q;
+
+        if (p == end) {
+            return false;
+        }
+        if (*p == '"') {
+            p++;
+            out = scratch.view();
+            return true;
+        }
+        if (*p != '\\' || end - p < 2) {
+            // A control character, or an escape cut off by the end.
+            return false;
+        }
+
+        p += 2;
+        switch (p[-1]) {
+        case '\\':
+        case '"':
+        case '/':
+            scratch << p[-1];
+            break;
+        case 'b':
+            scratch << '\b';
+            break;
+        case 'f':
+            scratch << '\f';
+            break;
+        case 'n':
+            scratch << '\n';
+            break;
+        case 'r':
+            scratch << '\r';
+            break;
+        case 't':
+            scratch << '\t';
+            break;
+        case 'u': {
+            if (end - p < 4) {
+                return false;
+            }
+            int c = 0;
+            for (int i = 0; i < 4; i++) {
+                if (!isxdigit(p[i])) {
+                    return false;
+                }
+                c = c * 16 + char2int(p[i]);
+            }
+            p += 4;
+            if (c < 0x80) {
+                scratch << static_cast<char>(c);
+            }
+            else if (c < 0x800) {
+                scratch << static_cast<char>(0xC0 | (c >> 6));
+                scratch << static_cast<char>(0x80 | (c & 0x3F));
+            }
+            else {
+                scratch << static_cast<char>(0xE0 | (c >> 12));
+                scratch << static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+                scratch << static_cast<char>(0x80 | (c & 0x3F));
+            }
+            break;
+        }
+        default:
+            return false;
+        }
+
+        q = scan.scanString(p, end);
+    }
+}
+
+bool
+JsonReader::readNumber() noexcept {
+    if (!isdigit(*p) && *p != '-') {
+        return false;
+    }
+
+    const char* q = p + 1;
+    while (q < end && isNumberChar(*q)) {
+        q++;
+    }
+
+    if (*p == '-' && (q == p + 1 || (!isdigit(p[1]) && p[1] != '.'))) {
+        return false;
+    }
+
+    char* parsed;
+    if (q < end) {
+        // The character after the number stops parseDecimal.
+        number = parseDecimal(p, &parsed);
+        if (parsed != q) {
+            return false;
+        }
+    }
+    else {
+        // The number runs to the end of the text, which might not be
+        // followed by anything readable. Copy it so it is null-terminated.
+        char buf[64];
+        size_t size = static_cast<size_t>(q - p);
+        if (size >= sizeof(buf)) {
+            return false;
+        }
+        memcpy(buf, p, size);
+        buf[size] = 0;
+        number = parseDecimal(buf, &parsed);
+        if (parsed != buf + size) {
+            return false;
+        }
+    }
+
+    p = q;
+    return true;
+}
+
+bool
+JsonReader::skipString() noexcept {
+    while (true) {
+        p = scan.scanString(p, end);
+        if (p == end) {
+            return false;
+        }
+        if (*p == '"') {
+            p++;
+            return true;
+        }
+        if (*p != '\\' || end - p < 2) {
+            return false;
+        }
+        p += 2;
+    }
+}
+
+bool
+JsonReader::skip() noexcept {
+    if (last == JSON_TOKEN_ERROR) {
+        return false;
+    }
+    if (last != JSON_TOKEN_OBJECT_BEGIN && last != JSON_TOKEN_ARRAY_BEGIN) {
+        return true;
+    }
+
+    int target = depth - 1;
+    char closer = closers[target];
+
+    while (depth > target) {
+        while (p < end && *p != '"' && *p != '[' && *p != ']' && *p != '{' &&
+               *p != '}') {
+            p++;
+        }
+        if (p == end) {
+            fail();
+            return false;
+        }
+
+        char c = *p++;
+        switch (c) {
+        case '"':
+            if (!skipString()) {
+                fail();
+                return false;
+            }
+            break;
+        case '[':
+        case '{':
+            if (depth == JSON_READER_DEPTH) {
+                fail();
+                return false;
+            }
+            closers[depth++] = c == '{' ? '}' : ']';
+            break;
+        default:
+            if (c != closers[depth - 1]) {
+                fail();
+                return false;
+            }
+            depth--;
+            break;
+        }
+    }
+
+    first = false;
+    last = closer == '}' ? JSON_TOKEN_OBJECT_END : JSON_TOKEN_ARRAY_END;
+    return true;
+}
+
+bool
+JsonReader::capture(StringView& text) noexcept {
+    const char* start = valueStart;
+    if (!skip()) {
+        return false;
+    }
+    text = StringView(start, static_cast<size_t>(p - start));
+    return true;
+}
+
+bool
+JsonReader::captureMember(StringView& text) noexcept {
+    const char* start = keyStart;
+    if (!start || !skip()) {
+        return false;
+    }
+    text = StringView(start, static_cast<size_t>(p - start));
+    return true;
+}
@@ -0,0 +1,130 @@
+/********************************
+** Tsunagari Tile Engine       **
+** json-reader.h               **
+** Copyright 2020 Paul Merrill **
+********************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#ifndef SRC_UTIL_JSON_READER_H_
+#define SRC_UTIL_JSON_READER_H_
+
+#include "util/int.h"
+#include "util/json-scan.h"
+#include "util/noexcept.h"
+#include "util/string-view.h"
+#include "util/string.h"
+
+#define JSON_READER_DEPTH 32
+
+enum JsonToken {
+    JSON_TOKEN_ERROR,
+    JSON_TOKEN_END,  // End of the text.
+    JSON_TOKEN_OBJECT_BEGIN,
+    JSON_TOKEN_OBJECT_END,
+    JSON_TOKEN_ARRAY_BEGIN,
+    JSON_TOKEN_ARRAY_END,
+    JSON_TOKEN_STRING,
+    JSON_TOKEN_NUMBER,
+    JSON_TOKEN_TRUE,
+    JSON_TOKEN_FALSE,
+    JSON_TOKEN_NULL,
+};
+
+// Reads JSON one token at a time, straight from read-only text, without
+// building a tree. Unlike JsonDocument, it neither copies nor modifies the
+// text, which must outlive the reader.
+//
+// A reader can be copied to remember a position and come back to it later.
+class JsonReader {
+ public:
+    JsonReader(StringView text) noexcept;
+
+    // Read the next token. Inside an object, this also reads the key that
+    // comes before each value. After an error, every call returns
+    // JSON_TOKEN_ERROR.
+    JsonToken
+    next() noexcept;
+
+    // If the last token began an object or array, skip past its end. What is
+    // skipped is only checked enough to find the end. Returns false on error.
+    bool
+    skip() noexcept;
+
+    // Skip the value the last token began, as skip() does, and set text to
+    // all of it.
+    bool
+    capture(StringView& text) noexcept;
+
+    // Like capture(), but include the value's key, as in "key": value. Only
+    // valid inside an object.
+    bool
+    captureMember(StringView& text) noexcept;
+
+ public:
+    // The key of the current value, if inside an object.
+    StringView key;
+
+    // The contents of the last JSON_TOKEN_STRING, without quotes and with
+    // escapes decoded.
+    StringView string;
+
+    // The value of the last JSON_TOKEN_NUMBER.
+    double number;
+
+ private:
+    bool
+    readString(String& scratch, StringView& out) noexcept;
+    bool
+    readNumber() noexcept;
+    bool
+    skipString() noexcept;
+    JsonToken
+    fail() noexcept;
+
+ private:
+    const char* p;
+    const char* end;
+
+    // Where the value the last token began starts, and where its key starts.
+    const char* valueStart;
+    const char* keyStart;
+
+    JsonToken last;
+
+    // Closing characters of the containers the reader is in.
+    char closers[JSON_READER_DEPTH];
+    int depth;
+
+    // Whether the innermost container has no values yet.
+    bool first;
+
+    // Whether the top-level value has been read.
+    bool started;
+
+    JsonScanFns scan;
+
+    // Strings that contain escapes are decoded into these.
+    String keyScratch;
+    String stringScratch;
+};
+
+#endif  // SRC_UTIL_JSON_READER_H_
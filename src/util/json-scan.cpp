@@ -0,0 +1,168 @@
+/********************************
+** Tsunagari Tile Engine       **
+** json-scan.cpp               **
+** Copyright 2020 Paul Merrill **
+********************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#include "util/json-scan.h"
+
+#include "os/c.h"
+
+// The vector scanner is written with GCC vector extensions rather than
+// intrinsics so it needs no system headers. SSE2 is part of every x86-64 CPU,
+// so it is only left out of 32-bit builds that do not target it.
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__SSE2__)
+#define JSON_SCAN_SSE2
+#endif
+
+static inline bool
+isSpace(char c) noexcept {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+static inline bool
+isStringSpecial(char c) noexcept {
+    unsigned char u = static_cast<unsigned char>(c);
+    return u == '"' || u == '\\' || u < ' ' || u == 0x7F;
+}
+
+static const char*
+scalarSkipSpace(const char* s, const char* end) noexcept {
+    while (s < end && isSpace(*s)) {
+        s++;
+    }
+    return s;
+}
+
+static const char*
+scalarScanString(const char* s, const char* end) noexcept {
+    while (s < end && !isStringSpecial(*s)) {
+        s++;
+    }
+    return s;
+}
+
+#ifdef JSON_SCAN_SSE2
+typedef char Bytes16 __attribute__((vector_size(16)));
+typedef unsigned char UBytes16 __attribute__((vector_size(16)));
+
+// Each scanner loads whole blocks while they fit, building a mask with one bit
+// per byte that should stop the scan, and returns the position of the lowest
+// set bit. The last partial block is scanned one byte at a time.
+
+static const char*
+sse2SkipSpace(const char* s, const char* end) noexcept {
+    while (end - s >= 16) {
+        Bytes16 v;
+        memcpy(&v, s, sizeof(v));
+        Bytes16 space = (v == ' ') | ((UBytes16)(v - '\t') <= '\r' - '\t');
+        unsigned mask = ~__builtin_ia32_pmovmskb128(space) & 0xFFFF;
+        if (mask) {
+            return s + __builtin_ctz(mask);
+        }
+        s += sizeof(v);
+    }
+    return scalarSkipSpace(s, end);
+}
+
+static const char*
+sse2ScanString(const char* s, const char* end) noexcept {
+    while (end - s >= 16) {
+        Bytes16 v;
+        memcpy(&v, s, sizeof(v));
+        Bytes16 special = (v == '"') | (v == '\\') | ((UBytes16)v < ' ') |
+                          (v == 0x7F);
+        unsigned mask = __builtin_ia32_pmovmskb128(special);
+        if (mask) {
+            return s + __builtin_ctz(mask);
+        }
+        s += sizeof(v);
+    }
+    return scalarScanString(s, end);
+}
+#endif  // JSON_SCAN_SSE2
+
+static bool
+supported(JsonScanner scanner) noexcept {
+    switch (scanner) {
+    case JSON_SCANNER_SCALAR:
+        return true;
+#ifdef JSON_SCAN_SSE2
+    case JSON_SCANNER_SSE2:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+JsonScanner
+jsonBestScanner() noexcept {
+    if (supported(JSON_SCANNER_SSE2)) {
+        return JSON_SCANNER_SSE2;
+    }
+    return JSON_SCANNER_SCALAR;
+}
+
+bool
+jsonGetScanFns(JsonScanner scanner, JsonScanFns& fns) noexcept {
+    if (!supported(scanner)) {
+        return false;
+    }
+
+    switch (scanner) {
+    case JSON_SCANNER_SCALAR:
+        fns.skipSpace = scalarSkipSpace;
+        fns.scanString = scalarScanString;
+        break;
+#ifdef JSON_SCAN_SSE2
+    case JSON_SCANNER_SSE2:
+        fns.skipSpace = sse2SkipSpace;
+        fns.scanString = sse2ScanString;
+        break;
+#endif
+    default:
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,56 @@
+/********************************
+** Tsunagari Tile Engine       **
+** json-scan.h                 **
+** Copyright 2020 Paul Merrill **
+********************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#ifndef SRC_UTIL_JSON_SCAN_H_
+#define SRC_UTIL_JSON_SCAN_H_
+
+#include "util/noexcept.h"
+
+// Bulk character scanners for the JSON tokenizers. Each one looks at the
+// characters in [s, end) and returns end if none match.
+
+enum JsonScanner {
+    JSON_SCANNER_SCALAR,
+    JSON_SCANNER_SSE2,
+};
+
+struct JsonScanFns {
+    // Returns the first character that is not whitespace.
+    const char* (*skipSpace)(const char* s, const char* end) noexcept;
+
+    // Returns the first '"', '\\', or control character.
+    const char* (*scanString)(const char* s, const char* end) noexcept;
+};
+
+// The fastest scanner this build supports.
+JsonScanner
+jsonBestScanner() noexcept;
+
+// Returns false if the scanner is not supported here.
+bool
+jsonGetScanFns(JsonScanner scanner, JsonScanFns& fns) noexcept;
+
+#endif  // SRC_UTIL_JSON_SCAN_H_
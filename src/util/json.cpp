@@ -57,32 +57,61 @@
 
 #include "util/json.h"
 
+#include "os/c.h"
+#include "util/decimal.h"
+#include "util/fnv.h"
 #include "util/int.h"
+#include "util/json-scan.h"
+#include "util/math2.h"
 #include "util/new.h"
 #include "util/string-view.h"
 #include "util/string.h"
 
+// Blocks start at JSON_ZONE_SIZE bytes and double up to JSON_ZONE_MAX_SIZE.
 #define JSON_ZONE_SIZE 4096
+#define JSON_ZONE_MAX_SIZE (1 << 20)
 #define JSON_STACK_SIZE 32
 
+// Objects with fewer members are searched linearly.
+#define JSON_INDEX_MIN_SIZE 8
+
+JsonAllocator::JsonAllocator() noexcept
+        : head(0), nextSize(JSON_ZONE_SIZE), stats() {}
+
+JsonAllocator::JsonAllocator(JsonAllocator&& other) noexcept
+        : head(other.head), nextSize(other.nextSize), stats(other.stats) {
+    other.head = 0;
+    other.nextSize = JSON_ZONE_SIZE;
+    other.stats = JsonAllocatorStats();
+}
+
 void*
 JsonAllocator::allocate(size_t size) noexcept {
     size = (size + 7) & ~7;
 
-    if (head && head->used + size <= JSON_ZONE_SIZE) {
+    if (head && head->used + size <= head->size) {
         char* p = reinterpret_cast<char*>(head) + head->used;
         head->used += size;
+        stats.used += size;
+        if (stats.peak < stats.used) {
+            stats.peak = stats.used;
+        }
         return p;
     }
 
+    // Allocations too big for the next block get a block of their own, kept
+    // behind the head so the head's free space can still be used.
     size_t allocSize = sizeof(Zone) + size;
-    Zone* zone = static_cast<Zone*>(
-            malloc(allocSize <= JSON_ZONE_SIZE ? JSON_ZONE_SIZE : allocSize));
+    bool large = allocSize > nextSize;
+    size_t zoneSize = large ? allocSize : nextSize;
+
+    Zone* zone = static_cast<Zone*>(malloc(zoneSize));
     if (zone == 0) {
         return 0;
     }
     zone->used = allocSize;
-    if (allocSize <= JSON_ZONE_SIZE || head == 0) {
+    zone->size = zoneSize;
+    if (!large || head == 0) {
         zone->next = head;
         head = zone;
     }
@@ -90,9 +119,51 @@ JsonAllocator::allocate(size_t size) noexcept {
         zone->next = head->next;
         head->next = zone;
     }
+    if (!large && nextSize < JSON_ZONE_MAX_SIZE) {
+        nextSize *= 2;
+    }
+
+    stats.used += size;
+    if (stats.peak < stats.used) {
+        stats.peak = stats.used;
+    }
+    stats.capacity += zoneSize;
+    stats.blocks += 1;
+    stats.mallocs += 1;
+
     return reinterpret_cast<char*>(zone) + sizeof(Zone);
 }
 
+void
+JsonAllocator::reset() noexcept {
+    stats.used = 0;
+
+    if (head == 0) {
+        return;
+    }
+
+    if (head->next == 0) {
+        head->used = sizeof(Zone);
+        return;
+    }
+
+    // Replace the blocks with one that holds all they did.
+    size_t capacity = stats.capacity;
+    deallocate();
+
+    head = static_cast<Zone*>(malloc(capacity));
+    if (head == 0) {
+        return;
+    }
+    head->next = 0;
+    head->used = sizeof(Zone);
+    head->size = capacity;
+
+    stats.capacity = capacity;
+    stats.blocks = 1;
+    stats.mallocs += 1;
+}
+
 void
 JsonAllocator::deallocate() noexcept {
     while (head) {
@@ -100,6 +171,9 @@ JsonAllocator::deallocate() noexcept {
         free(head);
         head = next;
     }
+    stats.used = 0;
+    stats.capacity = 0;
+    stats.blocks = 0;
 }
 
 static inline bool
@@ -130,57 +204,59 @@ char2int(char c) noexcept {
     return (c & ~' ') - 'A' + 10;
 }
 
-static double
-string2double(char* s, char** endptr) noexcept {
-    char ch = *s;
-    if (ch == '-') {
-        ++s;
-    }
-
-    double result = 0;
-    while (isdigit(*s)) {
-        result = (result * 10) + (*s++ - '0');
-    }
-
-    if (*s == '.') {
-        ++s;
-
-        double fraction = 1;
-        while (isdigit(*s)) {
-            fraction *= 0.1;
-            result += (*s++ - '0') * fraction;
+// Read the integers of an array whose '[' is just before s into out, if
+// non-null. Returns how many there are and sets s to just past the ']'. If
+// any element is not an integer that fits in 32 bits, or the array is empty,
+// returns zero and leaves s alone.
+static size_t
+scanIntArray(char*& s, int32_t* out) noexcept {
+    char* p = s;
+    size_t count = 0;
+
+    while (true) {
+        while (isspace(*p)) {
+            ++p;
         }
-    }
 
-    if (*s == 'e' || *s == 'E') {
-        ++s;
-
-        double base = 10;
-        if (*s == '+') {
-            ++s;
+        bool negative = *p == '-';
+        if (negative) {
+            ++p;
         }
-        else if (*s == '-') {
-            ++s;
-            base = 0.1;
+        if (!isdigit(*p)) {
+            return 0;
         }
 
-        unsigned int exponent = 0;
-        while (isdigit(*s)) {
-            exponent = (exponent * 10) + (*s++ - '0');
+        int64_t x = 0;
+        for (int digits = 0; isdigit(*p); digits++) {
+            if (digits == 10) {
+                return 0;
+            }
+            x = x * 10 + (*p++ - '0');
+        }
+        if (negative) {
+            x = -x;
+        }
+        if (x < INT32_MIN || x > INT32_MAX) {
+            return 0;
         }
 
-        double power = 1;
-        for (; exponent; exponent >>= 1, base *= base) {
-            if (exponent & 1) {
-                power *= base;
-            }
+        if (out) {
+            out[count] = static_cast<int32_t>(x);
         }
+        count++;
 
-        result *= power;
+        while (isspace(*p)) {
+            ++p;
+        }
+        if (*p == ']') {
+            s = p + 1;
+            return count;
+        }
+        if (*p != ',') {
+            return 0;
+        }
+        ++p;
     }
-
-    *endptr = s;
-    return ch == '-' ? -result : result;
 }
 
 static inline JsonNode*
@@ -203,11 +279,74 @@ listToValue(JsonTag tag, JsonNode* tail) noexcept {
     return JsonValue(tag, 0);
 }
 
+static inline size_t
+hashKey(const char* key, size_t size) noexcept {
+    return fnvHash(key, size);
+}
+
+// Wrap an object's members in a JsonObject, indexing them if there are many.
+// Returns false if out of memory.
+static bool
+listToObject(JsonNode* tail,
+             size_t size,
+             JsonAllocator& allocator,
+             JsonValue& o) noexcept {
+    JsonObject* object = reinterpret_cast<JsonObject*>(
+            allocator.allocate(sizeof(JsonObject)));
+    if (object == 0) {
+        return false;
+    }
+
+    // Members are kept in a circular list while parsing. Break it.
+    object->head = 0;
+    if (tail) {
+        object->head = tail->next;
+        tail->next = 0;
+    }
+    object->slots = 0;
+    object->mask = 0;
+
+    if (size >= JSON_INDEX_MIN_SIZE) {
+        // Keep the table at most half full so probe sequences stay short.
+        size_t slotCount = pow2(size * 2);
+        JsonNode** slots = reinterpret_cast<JsonNode**>(
+                allocator.allocate(slotCount * sizeof(JsonNode*)));
+        if (slots == 0) {
+            return false;
+        }
+        memset(slots, 0, slotCount * sizeof(JsonNode*));
+
+        size_t mask = slotCount - 1;
+        for (JsonNode* node = object->head; node; node = node->next) {
+            size_t i = hashKey(node->key, strlen(node->key)) & mask;
+            while (slots[i] && StringView(slots[i]->key) != node->key) {
+                i = (i + 1) & mask;
+            }
+            // With duplicate keys, the first one wins, as when searching
+            // linearly.
+            if (!slots[i]) {
+                slots[i] = node;
+            }
+        }
+
+        object->slots = slots;
+        object->mask = mask;
+    }
+
+    o = JsonValue(JSON_OBJECT, object);
+    return true;
+}
+
 static bool
-parse(char* s, JsonValue* value, JsonAllocator& allocator) noexcept {
+parse(char* s,
+      char* end,
+      JsonValue* value,
+      JsonAllocator& allocator,
+      const JsonScanFns& scan) noexcept {
     JsonNode* tails[JSON_STACK_SIZE];
     JsonTag tags[JSON_STACK_SIZE];
     char* keys[JSON_STACK_SIZE];
+    size_t sizes[JSON_STACK_SIZE];
     JsonValue o;
     int pos = -1;
     bool separator = true;
@@ -215,10 +354,12 @@ parse(char* s, JsonValue* value, JsonAllocator& allocator) noexcept {
     char* endptr = s;
 
     while (*s) {
-        while (isspace(*s)) {
+        // Most tokens are separated by at most one space. Only pay for a bulk
+        // scan on longer runs, such as indentation.
+        if (isspace(*s)) {
             ++s;
-            if (!*s) {
-                break;
+            if (isspace(*s)) {
+                s = const_cast<char*>(scan.skipSpace(s, end));
             }
         }
         endptr = s++;
@@ -238,7 +379,7 @@ parse(char* s, JsonValue* value, JsonAllocator& allocator) noexcept {
         case '7':
         case '8':
         case '9':
-            o = JsonValue(string2double(endptr, &s));
+            o = JsonValue(parseDecimal(endptr, &s));
             if (!isdelim(*s)) {
                 endptr = s;
                 return false;
@@ -246,6 +387,17 @@ parse(char* s, JsonValue* value, JsonAllocator& allocator) noexcept {
             break;
         case '"':
             o = JsonValue(JSON_STRING, s);
+            s = const_cast<char*>(scan.scanString(s, end));
+            if (*s == '"') {
+                // No escapes, so the string can stay where it is.
+                *s++ = 0;
+                if (!isdelim(*s)) {
+                    endptr = s;
+                    return false;
+                }
+                break;
+            }
+            // Unescape the rest of the string in place.
             for (char* it = s; *s; ++it, ++s) {
                 int c = *it = *s;
                 if (c == '\\') {
@@ -356,17 +508,41 @@ parse(char* s, JsonValue* value, JsonAllocator& allocator) noexcept {
             if (keys[pos] != 0) {
                 return false;
             }
-            o = listToValue(JSON_OBJECT, tails[pos--]);
+            if (!listToObject(tails[pos], sizes[pos], allocator, o)) {
+                return false;
+            }
+            pos--;
             break;
-        case '[':
+        case '[': {
+            // Arrays of integers, like tile layer data, are read straight
+            // into one block instead of becoming a node per element.
+            char* intsEnd = s;
+            size_t intCount = scanIntArray(intsEnd, 0);
+            if (intCount) {
+                JsonIntArray* array =
+                        reinterpret_cast<JsonIntArray*>(allocator.allocate(
+                                sizeof(JsonIntArray) +
+                                intCount * sizeof(int32_t)));
+                if (array == 0) {
+                    return false;
+                }
+                array->size = intCount;
+                array->data = reinterpret_cast<int32_t*>(array + 1);
+                scanIntArray(s, array->data);
+                o = JsonValue(JSON_INT_ARRAY, array);
+                break;
+            }
+
             if (++pos == JSON_STACK_SIZE) {
                 return false;
             }
             tails[pos] = 0;
             tags[pos] = JSON_ARRAY;
             keys[pos] = 0;
+            sizes[pos] = 0;
             separator = true;
             continue;
+        }
         case '{':
             if (++pos == JSON_STACK_SIZE) {
                 return false;
@@ -374,6 +550,7 @@ parse(char* s, JsonValue* value, JsonAllocator& allocator) noexcept {
             tails[pos] = 0;
             tags[pos] = JSON_OBJECT;
             keys[pos] = 0;
+            sizes[pos] = 0;
             separator = true;
             continue;
         case ':':
@@ -417,6 +594,7 @@ parse(char* s, JsonValue* value, JsonAllocator& allocator) noexcept {
             tails[pos] = insertAfter(tails[pos], node);
             tails[pos]->key = keys[pos];
             keys[pos] = 0;
+            sizes[pos] += 1;
         }
         else {
             if ((node = reinterpret_cast<JsonNode*>(allocator.allocate(
@@ -431,9 +609,29 @@ parse(char* s, JsonValue* value, JsonAllocator& allocator) noexcept {
 }
 
 JsonValue JsonValue::operator[](StringView key) noexcept {
-    for (JsonNode& node : *this) {
-        if (key == node.key) {
-            return node.value;
+    if (!isObject()) {
+        return JsonValue();
+    }
+
+    JsonObject* object = toObject();
+
+    if (object->slots) {
+        size_t mask = object->mask;
+        size_t i = hashKey(key.data, key.size) & mask;
+        for (;; i = (i + 1) & mask) {
+            JsonNode* node = object->slots[i];
+            if (!node) {
+                return JsonValue();
+            }
+            if (key == node->key) {
+                return node->value;
+            }
+        }
+    }
+
+    for (JsonNode* node = object->head; node; node = node->next) {
+        if (key == node->key) {
+            return node->value;
         }
     }
 
@@ -442,26 +640,57 @@ JsonValue JsonValue::operator[](StringView key) noexcept {
 
 void
 JsonAllocator::operator=(JsonAllocator&& other) noexcept {
+    deallocate();
     head = other.head;
+    nextSize = other.nextSize;
+    stats = other.stats;
     other.head = 0;
+    other.nextSize = JSON_ZONE_SIZE;
+    other.stats = JsonAllocatorStats();
 }
 
 JsonDocument::JsonDocument(String text) noexcept
-        : text(static_cast<String&&>(text)) {
+        : JsonDocument(static_cast<String&&>(text), jsonBestScanner()) {}
+
+JsonDocument::JsonDocument(String text, JsonScanner scanner) noexcept
+        : JsonDocument(static_cast<String&&>(text), scanner, ownAllocator) {}
+
+JsonDocument::JsonDocument(String text, JsonAllocator& allocator) noexcept
+        : JsonDocument(static_cast<String&&>(text),
+                       jsonBestScanner(),
+                       allocator) {}
+
+JsonDocument::JsonDocument(String text,
+                           JsonScanner scanner,
+                           JsonAllocator& allocator) noexcept
+        : text(static_cast<String&&>(text)), allocator(&allocator) {
     this->text << StringView("", 1);  // Add a null byte.
-    ok = parse(this->text.data, &root, allocator);
+
+    JsonScanFns scan;
+    if (!jsonGetScanFns(scanner, scan)) {
+        ok = false;
+        return;
+    }
+    char* end = this->text.data + this->text.size - 1;
+    ok = parse(this->text.data, end, &root, allocator, scan);
 }
 
 JsonDocument::JsonDocument(JsonDocument&& other) noexcept {
     root = other.root;
     ok = other.ok;
     text = static_cast<String&&>(other.text);
-    allocator.head = other.allocator.head;
+    if (other.allocator == &other.ownAllocator) {
+        ownAllocator = static_cast<JsonAllocator&&>(other.ownAllocator);
+        allocator = &ownAllocator;
+    }
+    else {
+        allocator = other.allocator;
+    }
 
     other.ok = false;
-    other.allocator.head = 0;
+    other.allocator = &other.ownAllocator;
 }
 
 JsonDocument::~JsonDocument() noexcept {
-    allocator.deallocate();
+    ownAllocator.deallocate();
 }
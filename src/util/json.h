@@ -57,6 +57,7 @@
 
 //#include "util/assert.h"
 #include "util/int.h"
+#include "util/json-scan.h"
 #include "util/string-view.h"
 #include "util/string.h"
 
@@ -72,11 +73,28 @@ enum JsonTag {
     JSON_OBJECT,
     JSON_TRUE,
     JSON_FALSE,
+    JSON_INT_ARRAY,  // An array of only integers. Iterates like JSON_ARRAY.
     JSON_NULL = 0xF
 };
 
 struct JsonNode;
 
+// The payload of an integer array value. Arrays whose elements are all
+// integers that fit in 32 bits are stored this way instead of as a list of
+// nodes.
+struct JsonIntArray {
+    size_t size;
+    int32_t* data;
+};
+
+// The payload of an object value. Objects with many members are also indexed
+// by key so that looking one up does not walk the whole list.
+struct JsonObject {
+    JsonNode* head;
+    JsonNode** slots;  // Open addressing on key hash. Null if not indexed.
+    size_t mask;       // Number of slots minus one.
+};
+
 union JsonValue {
     uint64_t ival;
     double fval;
@@ -120,7 +138,13 @@ union JsonValue {
 
     inline bool
     isArray() noexcept {
-        return getTag() == JSON_ARRAY;
+        JsonTag tag = getTag();
+        return tag == JSON_ARRAY || tag == JSON_INT_ARRAY;
+    }
+
+    inline bool
+    isIntArray() noexcept {
+        return getTag() == JSON_INT_ARRAY;
     }
 
     inline bool
@@ -171,12 +195,33 @@ union JsonValue {
         return StringView(reinterpret_cast<char*>(getPayload()));
     }
 
+    // The first node of an array or object. Integer arrays have no nodes and
+    // return null, so iterate them with begin() and end() or toIntArray().
     inline JsonNode*
     toNode() noexcept {
-        // assert_(isArray() || isObject());
+        // assert_(isNode());
+        JsonTag tag = getTag();
+        if (tag == JSON_OBJECT) {
+            return toObject()->head;
+        }
+        if (tag != JSON_ARRAY) {
+            return 0;
+        }
         return reinterpret_cast<JsonNode*>(getPayload());
     }
 
+    inline JsonObject*
+    toObject() noexcept {
+        // assert_(isObject());
+        return reinterpret_cast<JsonObject*>(getPayload());
+    }
+
+    inline JsonIntArray*
+    toIntArray() noexcept {
+        // assert_(isIntArray());
+        return reinterpret_cast<JsonIntArray*>(getPayload());
+    }
+
     JsonValue operator[](StringView key) noexcept;
 
     inline uint64_t
@@ -194,39 +239,71 @@ struct JsonNode {
 
 struct JsonIterator {
     JsonNode* node;
+    int32_t* ints;     // Position in an integer array, or null.
+    JsonNode current;  // The integer at ints, as a node.
 
-    JsonIterator(JsonNode* node) : node(node) {}
+    JsonIterator(JsonNode* node) : node(node), ints(0) {}
+    JsonIterator(int32_t* ints) : node(0), ints(ints) {}
 
     inline void
     operator++() noexcept {
-        node = node->next;
+        if (ints) {
+            ints++;
+        }
+        else {
+            node = node->next;
+        }
     }
 
     inline bool
     operator!=(JsonIterator& other) noexcept {
-        return node != other.node;
+        return node != other.node || ints != other.ints;
     }
 
-    inline JsonNode& operator*() noexcept { return *node; }
+    inline JsonNode& operator*() noexcept {
+        if (ints) {
+            current.value = JsonValue(static_cast<double>(*ints));
+            current.next = 0;
+            current.key = 0;
+            return current;
+        }
+        return *node;
+    }
 
-    inline JsonNode& operator->() noexcept { return *node; }
+    inline JsonNode& operator->() noexcept { return **this; }
 };
 
 inline JsonIterator
 begin(JsonValue object) noexcept {
+    if (object.isIntArray()) {
+        return JsonIterator(object.toIntArray()->data);
+    }
     return JsonIterator(object.toNode());
 }
 
 inline JsonIterator
-end(JsonValue) noexcept {
-    return JsonIterator(0);
+end(JsonValue object) noexcept {
+    if (object.isIntArray()) {
+        JsonIntArray* array = object.toIntArray();
+        return JsonIterator(array->data + array->size);
+    }
+    return JsonIterator(static_cast<JsonNode*>(0));
 }
 
+struct JsonAllocatorStats {
+    size_t used;      // Bytes handed out since the last reset.
+    size_t peak;      // Most bytes handed out between two resets.
+    size_t capacity;  // Bytes in the blocks held now.
+    size_t blocks;    // Blocks held now.
+    size_t mallocs;   // Blocks allocated over the allocator's life.
+};
+
+// An arena for JSON trees. Its blocks start small and double in size. An
+// allocator can be shared by a series of documents, such as every file loaded
+// by one job, and reset() between them to reuse its memory.
 struct JsonAllocator {
-    inline JsonAllocator() noexcept : head(0) {}
-    inline JsonAllocator(JsonAllocator&& other) noexcept : head(other.head) {
-        other.head = 0;
-    }
+    JsonAllocator() noexcept;
+    JsonAllocator(JsonAllocator&& other) noexcept;
     inline ~JsonAllocator() noexcept { deallocate(); }
 
     void
@@ -239,21 +316,41 @@ struct JsonAllocator {
     void*
     allocate(size_t size) noexcept;
 
+    // Forget everything allocated, keeping enough memory to hold as much
+    // again without calling malloc. No document may still be using it.
+    void
+    reset() noexcept;
+
+    // Free every block.
     void
     deallocate() noexcept;
 
     struct Zone {
         Zone* next;
         size_t used;
+        size_t size;
     };
 
     Zone* head;
+
+    // Size of the next block, before large allocations.
+    size_t nextSize;
+
+    JsonAllocatorStats stats;
 };
 
 class JsonDocument {
  public:
-    JsonDocument() noexcept : ok(false) {}
+    JsonDocument() noexcept : ok(false), allocator(&ownAllocator) {}
     JsonDocument(String text) noexcept;  // Destructively edits text.
+    // Tokenize with a specific scanner. ok is false if it is not supported.
+    JsonDocument(String text, JsonScanner scanner) noexcept;
+    // Build the tree in allocator instead of in memory of the document's own.
+    // The allocator must not be reset until the document is destroyed.
+    JsonDocument(String text, JsonAllocator& allocator) noexcept;
+    JsonDocument(String text,
+                 JsonScanner scanner,
+                 JsonAllocator& allocator) noexcept;
     JsonDocument(JsonDocument&&) noexcept;
     ~JsonDocument() noexcept;
 
@@ -267,7 +364,8 @@ class JsonDocument {
 
  private:
     String text;
-    JsonAllocator allocator;
+    JsonAllocator ownAllocator;
+    JsonAllocator* allocator;
 };
 
 #endif  // SRC_UTIL_JSON_H_
@@ -0,0 +1,471 @@
+/********************************
+** Tsunagari Tile Engine       **
+** png.cpp                     **
+** Copyright 2020 Paul Merrill **
+********************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#include "util/png.h"
+
+#include "os/c.h"
+#include "util/inflate.h"
+#include "util/int.h"
+#include "util/noexcept.h"
+#include "util/string-view.h"
+#include "util/vector.h"
+
+// A PNG decoder (https://www.w3.org/TR/PNG/) for pack-tool, which decodes
+// images ahead of time for the engine. Chunk CRCs are not checked, since the
+// pack has its own checksums.
+
+static const uint8_t PNG_SIGNATURE[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+
+// Keeps the size of the image and its rows far from overflowing.
+#define PNG_MAX_DIMENSION 0x4000
+
+enum PngColorType {
+    PNG_GRAY = 0,
+    PNG_RGB = 2,
+    PNG_PALETTE = 3,
+    PNG_GRAY_ALPHA = 4,
+    PNG_RGBA = 6,
+};
+
+struct PngInfo {
+    uint32_t width;
+    uint32_t height;
+    uint32_t depth;  // Bits per channel.
+    uint32_t colorType;
+    uint32_t channels;
+    bool interlaced;
+
+    uint8_t palette[256 * 4];  // RGBA.
+    uint32_t paletteSize;
+
+    // Color that is transparent, from the tRNS chunk, for gray and RGB
+    // images.
+    bool hasKey;
+    uint32_t key[3];
+};
+
+// The seven passes of Adam7 interlacing, each a subimage of every dx-th pixel
+// of every dy-th row starting at x, y.
+static const uint32_t passX[7] = {0, 4, 0, 2, 0, 1, 0};
+static const uint32_t passY[7] = {0, 0, 4, 0, 2, 0, 1};
+static const uint32_t passDX[7] = {8, 8, 4, 4, 2, 2, 1};
+static const uint32_t passDY[7] = {8, 8, 8, 4, 4, 2, 2};
+
+static uint32_t
+readBE32(const uint8_t* p) noexcept {
+    return (static_cast<uint32_t>(p[0]) << 24) |
+           (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+static size_t
+rowBytes(const PngInfo& info, uint32_t width) noexcept {
+    return (static_cast<size_t>(width) * info.channels * info.depth + 7) / 8;
+}
+
+// Number of pixels in a pass of an interlaced image along a side of size
+// pixels.
+static uint32_t
+passSize(uint32_t size, uint32_t start, uint32_t step) noexcept {
+    return size > start ? (size - start + step - 1) / step : 0;
+}
+
+static bool
+readHeader(PngInfo& info, const uint8_t* chunk, uint32_t length) noexcept {
+    if (length != 13) {
+        return false;
+    }
+
+    info.width = readBE32(chunk);
+    info.height = readBE32(chunk + 4);
+    info.depth = chunk[8];
+    info.colorType = chunk[9];
+    info.interlaced = chunk[12] == 1;
+
+    if (info.width == 0 || info.width > PNG_MAX_DIMENSION ||
+        info.height == 0 || info.height > PNG_MAX_DIMENSION) {
+        return false;
+    }
+
+    // Compression and filter methods must be 0, interlace method 0 or 1.
+    if (chunk[10] != 0 || chunk[11] != 0 || chunk[12] > 1) {
+        return false;
+    }
+
+    uint32_t depth = info.depth;
+    bool lowDepth = depth == 1 || depth == 2 || depth == 4;
+
+    switch (info.colorType) {
+    case PNG_GRAY:
+        info.channels = 1;
+        return lowDepth || depth == 8 || depth == 16;
+    case PNG_RGB:
+        info.channels = 3;
+        return depth == 8 || depth == 16;
+    case PNG_PALETTE:
+        info.channels = 1;
+        return lowDepth || depth == 8;
+    case PNG_GRAY_ALPHA:
+        info.channels = 2;
+        return depth == 8 || depth == 16;
+    case PNG_RGBA:
+        info.channels = 4;
+        return depth == 8 || depth == 16;
+    default:
+        return false;
+    }
+}
+
+static uint8_t
+paeth(uint8_t a, uint8_t b, uint8_t c) noexcept {
+    int p = a + b - c;
+    int pa = p > a ? p - a : a - p;
+    int pb = p > b ? p - b : b - p;
+    int pc = p > c ? p - c : c - p;
+    if (pa <= pb && pa <= pc) {
+        return a;
+    }
+    return pb <= pc ? b : c;
+}
+
+// Undo the filter on each of count rows, each a filter type byte followed by
+// stride bytes. bpp is the number of bytes per pixel, rounded up to one.
+static bool
+unfilter(uint8_t* data, uint32_t count, size_t stride, size_t bpp) noexcept {
+    const uint8_t* prev = 0;
+
+    for (uint32_t y = 0; y < count; y++) {
+        uint8_t filter = data[0];
+        uint8_t* row = data + 1;
+
+        switch (filter) {
+        case 0:
+            break;
+        case 1:
+            for (size_t i = bpp; i < stride; i++) {
+                row[i] = static_cast<uint8_t>(row[i] + row[i - bpp]);
+            }
+            break;
+        case 2:
+            if (prev) {
+                for (size_t i = 0; i < stride; i++) {
+                    row[i] = static_cast<uint8_t>(row[i] + prev[i]);
+                }
+            }
+            break;
+        case 3:
+            for (size_t i = 0; i < stride; i++) {
+                unsigned left = i >= bpp ? row[i - bpp] : 0;
+                unsigned up = prev ? prev[i] : 0;
+                row[i] = static_cast<uint8_t>(row[i] + (left + up) / 2);
+            }
+            break;
+        case 4:
+            for (size_t i = 0; i < stride; i++) {
+                uint8_t left = i >= bpp ? row[i - bpp] : 0;
+                uint8_t up = prev ? prev[i] : 0;
+                uint8_t upLeft = prev && i >= bpp ? prev[i - bpp] : 0;
+                row[i] = static_cast<uint8_t>(row[i] + paeth(left, up, upLeft));
+            }
+            break;
+        default:
+            return false;
+        }
+
+        prev = row;
+        data += 1 + stride;
+    }
+
+    return true;
+}
+
+// The index-th sample of a row, at its original depth.
+static uint32_t
+sampleAt(const uint8_t* row, size_t index, uint32_t depth) noexcept {
+    switch (depth) {
+    case 8:
+        return row[index];
+    case 16:
+        return (static_cast<uint32_t>(row[index * 2]) << 8) | row[index * 2 + 1];
+    default: {
+        size_t bit = index * depth;
+        uint32_t shift = 8 - depth - static_cast<uint32_t>(bit % 8);
+        return (row[bit / 8] >> shift) & ((1u << depth) - 1);
+    }
+    }
+}
+
+// A sample scaled to 8 bits.
+static uint8_t
+to8(uint32_t sample, uint32_t depth) noexcept {
+    switch (depth) {
+    case 1:
+        return static_cast<uint8_t>(sample * 0xFF);
+    case 2:
+        return static_cast<uint8_t>(sample * 0x55);
+    case 4:
+        return static_cast<uint8_t>(sample * 0x11);
+    case 16:
+        return static_cast<uint8_t>(sample >> 8);
+    default:
+        return static_cast<uint8_t>(sample);
+    }
+}
+
+// Write the count pixels of an unfiltered row as RGBA, step pixels apart.
+static void
+convertRow(const PngInfo& info,
+           const uint8_t* row,
+           uint32_t count,
+           uint8_t* out,
+           size_t step) noexcept {
+    uint32_t depth = info.depth;
+
+    if (info.colorType == PNG_RGBA && depth == 8 && step == 1) {
+        memcpy(out, row, static_cast<size_t>(count) * 4);
+        return;
+    }
+
+    for (uint32_t i = 0; i < count; i++, out += step * 4) {
+        switch (info.colorType) {
+        case PNG_GRAY: {
+            uint32_t v = sampleAt(row, i, depth);
+            out[0] = out[1] = out[2] = to8(v, depth);
+            out[3] = info.hasKey && v == info.key[0] ? 0 : 0xFF;
+            break;
+        }
+        case PNG_RGB: {
+            uint32_t r = sampleAt(row, i * 3, depth);
+            uint32_t g = sampleAt(row, i * 3 + 1, depth);
+            uint32_t b = sampleAt(row, i * 3 + 2, depth);
+            out[0] = to8(r, depth);
+            out[1] = to8(g, depth);
+            out[2] = to8(b, depth);
+            out[3] = info.hasKey && r == info.key[0] && g == info.key[1] &&
+                                     b == info.key[2]
+                             ? 0
+                             : 0xFF;
+            break;
+        }
+        case PNG_PALETTE: {
+            uint32_t index = sampleAt(row, i, depth);
+            if (index < info.paletteSize) {
+                memcpy(out, info.palette + index * 4, 4);
+            }
+            else {
+                out[0] = out[1] = out[2] = 0;
+                out[3] = 0xFF;
+            }
+            break;
+        }
+        case PNG_GRAY_ALPHA:
+            out[0] = out[1] = out[2] = to8(sampleAt(row, i * 2, depth), depth);
+            out[3] = to8(sampleAt(row, i * 2 + 1, depth), depth);
+            break;
+        case PNG_RGBA:
+            for (size_t c = 0; c < 4; c++) {
+                out[c] = to8(sampleAt(row, i * 4 + c, depth), depth);
+            }
+            break;
+        }
+    }
+}
+
+struct PngSpan {
+    const uint8_t* data;
+    size_t size;
+};
+
+bool
+pngDecode(StringView data,
+          uint32_t& width,
+          uint32_t& height,
+          Vector<uint8_t>& rgba) noexcept {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data.data);
+    size_t size = data.size;
+
+    if (size < sizeof(PNG_SIGNATURE) ||
+        memcmp(p, PNG_SIGNATURE, sizeof(PNG_SIGNATURE)) != 0) {
+        return false;
+    }
+
+    PngInfo info;
+    memset(&info, 0, sizeof(info));
+
+    bool haveHeader = false;
+    Vector<PngSpan> idats;
+    size_t idatSize = 0;
+
+    size_t pos = sizeof(PNG_SIGNATURE);
+    while (true) {
+        if (size - pos < 12) {
+            return false;
+        }
+
+        uint32_t length = readBE32(p + pos);
+        StringView type(reinterpret_cast<const char*>(p + pos + 4), 4);
+        const uint8_t* chunk = p + pos + 8;
+
+        if (length > size - pos - 12) {
+            return false;
+        }
+        pos += 12 + static_cast<size_t>(length);
+
+        if (type == "IHDR") {
+            if (haveHeader || !readHeader(info, chunk, length)) {
+                return false;
+            }
+            haveHeader = true;
+        }
+        else if (!haveHeader) {
+            return false;
+        }
+        else if (type == "PLTE") {
+            if (length % 3 != 0 || length > 256 * 3) {
+                return false;
+            }
+            info.paletteSize = length / 3;
+            for (uint32_t i = 0; i < info.paletteSize; i++) {
+                memcpy(info.palette + i * 4, chunk + i * 3, 3);
+                info.palette[i * 4 + 3] = 0xFF;
+            }
+        }
+        else if (type == "tRNS") {
+            if (info.colorType == PNG_PALETTE) {
+                for (uint32_t i = 0; i < length && i < 256; i++) {
+                    info.palette[i * 4 + 3] = chunk[i];
+                }
+            }
+            else if (info.colorType == PNG_GRAY && length >= 2) {
+                info.hasKey = true;
+                info.key[0] = (static_cast<uint32_t>(chunk[0]) << 8) | chunk[1];
+            }
+            else if (info.colorType == PNG_RGB && length >= 6) {
+                info.hasKey = true;
+                for (size_t c = 0; c < 3; c++) {
+                    info.key[c] = (static_cast<uint32_t>(chunk[c * 2]) << 8) |
+                                  chunk[c * 2 + 1];
+                }
+            }
+        }
+        else if (type == "IDAT") {
+            idats.push_back({chunk, length});
+            idatSize += length;
+        }
+        else if (type == "IEND") {
+            break;
+        }
+        // Other chunks don't affect the pixels.
+    }
+
+    if (!haveHeader || idats.size == 0 ||
+        (info.colorType == PNG_PALETTE && info.paletteSize == 0)) {
+        return false;
+    }
+
+    // Size of the filtered image data, a filter type byte before each row of
+    // each pass.
+    size_t rawSize = 0;
+    if (!info.interlaced) {
+        rawSize = info.height * (1 + rowBytes(info, info.width));
+    }
+    else {
+        for (size_t i = 0; i < 7; i++) {
+            uint32_t w = passSize(info.width, passX[i], passDX[i]);
+            uint32_t h = passSize(info.height, passY[i], passDY[i]);
+            if (w && h) {
+                rawSize += h * (1 + rowBytes(info, w));
+            }
+        }
+    }
+
+    // The image data is one zlib stream split across IDAT chunks.
+    const uint8_t* compressed = idats[0].data;
+    uint8_t* joined = 0;
+    if (idats.size > 1) {
+        joined = static_cast<uint8_t*>(malloc(idatSize));
+        size_t offset = 0;
+        for (PngSpan& idat : idats) {
+            memcpy(joined + offset, idat.data, idat.size);
+            offset += idat.size;
+        }
+        compressed = joined;
+    }
+
+    uint8_t* raw = static_cast<uint8_t*>(malloc(rawSize));
+    bool ok = raw && zlibDecompress(compressed, idatSize, raw, rawSize);
+    free(joined);
+
+    if (!ok) {
+        free(raw);
+        return false;
+    }
+
+    width = info.width;
+    height = info.height;
+    rgba.resize(static_cast<size_t>(width) * height * 4);
+
+    size_t bpp = (info.channels * info.depth + 7) / 8;
+
+    if (!info.interlaced) {
+        size_t stride = rowBytes(info, width);
+        ok = unfilter(raw, height, stride, bpp);
+        for (uint32_t y = 0; ok && y < height; y++) {
+            convertRow(info,
+                       raw + y * (1 + stride) + 1,
+                       width,
+                       rgba.data + static_cast<size_t>(y) * width * 4,
+                       1);
+        }
+    }
+    else {
+        uint8_t* pass = raw;
+        for (size_t i = 0; ok && i < 7; i++) {
+            uint32_t w = passSize(width, passX[i], passDX[i]);
+            uint32_t h = passSize(height, passY[i], passDY[i]);
+            if (!w || !h) {
+                continue;
+            }
+
+            size_t stride = rowBytes(info, w);
+            ok = unfilter(pass, h, stride, bpp);
+
+            for (uint32_t r = 0; ok && r < h; r++) {
+                size_t y = passY[i] + r * passDY[i];
+                convertRow(info,
+                           pass + r * (1 + stride) + 1,
+                           w,
+                           rgba.data + (y * width + passX[i]) * 4,
+                           passDX[i]);
+            }
+
+            pass += h * (1 + stride);
+        }
+    }
+
+    free(raw);
+    return ok;
+}
@@ -0,0 +1,45 @@
+/********************************
+** Tsunagari Tile Engine       **
+** png.h                       **
+** Copyright 2020 Paul Merrill **
+********************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#ifndef SRC_UTIL_PNG_H_
+#define SRC_UTIL_PNG_H_
+
+#include "util/int.h"
+#include "util/noexcept.h"
+#include "util/string-view.h"
+#include "util/vector.h"
+
+// Decode a PNG image to 8 bits per channel RGBA, rows from top to bottom.
+// Every color type, bit depth, and interlacing method is supported. 16-bit
+// channels are rounded down to 8 bits. Returns false if data is not a valid
+// PNG.
+bool
+pngDecode(StringView data,
+          uint32_t& width,
+          uint32_t& height,
+          Vector<uint8_t>& rgba) noexcept;
+
+#endif  // SRC_UTIL_PNG_H_
@@ -82,17 +82,11 @@ StringView::find(StringView needle, size_t start) const noexcept {
 
 StringPosition
 StringView::rfind(char needle) const noexcept {
-    if (size == 0) {
-        return SV_NOT_FOUND;
-    }
-
-    size_t i = size - 1;
-    do {
-        if (data[i] == needle) {
-            return StringPosition(i);
+    for (size_t i = size; i > 0; i--) {
+        if (data[i - 1] == needle) {
+            return StringPosition(i - 1);
         }
-        i--;
-    } while (i > 0);
+    }
 
     return SV_NOT_FOUND;
 }
@@ -125,14 +125,14 @@ class Vector {
     void insert(size_t i, const X& x) noexcept {
         assert_(i <= size);
         grow();
-        memmove(data + i, data + i + 1, sizeof(X) * size);
+        memmove(data + i + 1, data + i, sizeof(X) * (size - i));
         new (data + i) X(x);
         size++;
     }
     void insert(size_t i, X&& x) noexcept {
         assert_(i <= size);
         grow();
-        memmove(data + i, data + i + 1, sizeof(X) * size);
+        memmove(data + i + 1, data + i, sizeof(X) * (size - i));
         new (data + i) X(static_cast<X&&>(x));
         size++;
     }
@@ -153,14 +153,17 @@ class Vector {
     void erase(size_t i) noexcept {
         assert_(i < size);
         data[i].~X();
-        memmove(data + i, data + i + 1, sizeof(X) * (size - i));
+        memmove(data + i, data + i + 1, sizeof(X) * (size - i - 1));
         size--;
     }
 
     void reserve(size_t n) noexcept {
-        assert_(n > capacity);
+        if (n <= capacity) {
+            return;
+        }
         X* newData = static_cast<X*>(malloc(sizeof(X) * n));
         memmove(newData, data, sizeof(X) * size);
+        free(data);
         data = newData;
         capacity = n;
     }
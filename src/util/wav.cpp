@@ -0,0 +1,152 @@
+/********************************
+** Tsunagari Tile Engine       **
+** wav.cpp                     **
+** Copyright 2020 Paul Merrill **
+********************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#include "util/wav.h"
+
+#include "os/c.h"
+#include "util/int.h"
+#include "util/noexcept.h"
+#include "util/string-view.h"
+#include "util/vector.h"
+
+// A WAV decoder for pack-tool, which decodes sound effects ahead of time for
+// the engine.
+
+enum WavFormat {
+    WAV_PCM = 1,
+    WAV_FLOAT = 3,
+    WAV_EXTENSIBLE = 0xFFFE,  // The real format is in the extension.
+};
+
+static uint32_t
+readLE16(const uint8_t* p) noexcept {
+    return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8;
+}
+
+static uint32_t
+readLE32(const uint8_t* p) noexcept {
+    return readLE16(p) | readLE16(p + 2) << 16;
+}
+
+static int16_t
+decodeSample(const uint8_t* p, uint32_t format, uint32_t bits) noexcept {
+    if (format == WAV_FLOAT) {
+        uint32_t bits32 = readLE32(p);
+        float f;
+        memcpy(&f, &bits32, sizeof(f));
+        if (!(f > -1.0f)) {  // Also catches NaN.
+            return -32768;
+        }
+        if (f >= 1.0f) {
+            return 32767;
+        }
+        return static_cast<int16_t>(f * 32767.0f);
+    }
+
+    switch (bits) {
+    case 8:
+        // The only unsigned size.
+        return static_cast<int16_t>((static_cast<int32_t>(p[0]) - 128) * 256);
+    case 16:
+        return static_cast<int16_t>(readLE16(p));
+    case 24:
+        return static_cast<int16_t>(readLE16(p + 1));
+    default:
+        return static_cast<int16_t>(readLE16(p + 2));
+    }
+}
+
+bool
+wavDecode(StringView data,
+          uint32_t& rate,
+          uint32_t& channels,
+          Vector<int16_t>& samples) noexcept {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data.data);
+    size_t size = data.size;
+
+    if (size < 12 || memcmp(p, "RIFF", 4) != 0 ||
+        memcmp(p + 8, "WAVE", 4) != 0) {
+        return false;
+    }
+
+    uint32_t format = 0;
+    uint32_t bits = 0;
+    uint32_t blockAlign = 0;
+    channels = 0;
+    rate = 0;
+
+    // Chunks are padded to an even size.
+    size_t i = 12;
+    while (i + 8 <= size) {
+        const uint8_t* chunk = p + i + 8;
+        size_t chunkSize = readLE32(p + i + 4);
+        if (chunkSize > size - i - 8) {
+            return false;
+        }
+
+        if (memcmp(p + i, "fmt ", 4) == 0) {
+            if (chunkSize < 16) {
+                return false;
+            }
+            format = readLE16(chunk);
+            channels = readLE16(chunk + 2);
+            rate = readLE32(chunk + 4);
+            blockAlign = readLE16(chunk + 12);
+            bits = readLE16(chunk + 14);
+
+            if (format == WAV_EXTENSIBLE) {
+                if (chunkSize < 26) {
+                    return false;
+                }
+                // The first two bytes of the subformat GUID are the format.
+                format = readLE16(chunk + 24);
+            }
+        }
+        else if (memcmp(p + i, "data", 4) == 0) {
+            bool valid = (format == WAV_PCM &&
+                          (bits == 8 || bits == 16 || bits == 24 ||
+                           bits == 32)) ||
+                         (format == WAV_FLOAT && bits == 32);
+            if (!valid || channels == 0 || rate == 0 ||
+                blockAlign != channels * (bits / 8)) {
+                return false;
+            }
+
+            size_t frames = chunkSize / blockAlign;
+            samples.resize(frames * channels);
+
+            const uint8_t* in = chunk;
+            for (size_t j = 0; j < samples.size; j++, in += bits / 8) {
+                samples[j] = decodeSample(in, format, bits);
+            }
+            return true;
+        }
+
+        i += 8 + chunkSize + (chunkSize & 1);
+    }
+
+    return false;
+}